@@ -0,0 +1,113 @@
+#ifndef SparseHungarian_AuctionSolver_H
+#define SparseHungarian_AuctionSolver_H
+
+#include "Defs.h"
+#include <vector>
+#include <limits>
+
+namespace SparseHungarian{
+  /**
+   * \brief Solve a matching problem using the Bertsekas auction algorithm
+   *
+   * Each 'A' vertex bids for the 'B' vertex that gives it the best value
+   * (benefit minus price), raising that vertex's price. Only the edges below
+   * the maximum cost are ever looked at, so this works well on large groups
+   * with few admissible edges. Each 'A' vertex may also choose to stay
+   * unmatched, which costs maxCost.
+   *
+   * The auction needs every vertex on both sides to end up matched for its
+   * optimality guarantee to hold, so the problem is made symmetric. Each 'A'
+   * vertex gets an extra 'B' vertex that represents it staying unmatched and
+   * vice versa, and the extra vertices of an admissible pair can be matched to
+   * each other. This only adds a number of edges proportional to the number of
+   * admissible edges.
+   *
+   * The result is only guaranteed to be within optimalityBound() of the
+   * optimal total cost. The auction is run repeatedly with a decreasing bid
+   * increment (epsilon) to keep the number of bidding rounds small.
+   */
+  class AuctionSolver {
+    public:
+      /**
+       * \brief Create the solver, this also performs the matching as part of
+       * the constructor
+       * \param costs The problem's cost matrix. May have any shape
+       * \param maxCost The maximum cost allowed to count as a matching. If this
+       * is infinite then one more than the largest cost is used.
+       * \param finalEpsilon The bid increment used in the last auction. The
+       * final matching is within (nVtxA + nVtxB) * finalEpsilon of the
+       * optimum. If 0 then 10^-5 of the maximum cost is used
+       * \param epsilonFactor The factor by which epsilon is reduced between
+       * auctions
+       * \param initialEpsilon The bid increment used in the first auction. If
+       * 0 then a quarter of the maximum cost is used
+       */
+      AuctionSolver(
+          const cost_view_t& costs,
+          float maxCost = std::numeric_limits<float>::infinity(),
+          float finalEpsilon = 0,
+          float epsilonFactor = 4,
+          float initialEpsilon = 0);
+
+      /**
+       * \brief Create the solver from any Eigen expression. Matrices of either
+       * storage order, blocks and transposes are used without a copy
+       */
+      template <typename Derived>
+        AuctionSolver(
+            const Eigen::DenseBase<Derived>& costs,
+            float maxCost = std::numeric_limits<float>::infinity(),
+            float finalEpsilon = 0,
+            float epsilonFactor = 4,
+            float initialEpsilon = 0)
+        : AuctionSolver(CostViewOf<Derived>(costs).view(), maxCost, finalEpsilon,
+            epsilonFactor, initialEpsilon) {}
+
+      /// The number of vertices from set A
+      const idx_t nVtxA;
+      /// The number of vertices from set B
+      const idx_t nVtxB;
+      /// The solution to this problem
+      const match_vec_t& solution() const { return m_solution; }
+      /// The bid increment used in the final auction
+      float epsilon() const { return m_epsilon; }
+      /**
+       * \brief Bound on how far the solution is from the optimum
+       *
+       * This is the gap between the total cost of the solution and the dual
+       * bound given by the final prices, so the optimal total cost is no more
+       * than this below that of the solution.
+       */
+      double optimalityBound() const { return m_bound; }
+    private:
+      /// The maximum cost, used as the cost of leaving a vertex unmatched
+      float m_maxCost;
+      /// Where each 'A' vertex's edges start in m_edgeB and m_benefits. The
+      /// extra 'A' vertex for 'B' vertex ib has index nVtxA + ib
+      std::vector<std::size_t> m_edgeOffsets;
+      /// The 'B' vertex for each edge. The extra 'B' vertex for 'A' vertex ia
+      /// has index nVtxB + ia
+      std::vector<idx_t> m_edgeB;
+      /// The benefit for each edge (maxCost - cost, or 0 for the extra edges)
+      std::vector<float> m_benefits;
+      /// The prices of the 'B' vertices
+      std::vector<double> m_prices;
+      /// Matches from A to B vertices
+      std::vector<idx_t> m_matchA;
+      /// Matches from B to A vertices
+      std::vector<idx_t> m_matchB;
+      /// The current bid increment
+      float m_epsilon;
+      /// The final optimality bound
+      double m_bound;
+      /// The solution
+      match_vec_t m_solution;
+      /// Run the auction until every 'A' vertex is matched
+      void auction();
+      /// Get the best value an 'A' vertex can obtain, and the vertex giving it
+      double bestValue(idx_t a, idx_t& best, double& secondBest) const;
+      /// Calculate the gap between the primal and dual solutions
+      double dualityGap() const;
+  };
+}
+#endif //> !SparseHungarian_AuctionSolver_H
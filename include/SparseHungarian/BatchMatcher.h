@@ -0,0 +1,115 @@
+#ifndef SparseHungarian_BatchMatcher_H
+#define SparseHungarian_BatchMatcher_H
+
+#include "Defs.h"
+#include "Matching.h"
+#include "ThreadPool.h"
+#include "SolverWorkspace.h"
+#include <vector>
+
+namespace SparseHungarian {
+  /**
+   * \brief A matching problem given as a cost matrix
+   *
+   * The matrix is not copied, so it must outlive the call to
+   * BatchMatcher::match.
+   */
+  struct MatrixEvent {
+    /// The cost matrix
+    const cost_matrix_t* costs;
+    /// The maximum cost for a match
+    float maxCost;
+  };
+
+  /**
+   * \brief A matching problem given as two sets of points in eta-phi
+   *
+   * The points are not copied, so they must outlive the call to
+   * BatchMatcher::match.
+   */
+  struct PointEvent {
+    /// The points in set A
+    const point_vec_t* pointsA;
+    /// The points in set B
+    const point_vec_t* pointsB;
+    /// The maximum deltaR for a match
+    float maxDR;
+  };
+
+  /**
+   * \brief The matches for a batch of events, stored in one flat buffer
+   *
+   * The matches for event i are matches[offsets[i]] to
+   * matches[offsets[i+1]-1].
+   */
+  struct BatchResult {
+    /// All of the matches, event by event
+    match_vec_t matches;
+    /// Where each event's matches start. Has one more entry than there are
+    /// events
+    std::vector<std::size_t> offsets;
+    /// The number of events
+    std::size_t nEvents() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+    /// The first match for an event
+    match_vec_t::const_iterator begin(std::size_t event) const
+    { return matches.begin() + offsets.at(event); }
+    /// One past the last match for an event
+    match_vec_t::const_iterator end(std::size_t event) const
+    { return matches.begin() + offsets.at(event + 1); }
+  };
+
+  /**
+   * \brief Solve many independent events in parallel
+   *
+   * Each event is solved exactly as sparseMatch would solve it. The events
+   * are handed out to the threads one at a time, so a few expensive events do
+   * not hold up the rest. The threads and their scratch space are kept
+   * between calls so a BatchMatcher should be reused for every batch. It must
+   * only be used from one thread at a time.
+   */
+  class BatchMatcher {
+    public:
+      /**
+       * \brief Create the matcher
+       * \param nThreads The number of threads to use. If 0 then the hardware
+       * concurrency is used
+       * \param solver The engine to use for each group
+       */
+      BatchMatcher(std::size_t nThreads = 0, Solver solver = Solver::Automatic);
+
+      /// The number of threads used
+      std::size_t nThreads() const { return m_pool.size(); }
+
+      /// Solve a batch of events given as cost matrices
+      BatchResult match(const std::vector<MatrixEvent>& events);
+      /// Solve a batch of events given as point sets
+      BatchResult match(const std::vector<PointEvent>& events);
+
+      /// The engine used for each group
+      const Solver solver;
+    private:
+      /// Where a thread put the matches for one event
+      struct Record {
+        std::size_t event;
+        std::size_t start;
+        std::size_t size;
+      };
+      /// The scratch space belonging to each thread
+      struct Workspace {
+        /// The matches found by this thread
+        match_vec_t matches;
+        /// The events solved by this thread
+        std::vector<Record> records;
+        /// The solvers' working memory
+        SolverWorkspace solver;
+      };
+      /// The threads
+      ThreadPool m_pool;
+      /// One workspace per thread
+      std::vector<Workspace> m_workspaces;
+      /// Solve nEvents events using solveOne and collect the results
+      template <typename F>
+        BatchResult run(std::size_t nEvents, F solveOne);
+  };
+}
+#endif //> !SparseHungarian_BatchMatcher_H
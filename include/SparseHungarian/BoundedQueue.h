@@ -0,0 +1,121 @@
+#ifndef SparseHungarian_BoundedQueue_H
+#define SparseHungarian_BoundedQueue_H
+
+#include "SolverWorkspace.h"
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+namespace SparseHungarian {
+  /**
+   * \brief A fixed capacity first-in first-out queue that any number of
+   * threads can push to and pop from without locks
+   *
+   * Each slot carries a sequence number that tells a pushing thread when the
+   * slot is free and a popping thread when it is filled, so the threads only
+   * ever contend on the head and tail counters (see D. Vyukov's bounded MPMC
+   * queue). Neither operation blocks: they report failure if the queue is
+   * full or empty and leave the caller to decide what to do instead.
+   */
+  template <typename T>
+  class BoundedQueue {
+    public:
+      /**
+       * \brief Create the queue
+       * \param capacity The most elements that it can hold. Rounded up to a
+       * power of two
+       */
+      explicit BoundedQueue(std::size_t capacity)
+      {
+        m_capacity = 1;
+        while (m_capacity < capacity)
+          m_capacity *= 2;
+        m_slots.reset(new Slot[m_capacity]);
+        for (std::size_t ii = 0; ii < m_capacity; ++ii)
+          m_slots[ii].sequence.store(ii, std::memory_order_relaxed);
+        m_head.store(0, std::memory_order_relaxed);
+        m_tail.store(0, std::memory_order_relaxed);
+      }
+
+      BoundedQueue(const BoundedQueue&) = delete;
+      BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+      /// The most elements that the queue can hold
+      std::size_t capacity() const { return m_capacity; }
+
+      /**
+       * \brief Add an element to the back of the queue
+       * \param value The element. Only moved from if this succeeds
+       * \return False if the queue is full
+       */
+      bool tryPush(T& value)
+      {
+        std::size_t pos = m_tail.load(std::memory_order_relaxed);
+        while (true) {
+          Slot& slot = m_slots[pos & (m_capacity - 1)];
+          std::size_t sequence = slot.sequence.load(std::memory_order_acquire);
+          std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(sequence - pos);
+          if (diff == 0) {
+            // The slot is free, try to claim it
+            if (m_tail.compare_exchange_weak(
+                  pos, pos + 1, std::memory_order_relaxed) ) {
+              slot.value = std::move(value);
+              slot.sequence.store(pos + 1, std::memory_order_release);
+              return true;
+            }
+          }
+          else if (diff < 0)
+            // The slot still holds the element from a lap ago
+            return false;
+          else
+            pos = m_tail.load(std::memory_order_relaxed);
+        }
+      }
+
+      /**
+       * \brief Take the element from the front of the queue
+       * \param[out] value Receives the element
+       * \return False if the queue is empty
+       */
+      bool tryPop(T& value)
+      {
+        std::size_t pos = m_head.load(std::memory_order_relaxed);
+        while (true) {
+          Slot& slot = m_slots[pos & (m_capacity - 1)];
+          std::size_t sequence = slot.sequence.load(std::memory_order_acquire);
+          std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(sequence - pos - 1);
+          if (diff == 0) {
+            // The slot is filled, try to claim it
+            if (m_head.compare_exchange_weak(
+                  pos, pos + 1, std::memory_order_relaxed) ) {
+              value = std::move(slot.value);
+              // Free the slot for the push one lap later
+              slot.sequence.store(pos + m_capacity, std::memory_order_release);
+              return true;
+            }
+          }
+          else if (diff < 0)
+            // Nothing has been pushed to this slot yet
+            return false;
+          else
+            pos = m_head.load(std::memory_order_relaxed);
+        }
+      }
+
+    private:
+      struct Slot {
+        std::atomic<std::size_t> sequence;
+        T value;
+      };
+      std::size_t m_capacity;
+      std::unique_ptr<Slot[]> m_slots;
+      /// The next position to pop from. Kept on its own cache line, away
+      /// from the tail
+      alignas(cacheLineSize) std::atomic<std::size_t> m_head;
+      /// The next position to push to
+      alignas(cacheLineSize) std::atomic<std::size_t> m_tail;
+  };
+}
+
+#endif //> !SparseHungarian_BoundedQueue_H
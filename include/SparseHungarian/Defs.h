@@ -2,16 +2,254 @@
 #define SparseHungarian_Defs_H
 
 #include <Eigen/Dense>
+#include <algorithm>
+#include <cmath>
 #include <vector>
 #include <utility>
+#include <limits>
+#include <cstddef>
+#include <type_traits>
+#include <cstdint>
 
 namespace SparseHungarian {
-  using cost_matrix_t = Eigen::MatrixXf;
+  /**
+   * \brief Properties of the types that costs can be given in
+   *
+   * The library is built for float, double, std::int32_t and std::int64_t
+   * costs. Integer costs are solved exactly. As the solvers add and subtract
+   * labels, integer costs (and max costs) must have a magnitude below
+   * unlimited() so that nothing overflows.
+   */
+  template <typename T>
+  struct CostTraits {
+    static_assert(
+        std::is_same<T, float>::value || std::is_same<T, double>::value ||
+        std::is_same<T, std::int32_t>::value ||
+        std::is_same<T, std::int64_t>::value,
+        "Costs must be float, double, std::int32_t or std::int64_t");
+    /// Whether the arithmetic on this type is exact
+    static constexpr bool isExact = std::is_integral<T>::value;
+    /// A max cost that never clips anything. Infinity for floating point
+    /// types
+    static constexpr T unlimited()
+    {
+      return std::numeric_limits<T>::has_infinity ?
+        std::numeric_limits<T>::infinity() :
+        std::numeric_limits<T>::max() / 8;
+    }
+    /// A value larger than any slack or distance the solvers can reach
+    static constexpr T largest()
+    {
+      return std::numeric_limits<T>::has_infinity ?
+        std::numeric_limits<T>::infinity() :
+        std::numeric_limits<T>::max();
+    }
+  };
+
+  template <typename T>
+    using basic_cost_matrix_t = Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>;
+  /// A view of a cost matrix stored with any strides, so it can look at
+  /// column-major or row-major matrices, blocks and transposes without a copy
+  template <typename T>
+    using basic_cost_view_t = Eigen::Map<
+      const basic_cost_matrix_t<T>, 0,
+      Eigen::Stride<Eigen::Dynamic, Eigen::Dynamic>>;
+  using cost_matrix_t = basic_cost_matrix_t<float>;
+  using cost_view_t = basic_cost_view_t<float>;
   using cost_row_t = Eigen::RowVectorXf;
   using cost_col_t = Eigen::VectorXf;
   using idx_t = Eigen::Index;
   using match_t = std::pair<idx_t, idx_t>;
   using match_vec_t = std::vector<match_t>;
+  /// A point in (phi, eta)
+  using point_t = std::pair<float, float>;
+  using point_vec_t = std::vector<point_t>;
+
+  /**
+   * \brief The max cost that a dense solver should clip the costs to
+   *
+   * An infinite cost can't be matched, but with an unlimited max cost it isn't
+   * clipped and would spoil the labels or prices. In that case this returns a
+   * finite cost above the total of any matching of finite costs, so that
+   * clipping to it makes every infinite edge no better than leaving the
+   * vertex unmatched, and matching as many vertices as possible on finite
+   * edges always cheaper. Otherwise the max cost is returned unchanged. Edges
+   * at or above it are still dropped by comparing to the original max cost.
+   */
+  template <typename T>
+    T finiteMaxCost(const basic_cost_view_t<T>& costs, T maxCost)
+    {
+      if (!std::numeric_limits<T>::has_infinity ||
+          maxCost < CostTraits<T>::largest() )
+        return maxCost;
+      bool infinite = false;
+      T lowest = CostTraits<T>::largest();
+      T highest = -CostTraits<T>::largest();
+      for (idx_t ib = 0; ib < costs.cols(); ++ib) {
+        for (idx_t ia = 0; ia < costs.rows(); ++ia) {
+          T cost = costs.coeff(ia, ib);
+          if (cost < CostTraits<T>::largest() ) {
+            lowest = std::min(lowest, cost);
+            highest = std::max(highest, cost);
+          }
+          else
+            infinite = true;
+        }
+      }
+      if (!infinite)
+        return maxCost;
+      if (highest < lowest)
+        // Nothing can be matched
+        return 0;
+      // A matching of n finite costs totals between n * lowest and
+      // n * highest, so one more unmatched vertex must cost more than the
+      // difference that can make
+      T n = std::min(costs.rows(), costs.cols() );
+      return highest + n * (highest - lowest) + std::abs(highest) + 1;
+    }
+
+  /**
+   * \brief Build a basic_cost_view_t for an Eigen expression
+   *
+   * Expressions whose coefficients are stored in memory are viewed where they
+   * are. Anything else (e.g. a sum of matrices) is first evaluated into a
+   * matrix owned by this object, so the view is valid for its lifetime.
+   */
+  template <typename Derived,
+           bool DirectAccess = (
+               Eigen::DenseBase<Derived>::Flags & Eigen::DirectAccessBit) != 0>
+  class CostViewOf {
+    public:
+      using scalar_t = typename Derived::Scalar;
+      using view_t = basic_cost_view_t<scalar_t>;
+      explicit CostViewOf(const Eigen::DenseBase<Derived>& costs)
+        :
+          m_view(costs.derived().data(), costs.rows(), costs.cols(),
+              // A view's outer stride is its column stride
+              Derived::IsRowMajor ?
+              Eigen::Stride<Eigen::Dynamic, Eigen::Dynamic>(
+                costs.derived().innerStride(), costs.derived().outerStride() ) :
+              Eigen::Stride<Eigen::Dynamic, Eigen::Dynamic>(
+                costs.derived().outerStride(), costs.derived().innerStride() ) )
+      {}
+      const view_t& view() const { return m_view; }
+    private:
+      view_t m_view;
+  };
+
+  template <typename Derived>
+  class CostViewOf<Derived, false> {
+    public:
+      using scalar_t = typename Derived::Scalar;
+      using view_t = basic_cost_view_t<scalar_t>;
+      explicit CostViewOf(const Eigen::DenseBase<Derived>& costs)
+        :
+          m_costs(costs),
+          m_view(m_costs.data(), m_costs.rows(), m_costs.cols(),
+              Eigen::Stride<Eigen::Dynamic, Eigen::Dynamic>(m_costs.rows(), 1) )
+      {}
+      const view_t& view() const { return m_view; }
+    private:
+      basic_cost_matrix_t<scalar_t> m_costs;
+      view_t m_view;
+  };
+
+  /**
+   * \brief A cost matrix that only stores the edges with finite costs at or
+   * below the maximum cost, in compressed-row form
+   *
+   * Rows are built in order: add the edges of a row with addEdge and then call
+   * endRow.
+   */
+  struct SparseCostMatrix {
+    /**
+     * \brief Create an empty matrix
+     * \param nCols The number of columns
+     * \param maxCost The maximum cost of any stored edge
+     */
+    SparseCostMatrix(
+        idx_t nCols = 0,
+        float maxCost = std::numeric_limits<float>::infinity() )
+      : nRows(0), nCols(nCols), maxCost(maxCost), rowOffsets(1, 0) {}
+
+    /// Build the sparse form of a dense matrix, keeping the finite edges
+    /// <= maxCost
+    static SparseCostMatrix fromDense(
+        const cost_matrix_t& costs,
+        float maxCost);
+
+    /**
+     * \brief Build the sparse matrix from a cost function, evaluating it only
+     * for candidate pairs
+     * \param nRows The number of rows
+     * \param nCols The number of columns
+     * \param maxCost The maximum cost of any stored edge
+     * \param cost Called as cost(ia, ib) to give the cost of a pair
+     * \param candidates Called as candidates(ia, visit) for each row. It
+     * must call visit(ib) for every column that could be within maxCost of
+     * the row, and can skip any that cannot
+     *
+     * Only the finite candidates at or below maxCost are kept, so the memory
+     * used scales with the number of edges rather than with nRows * nCols.
+     * The edges of each row are stored in column order, whatever order the
+     * candidates are visited in, and a column visited twice is kept once.
+     */
+    template <typename CostFunc, typename CandidateFunc>
+      static SparseCostMatrix fromFunction(
+          idx_t nRows,
+          idx_t nCols,
+          float maxCost,
+          CostFunc&& cost,
+          CandidateFunc&& candidates)
+      {
+        SparseCostMatrix sparse(nCols, maxCost);
+        sparse.rowOffsets.reserve(nRows + 1);
+        std::vector<std::pair<idx_t, float>> row;
+        for (idx_t ia = 0; ia < nRows; ++ia) {
+          row.clear();
+          candidates(ia, [&] (idx_t ib) {
+              float value = cost(ia, ib);
+              if (value <= maxCost &&
+                  value < std::numeric_limits<float>::infinity() )
+                row.emplace_back(ib, value);
+            });
+          std::sort(row.begin(), row.end() );
+          for (std::size_t ie = 0; ie < row.size(); ++ie)
+            if (ie == 0 || row[ie].first != row[ie - 1].first)
+              sparse.addEdge(row[ie].first, row[ie].second);
+          sparse.endRow();
+        }
+        return sparse;
+      }
+
+    /// The number of rows
+    idx_t nRows;
+    /// The number of columns
+    idx_t nCols;
+    /// The maximum cost
+    float maxCost;
+    /// Where each row starts in cols and costs. Has nRows + 1 entries
+    std::vector<std::size_t> rowOffsets;
+    /// The column of each edge
+    std::vector<idx_t> cols;
+    /// The cost of each edge
+    std::vector<float> costs;
+
+    /// The number of stored edges
+    std::size_t nEdges() const { return cols.size(); }
+    /// Add an edge to the row currently being built
+    void addEdge(idx_t col, float cost)
+    {
+      cols.push_back(col);
+      costs.push_back(cost);
+    }
+    /// Finish the row currently being built
+    void endRow()
+    {
+      rowOffsets.push_back(cols.size() );
+      ++nRows;
+    }
+  };
 }
 
 #endif //> !SparseHungarian_Defs_H
@@ -0,0 +1,30 @@
+#ifndef SparseHungarian_DeltaR_H
+#define SparseHungarian_DeltaR_H
+
+#include "Defs.h"
+
+namespace SparseHungarian {
+  /**
+   * \brief The distance between two points in eta-phi, accounting for the
+   * wrapping of phi
+   */
+  float deltaR(const point_t& a, const point_t& b);
+
+  /**
+   * \brief Build the sparse deltaR cost matrix between two sets of points
+   * \param pointsA The points for set A (the rows)
+   * \param pointsB The points for set B (the columns)
+   * \param maxDR The maximum deltaR for an edge to be kept
+   *
+   * The points are binned into a grid in eta-phi with cells at least maxDR
+   * wide (wrapping around in phi) so that each point only needs to be compared
+   * against the points in the neighbouring cells. The full cost matrix is
+   * never built.
+   */
+  SparseCostMatrix buildDeltaRCosts(
+      const point_vec_t& pointsA,
+      const point_vec_t& pointsB,
+      float maxDR);
+}
+
+#endif //> !SparseHungarian_DeltaR_H
@@ -0,0 +1,107 @@
+#ifndef SparseHungarian_DeltaRMatcher_H
+#define SparseHungarian_DeltaRMatcher_H
+
+#include "Defs.h"
+#include "Matching.h"
+#include "SparseGroup.h"
+#include <vector>
+
+namespace SparseHungarian {
+  /**
+   * \brief Match two sets of points in eta-phi by deltaR, given as separate
+   * arrays of phi and eta
+   *
+   * The 'B' points are split into bands in phi at least maxDR wide and
+   * sorted in eta within each band, so each 'A' point is only compared with
+   * a contiguous window of three bands. Over a window the wrapped phi
+   * differences and squared distances are computed as whole arrays, so Eigen
+   * vectorises them without branches. Pairs are pruned on the squared
+   * distance and square roots are only taken for the edges that are kept,
+   * which go straight into the sparse grouping and solvers.
+   *
+   * The buffers are kept between calls, so one matcher should be reused for
+   * every event.
+   */
+  class DeltaRMatcher {
+    public:
+      /// The phi or eta coordinates of a set of points
+      using coords_t = Eigen::Ref<const Eigen::ArrayXf>;
+
+      /**
+       * \brief Create the matcher
+       * \param maxDR The maximum deltaR for a match
+       * \param solver The engine to use for each group
+       */
+      DeltaRMatcher(float maxDR, Solver solver = Solver::Automatic);
+
+      /// The maximum deltaR for a match
+      float maxDR() const { return m_maxDR; }
+
+      /**
+       * \brief Build the sparse deltaR costs between two sets of points
+       * \param phiA The phi of each point in set A (the rows)
+       * \param etaA The eta of each point in set A
+       * \param phiB The phi of each point in set B (the columns)
+       * \param etaB The eta of each point in set B
+       * \return The costs, valid until the matcher is next used
+       *
+       * Phi may be given in any range. With phi in [0, 2pi) the edges are
+       * exactly those from buildDeltaRCosts, in the same order.
+       */
+      const SparseCostMatrix& buildCosts(
+          const coords_t& phiA,
+          const coords_t& etaA,
+          const coords_t& phiB,
+          const coords_t& etaB);
+
+      /**
+       * \brief Match two sets of points
+       * \param phiA The phi of each point in set A
+       * \param etaA The eta of each point in set A
+       * \param phiB The phi of each point in set B
+       * \param etaB The eta of each point in set B
+       * \return A vector containing any matches that were found
+       */
+      match_vec_t match(
+          const coords_t& phiA,
+          const coords_t& etaA,
+          const coords_t& phiB,
+          const coords_t& etaB);
+
+      /// The costs from the last call
+      const SparseCostMatrix& costs() const { return m_costs; }
+
+      /// The groups found by the last call to match
+      const std::vector<SparseGroup>& groups() const { return m_groups; }
+
+    private:
+      /// The maximum deltaR
+      float m_maxDR;
+      /// The engine used for each group
+      Solver m_solver;
+      /// The costs
+      SparseCostMatrix m_costs;
+      /// The groups
+      std::vector<SparseGroup> m_groups;
+      /// The 'B' points in order of phi band, then eta
+      std::vector<idx_t> m_order;
+      /// Where each band starts in the sorted 'B' points
+      std::vector<idx_t> m_bandOffsets;
+      /// The phi of the sorted 'B' points, wrapped into [0, 2pi)
+      Eigen::ArrayXf m_phiB;
+      /// The eta of the sorted 'B' points
+      Eigen::ArrayXf m_etaB;
+      /// The squared distances over the current window
+      Eigen::ArrayXf m_dr2;
+      /// Where each column starts in the edges sorted by column
+      std::vector<std::size_t> m_colOffsets;
+      /// The row of each edge sorted by column
+      std::vector<idx_t> m_colRows;
+      /// The cost of each edge sorted by column
+      std::vector<float> m_colCosts;
+      /// The next free position in each column or row while sorting
+      std::vector<std::size_t> m_next;
+  };
+}
+
+#endif //> !SparseHungarian_DeltaRMatcher_H
@@ -0,0 +1,210 @@
+#ifndef SparseHungarian_DynamicAssignment_H
+#define SparseHungarian_DynamicAssignment_H
+
+#include "Defs.h"
+#include "SolverWorkspace.h"
+#include "SparseGroup.h"
+#include <vector>
+
+namespace SparseHungarian {
+  /**
+   * \brief An optimal matching that is kept up to date as vertices come and
+   * go and costs change
+   *
+   * The state is that of a HungarianSolver: labels and matches on a square
+   * matrix of negated costs. Here the matrix is squared with explicit dummy
+   * rows or columns of zeros, which are matched like any other vertex, so
+   * every change reduces to resetting the label of one row or column. That
+   * loosens at most one match, and a single augmentation (see
+   * incrementalAugment) restores optimality. Each change therefore costs at
+   * most O(n^2) rather than the O(n^3) of a fresh solve.
+   *
+   * Removing a vertex shifts the indices of the later vertices of its set
+   * down by one, as erasing from a vector would.
+   *
+   * The sparse groups of the problem (see splitProblemIntoSparseGroups) are
+   * tracked at the same time. Groups merge as edges at or below the max cost
+   * appear, and only the group that loses an edge or a vertex is searched
+   * again. Group numbers run from 0 to nGroups() and may change with any
+   * modification.
+   */
+  template <typename T>
+  class BasicDynamicAssignment {
+    public:
+      /// A row of costs for a new 'A' vertex
+      using row_t = Eigen::Matrix<T, 1, Eigen::Dynamic>;
+      /// A column of costs for a new 'B' vertex
+      using col_t = Eigen::Matrix<T, Eigen::Dynamic, 1>;
+
+      /**
+       * \brief Create an empty problem
+       * \param maxCost The maximum cost allowed to count as a matching
+       */
+      explicit BasicDynamicAssignment(T maxCost = CostTraits<T>::unlimited() );
+
+      /**
+       * \brief Create the problem and solve it
+       * \param costs The starting cost matrix. Either set can be the larger
+       * \param maxCost The maximum cost allowed to count as a matching
+       */
+      BasicDynamicAssignment(
+          const basic_cost_view_t<T>& costs,
+          T maxCost = CostTraits<T>::unlimited() );
+
+      /// Create the problem from any Eigen expression and solve it
+      template <typename Derived>
+        BasicDynamicAssignment(
+            const Eigen::DenseBase<Derived>& costs,
+            T maxCost = CostTraits<T>::unlimited() )
+        : BasicDynamicAssignment(CostViewOf<Derived>(costs).view(), maxCost)
+        {}
+
+      /// The number of 'A' vertices
+      idx_t nVtxA() const { return m_nA; }
+      /// The number of 'B' vertices
+      idx_t nVtxB() const { return m_nB; }
+      /// The maximum cost
+      T maxCost() const { return m_maxCost; }
+      /// A view of the current costs
+      basic_cost_view_t<T> costs() const;
+
+      /**
+       * \brief Add an 'A' vertex
+       * \param costs Its costs to each of the 'B' vertices
+       * \return The index of the new vertex, which is the last
+       */
+      idx_t insertRow(const Eigen::Ref<const row_t>& costs);
+
+      /**
+       * \brief Add a 'B' vertex
+       * \param costs Its costs to each of the 'A' vertices
+       * \return The index of the new vertex, which is the last
+       */
+      idx_t insertColumn(const Eigen::Ref<const col_t>& costs);
+
+      /// Remove an 'A' vertex. Later 'A' vertices move down by one
+      void removeRow(idx_t ia);
+
+      /// Remove a 'B' vertex. Later 'B' vertices move down by one
+      void removeColumn(idx_t ib);
+
+      /// Change the cost between two vertices
+      void updateCost(idx_t ia, idx_t ib, T cost);
+
+      /// The 'B' vertex matched to an 'A' vertex, -1 if there is none
+      idx_t matchOfA(idx_t ia) const;
+
+      /// The 'A' vertex matched to a 'B' vertex, -1 if there is none
+      idx_t matchOfB(idx_t ib) const;
+
+      /// The current matching, with only pairs below the max cost as for the
+      /// solvers, in order of the 'A' vertices
+      match_vec_t solution() const;
+
+      /// The number of sparse groups
+      idx_t nGroups() const { return m_groups.size(); }
+
+      /// The group of an 'A' vertex, -1 if it has no edges at or below the
+      /// max cost
+      idx_t groupOfA(idx_t ia) const { return m_groupOfA.at(ia); }
+
+      /// The group of a 'B' vertex, -1 if it has no edges at or below the
+      /// max cost
+      idx_t groupOfB(idx_t ib) const { return m_groupOfB.at(ib); }
+
+      /// The 'A' vertices in a group, in increasing order
+      const std::vector<idx_t>& groupIndicesA(idx_t group) const
+      { return m_groups.at(group).indicesA; }
+
+      /// The 'B' vertices in a group, in increasing order
+      const std::vector<idx_t>& groupIndicesB(idx_t group) const
+      { return m_groups.at(group).indicesB; }
+
+      /// Build a SparseGroup for a group, copying its costs. A star group is
+      /// solved instead, as in splitProblemIntoSparseGroups
+      BasicSparseGroup<T> sparseGroup(idx_t group) const;
+
+    private:
+      /// The vertices of one group
+      struct Group {
+        std::vector<idx_t> indicesA;
+        std::vector<idx_t> indicesB;
+      };
+      /// The maximum cost
+      T m_maxCost;
+      /// The number of 'A' vertices
+      idx_t m_nA = 0;
+      /// The number of 'B' vertices
+      idx_t m_nB = 0;
+      /// The size of the squared problem, the larger of m_nA and m_nB
+      idx_t m_size = 0;
+      /// The most rows or columns that the matrices can hold before they are
+      /// reallocated
+      idx_t m_capacity = 0;
+      /// The costs as given. Row-major, with m_capacity elements per row
+      std::vector<T> m_costs;
+      /// Holds the labels, matches and search state. Its costs are the
+      /// negated costs clipped to the max cost, squared with rows or columns
+      /// of zeros and laid out in the same way as m_costs
+      BasicSolverWorkspace<T> m_workspace;
+      /// The group of each 'A' vertex
+      std::vector<idx_t> m_groupOfA;
+      /// The group of each 'B' vertex
+      std::vector<idx_t> m_groupOfB;
+      /// The groups
+      std::vector<Group> m_groups;
+
+      /// An element of the given costs
+      T& cost(idx_t ia, idx_t ib) { return m_costs[ia * m_capacity + ib]; }
+      T cost(idx_t ia, idx_t ib) const { return m_costs[ia * m_capacity + ib]; }
+      /// An element of the working copy of the squared problem
+      T& working(idx_t ia, idx_t ib)
+      { return m_workspace.costs[ia * m_capacity + ib]; }
+      /// The working copy of the squared problem
+      basic_padded_matrix_t<T> workingCosts();
+      /// Whether an edge is in the sparse groups. As in findSparseGroups, an
+      /// infinite cost never is
+      bool admissible(idx_t ia, idx_t ib) const
+      {
+        return cost(ia, ib) <= m_maxCost &&
+          cost(ia, ib) < CostTraits<T>::largest();
+      }
+      /// Make space for a problem of the given size
+      void reserve(idx_t size);
+      /// Add a row and column to the squared problem, leaving them unmatched
+      /// and with zero costs
+      void grow();
+      /// Move a row to the last 'A' vertex, keeping its label and match. Its
+      /// costs are not kept
+      void moveRowToEnd(idx_t ia);
+      /// Move a column to the last 'B' vertex, keeping its label and match.
+      /// Its costs are not kept
+      void moveColumnToEnd(idx_t ib);
+      /// Remove the last row and column of the squared problem, leaving the
+      /// vertices that they were matched to unmatched
+      void shrink();
+      /// Set the label of a row to the smallest feasible value, unmatching it
+      /// if its match is no longer tight
+      void resetRow(idx_t ia);
+      /// Set the label of a column to the smallest feasible value, unmatching
+      /// it if its match is no longer tight
+      void resetColumn(idx_t ib);
+      /// Augment from any unmatched rows
+      void repair();
+      /// Join the groups of the two ends of an admissible edge
+      void link(idx_t ia, idx_t ib);
+      /// Find the groups again among the vertices of one group
+      void regroup(idx_t group);
+      /// Delete a group, moving the last group into its place
+      void eraseGroup(idx_t group);
+  };
+
+  /// A dynamic assignment with float costs
+  using DynamicAssignment = BasicDynamicAssignment<float>;
+
+  extern template class BasicDynamicAssignment<float>;
+  extern template class BasicDynamicAssignment<double>;
+  extern template class BasicDynamicAssignment<std::int32_t>;
+  extern template class BasicDynamicAssignment<std::int64_t>;
+}
+#endif //> !SparseHungarian_DynamicAssignment_H
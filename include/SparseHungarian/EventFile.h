@@ -0,0 +1,252 @@
+#ifndef SparseHungarian_EventFile_H
+#define SparseHungarian_EventFile_H
+
+#include "Defs.h"
+#include "BatchMatcher.h"
+#include <cstdint>
+#include <fstream>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace SparseHungarian {
+  /**
+   * \name The binary event format
+   *
+   * A file holds any number of deltaR matching events, each a set of 'A' and
+   * 'B' points in eta-phi and a MaxDR. Everything is little-endian.
+   *
+   * The file starts with a 24 byte header: the magic "SHEV", a uint32
+   * version, a uint64 event count and the uint64 position of the offset
+   * table. Each event is a 16 byte header (float MaxDR, uint32 nA, uint32 nB
+   * and four bytes of zero) followed by the float arrays phiA, etaA, phiB and
+   * etaB. The offset table at the end of the file holds the uint64 position
+   * of each event, so events can be written one at a time and read in any
+   * order.
+   */
+  ///@{
+
+  /**
+   * \brief One event in an EventFileReader, viewing its arrays where they lie
+   * in the file
+   */
+  struct EventView {
+    /// A view of one array of coordinates
+    using coords_t = Eigen::Map<const Eigen::ArrayXf>;
+    /// The maximum deltaR for a match
+    float maxDR;
+    /// The phi of each point in set A
+    coords_t phiA;
+    /// The eta of each point in set A
+    coords_t etaA;
+    /// The phi of each point in set B
+    coords_t phiB;
+    /// The eta of each point in set B
+    coords_t etaB;
+  };
+
+  /**
+   * \brief Read a binary event file by mapping it into memory
+   *
+   * Nothing is copied: each event views its arrays in the mapping, which
+   * lasts as long as the reader. The header and offset table are checked
+   * when the file is opened, so reading an event can't run off the end.
+   */
+  class EventFileReader {
+    public:
+      /**
+       * \brief Map a file
+       * \param path The file to read
+       */
+      explicit EventFileReader(const std::string& path);
+      ~EventFileReader();
+
+      EventFileReader(const EventFileReader&) = delete;
+      EventFileReader& operator=(const EventFileReader&) = delete;
+
+      /// The number of events
+      std::size_t nEvents() const { return m_offsets.size(); }
+
+      /// View an event
+      EventView event(std::size_t index) const;
+
+    private:
+      /// The start of the mapping
+      const char* m_data = nullptr;
+      /// The size of the file
+      std::size_t m_size = 0;
+      /// The position of each event
+      std::vector<std::uint64_t> m_offsets;
+  };
+
+  /**
+   * \brief Write a binary event file, one event at a time
+   *
+   * The offset table and the final header are written by close, which the
+   * destructor calls if it hasn't been already.
+   */
+  class EventFileWriter {
+    public:
+      /**
+       * \brief Create the file
+       * \param path The file to write. Any existing file is replaced
+       */
+      explicit EventFileWriter(const std::string& path);
+      ~EventFileWriter();
+
+      EventFileWriter(const EventFileWriter&) = delete;
+      EventFileWriter& operator=(const EventFileWriter&) = delete;
+
+      /**
+       * \brief Add an event
+       * \param phiA The phi of each point in set A
+       * \param etaA The eta of each point in set A
+       * \param phiB The phi of each point in set B
+       * \param etaB The eta of each point in set B
+       * \param maxDR The maximum deltaR for a match
+       */
+      void write(
+          const Eigen::Ref<const Eigen::ArrayXf>& phiA,
+          const Eigen::Ref<const Eigen::ArrayXf>& etaA,
+          const Eigen::Ref<const Eigen::ArrayXf>& phiB,
+          const Eigen::Ref<const Eigen::ArrayXf>& etaB,
+          float maxDR);
+
+      /// Add an event given as (phi, eta) points
+      void write(
+          const point_vec_t& pointsA,
+          const point_vec_t& pointsB,
+          float maxDR);
+
+      /// The number of events written so far
+      std::size_t nEvents() const { return m_offsets.size(); }
+
+      /// Finish the file. Nothing more can be written
+      void close();
+
+    private:
+      std::ofstream m_out;
+      /// The position of each event
+      std::vector<std::uint64_t> m_offsets;
+      /// The current end of the file
+      std::uint64_t m_position = 0;
+      /// Write raw bytes, checking for errors
+      void put(const void* data, std::size_t size);
+  };
+
+  /**
+   * \brief An event that owns its arrays, for events read one at a time
+   */
+  struct EventData {
+    /// The maximum deltaR for a match
+    float maxDR = 0;
+    /// The phi of each point in set A
+    Eigen::ArrayXf phiA;
+    /// The eta of each point in set A
+    Eigen::ArrayXf etaA;
+    /// The phi of each point in set B
+    Eigen::ArrayXf phiB;
+    /// The eta of each point in set B
+    Eigen::ArrayXf etaB;
+  };
+
+  /**
+   * \brief Read the events of a binary event file one at a time from a stream
+   *
+   * The stream is only read forwards, so it can be a pipe, and only one event
+   * is held at once. The events come in the order they are stored, which for
+   * a file from EventFileWriter is the order they were written.
+   */
+  class EventStreamReader {
+    public:
+      /**
+       * \brief Read the file header
+       * \param in The stream, at the start of the file. It must outlive the
+       * reader
+       */
+      explicit EventStreamReader(std::istream& in);
+
+      /// The number of events in the file
+      std::size_t nEvents() const { return m_nEvents; }
+
+      /**
+       * \brief Read the next event
+       * \param[out] event Receives the event
+       * \return False once every event has been read
+       */
+      bool read(EventData& event);
+
+    private:
+      std::istream& m_in;
+      /// The number of events in the file
+      std::uint64_t m_nEvents = 0;
+      /// The number of events read so far
+      std::uint64_t m_nRead = 0;
+      /// The position of the offset table, where the events end
+      std::uint64_t m_tableOffset = 0;
+      /// The current position in the file
+      std::uint64_t m_position = 0;
+  };
+
+  /**
+   * \brief Write the matches of events one at a time to a stream
+   *
+   * After the magic "SHMS" and a uint32 version, each event is a uint32
+   * count of matches followed by each match as two uint32 indices, all
+   * little-endian. Nothing needs to be known in advance, so the stream can
+   * be a pipe.
+   */
+  class MatchStreamWriter {
+    public:
+      /**
+       * \brief Write the header
+       * \param out The stream. It must outlive the writer
+       */
+      explicit MatchStreamWriter(std::ostream& out);
+
+      /// Write the matches of the next event
+      void write(const match_vec_t& matches);
+
+    private:
+      std::ostream& m_out;
+  };
+
+  /// Read the matches written by a MatchStreamWriter one event at a time
+  class MatchStreamReader {
+    public:
+      /**
+       * \brief Read the header
+       * \param in The stream. It must outlive the reader
+       */
+      explicit MatchStreamReader(std::istream& in);
+
+      /**
+       * \brief Read the matches of the next event
+       * \param[out] matches Receives the matches
+       * \return False at the end of the stream
+       */
+      bool read(match_vec_t& matches);
+
+    private:
+      std::istream& m_in;
+  };
+
+  /**
+   * \brief Write the matches for a batch of events
+   * \param path The file to write
+   * \param result The matches
+   *
+   * The file has the magic "SHMT", a uint32 version, the uint64 number of
+   * events and of matches, the uint64 offsets (as in BatchResult) and then
+   * each match as two uint32 indices, all little-endian.
+   */
+  void writeMatchFile(const std::string& path, const BatchResult& result);
+
+  /// Read the matches written by writeMatchFile
+  BatchResult readMatchFile(const std::string& path);
+
+  ///@}
+}
+
+#endif //> !SparseHungarian_EventFile_H
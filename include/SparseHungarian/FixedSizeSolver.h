@@ -0,0 +1,231 @@
+#ifndef SparseHungarian_FixedSizeSolver_H
+#define SparseHungarian_FixedSizeSolver_H
+
+#include "Defs.h"
+#include <array>
+#include <algorithm>
+#include <stdexcept>
+
+namespace SparseHungarian {
+  /// The largest dimension handled by the FixedSizeSolver
+  constexpr int maxFixedSize = 8;
+
+  /**
+   * \brief Solve a tiny matching problem whose dimensions are known at compile
+   * time
+   *
+   * Everything is kept on the stack and the loops have fixed trip counts, so
+   * the compiler can unroll them. Problems whose larger dimension is at most
+   * maxEnumerationSize are solved by trying every assignment. Larger ones use
+   * a compact shortest augmenting path version of the Hungarian algorithm.
+   *
+   * As for the other solvers, edges at or above the max cost are not
+   * matches. The constructor throws if the costs have the wrong shape.
+   */
+  template <typename T, int NA, int NB>
+  class FixedSizeSolver {
+    static_assert(NA >= 1 && NB >= 1 &&
+        NA <= maxFixedSize && NB <= maxFixedSize,
+        "FixedSizeSolver dimensions must be between 1 and maxFixedSize");
+    public:
+      /// The largest dimension solved by trying every assignment
+      static constexpr int maxEnumerationSize = 4;
+      /// The most matches that the solution can contain
+      static constexpr int maxMatches = NA < NB ? NA : NB;
+
+      /**
+       * \brief Create the solver, this also performs the matching as part of
+       * the constructor
+       * \param costs The problem's cost matrix. Must be NA x NB
+       * \param maxCost The maximum cost allowed to count as a matching
+       */
+      FixedSizeSolver(
+          const basic_cost_view_t<T>& costs,
+          T maxCost = CostTraits<T>::unlimited() )
+      {
+        if (costs.rows() != NA || costs.cols() != NB)
+          throw std::runtime_error(
+              "Matrix supplied to FixedSizeSolver has the wrong size");
+        // Infinite costs would make every total that uses them equal, so
+        // they are clipped to a finite max cost (see finiteMaxCost). They are
+        // dropped from the matches below
+        T clip = finiteMaxCost(costs, maxCost);
+        for (int ir = 0; ir < nRows; ++ir)
+          for (int ic = 0; ic < nCols; ++ic)
+            m_costs[ir][ic] = std::min(cost(costs, ir, ic), clip);
+        std::array<int, nRows> assignment;
+        for (int ir = 0; ir < nRows; ++ir)
+          assignment[ir] = ir;
+        if (nCols <= maxEnumerationSize) {
+          std::array<int, nRows> current;
+          T best = CostTraits<T>::largest();
+          enumerate<0>(0u, 0, current, best, assignment);
+        }
+        else
+          shortestPaths(assignment);
+        for (int ir = 0; ir < nRows; ++ir) {
+          if (assignment[ir] < 0)
+            continue;
+          if (cost(costs, ir, assignment[ir]) < maxCost)
+            m_matches[m_nMatches++] = flipped ?
+              match_t(assignment[ir], ir) : match_t(ir, assignment[ir]);
+        }
+      }
+
+      /// Create the solver from any Eigen expression
+      template <typename Derived>
+        FixedSizeSolver(
+            const Eigen::DenseBase<Derived>& costs,
+            T maxCost = CostTraits<T>::unlimited() )
+        : FixedSizeSolver(CostViewOf<Derived>(costs).view(), maxCost) {}
+
+      /// The number of matches found
+      std::size_t size() const { return m_nMatches; }
+      /// The first match
+      const match_t* begin() const { return m_matches.data(); }
+      /// One past the last match
+      const match_t* end() const { return m_matches.data() + m_nMatches; }
+    private:
+      /// The solver works with the smaller set as its rows
+      static constexpr bool flipped = NA > NB;
+      static constexpr int nRows = flipped ? NB : NA;
+      static constexpr int nCols = flipped ? NA : NB;
+      /// The costs, clipped to the max cost, with the smaller set as rows
+      std::array<std::array<T, nCols>, nRows> m_costs;
+      /// The matches found
+      std::array<match_t, maxMatches> m_matches;
+      /// The number of matches found
+      int m_nMatches = 0;
+
+      /// Read an element of the original costs by its row and column here
+      static T cost(const basic_cost_view_t<T>& costs, int ir, int ic)
+      { return flipped ? costs.coeff(ic, ir) : costs.coeff(ir, ic); }
+
+      /// Try every column for this row that isn't used by an earlier one,
+      /// keeping the first cheapest assignment
+      template <int Row>
+        void enumerate(
+            unsigned int used,
+            T total,
+            std::array<int, nRows>& current,
+            T& best,
+            std::array<int, nRows>& assignment) const
+        {
+          if constexpr (Row == nRows) {
+            if (total < best) {
+              best = total;
+              assignment = current;
+            }
+          }
+          else {
+            for (int ic = 0; ic < nCols; ++ic) {
+              if (used & (1u << ic) )
+                continue;
+              current[Row] = ic;
+              enumerate<Row + 1>(used | (1u << ic), total + m_costs[Row][ic],
+                  current, best, assignment);
+            }
+          }
+        }
+
+      /// Add the rows one at a time along their shortest augmenting paths,
+      /// using the row and column potentials to keep the reduced costs
+      /// non-negative. Index 0 is a sentinel so the arrays are one longer.
+      /// A row with no finite path to a free column is given -1.
+      void shortestPaths(std::array<int, nRows>& assignment) const
+      {
+        std::array<T, nRows + 1> rowPotential{};
+        std::array<T, nCols + 1> colPotential{};
+        // The row matched to each column
+        std::array<int, nCols + 1> rowOf{};
+        // The previous column on the path to each column
+        std::array<int, nCols + 1> previous{};
+        // Start each row's potential at its cheapest cost and give it that
+        // column if no earlier row has taken it. Often this matches most rows
+        // before any search is needed.
+        std::array<bool, nRows + 1> matched{};
+        for (int row = 1; row <= nRows; ++row) {
+          int best = 1;
+          for (int col = 2; col <= nCols; ++col)
+            if (m_costs[row - 1][col - 1] < m_costs[row - 1][best - 1])
+              best = col;
+          rowPotential[row] = m_costs[row - 1][best - 1];
+          if (rowOf[best] == 0) {
+            rowOf[best] = row;
+            matched[row] = true;
+          }
+        }
+        for (int row = 1; row <= nRows; ++row) {
+          if (matched[row])
+            continue;
+          rowOf[0] = row;
+          int col0 = 0;
+          std::array<T, nCols + 1> minReduced;
+          minReduced.fill(CostTraits<T>::largest() );
+          std::array<bool, nCols + 1> done{};
+          do {
+            done[col0] = true;
+            int row0 = rowOf[col0];
+            int col1 = 0;
+            T delta = CostTraits<T>::largest();
+            for (int col = 1; col <= nCols; ++col) {
+              if (done[col])
+                continue;
+              T reduced = m_costs[row0 - 1][col - 1] -
+                rowPotential[row0] - colPotential[col];
+              if (reduced < minReduced[col]) {
+                minReduced[col] = reduced;
+                previous[col] = col0;
+              }
+              if (minReduced[col] < delta) {
+                delta = minReduced[col];
+                col1 = col;
+              }
+            }
+            // The clipped costs are finite, but if nothing finite is left to
+            // reach then leave the row out rather than spoil the potentials
+            if (!(delta < CostTraits<T>::largest() ) )
+              break;
+            for (int col = 0; col <= nCols; ++col) {
+              if (done[col]) {
+                rowPotential[rowOf[col]] += delta;
+                colPotential[col] -= delta;
+              }
+              else
+                minReduced[col] -= delta;
+            }
+            col0 = col1;
+          }
+          while (rowOf[col0] != 0);
+          if (rowOf[col0] != 0)
+            continue;
+          // Augment back along the path
+          do {
+            int col1 = previous[col0];
+            rowOf[col0] = rowOf[col1];
+            col0 = col1;
+          }
+          while (col0 != 0);
+        }
+        assignment.fill(-1);
+        for (int col = 1; col <= nCols; ++col)
+          if (rowOf[col] != 0)
+            assignment[rowOf[col] - 1] = col - 1;
+      }
+  };
+
+  /**
+   * \brief Solve a problem with a FixedSizeSolver chosen by its size
+   * \param costs The cost matrix defining the problem
+   * \param maxCost The maximum cost for a match
+   * \param[out] matches The matches found are appended to this
+   * \return False, without touching matches, if either dimension of the
+   * problem is zero or larger than maxFixedSize
+   */
+  template <typename T>
+    bool matchFixedSize(
+        const basic_cost_view_t<T>& costs,
+        std::common_type_t<T> maxCost,
+        match_vec_t& matches);
+}
+#endif //> !SparseHungarian_FixedSizeSolver_H
@@ -0,0 +1,108 @@
+#ifndef SparseHungarian_GroupArena_H
+#define SparseHungarian_GroupArena_H
+
+#include "Defs.h"
+#include "SolverWorkspace.h"
+#include "SparseGroup.h"
+#include <vector>
+
+namespace SparseHungarian {
+  /**
+   * \brief Holds all of the sparse groups of one event in a few contiguous
+   * buffers
+   *
+   * splitProblemIntoSparseGroups makes several heap allocations for every
+   * group. The arena instead keeps the index lists of all of the groups one
+   * after the other, and the cost blocks likewise, and hands out lightweight
+   * Group objects that point into them. Splitting the next event (or calling
+   * reset) drops the groups but keeps the buffers, which only ever grow, so
+   * after the first few events no allocations are made.
+   *
+   * As with a SolverWorkspace, an arena must not be shared between threads.
+   */
+  template <typename T>
+  class BasicGroupArena {
+    public:
+      /// One group, pointing into the arena. Invalidated by the next split or
+      /// reset
+      struct Group {
+        /// The 'A' indices of the group
+        const idx_t* indicesA;
+        /// The number of 'A' indices
+        idx_t nA;
+        /// The 'B' indices of the group
+        const idx_t* indicesB;
+        /// The number of 'B' indices
+        idx_t nB;
+        /// The group's costs in column-major order. Null for a star group
+        const T* costs;
+        /// The positions in indicesA and indicesB of the only match of a star
+        /// group, (-1, -1) for any other group
+        match_t starMatch;
+        /// Whether this is a star group that was solved as it was found
+        bool isStar() const { return starMatch.first != -1; }
+        /// View the group's costs
+        basic_cost_view_t<T> costView() const
+        {
+          return basic_cost_view_t<T>(costs, nA, nB,
+              Eigen::Stride<Eigen::Dynamic, Eigen::Dynamic>(nA, 1) );
+        }
+      };
+
+      /**
+       * \brief Split a problem into groups, replacing any held before
+       * \param costs The costs for this matching problem
+       * \param maxCost The maximum cost in this matching problem
+       *
+       * The groups are the same, and in the same order, as those from the
+       * union-find version of splitProblemIntoSparseGroups.
+       */
+      void split(
+          const basic_cost_view_t<T>& costs,
+          std::common_type_t<T> maxCost);
+
+      /// Split a problem given by any Eigen expression
+      template <typename Derived>
+        void split(
+            const Eigen::DenseBase<Derived>& costs,
+            typename Derived::Scalar maxCost)
+        { split(CostViewOf<Derived>(costs).view(), maxCost); }
+
+      /// Drop the groups, keeping the memory for the next event
+      void reset();
+
+      /// The number of groups
+      std::size_t size() const { return m_starMatches.size(); }
+
+      /// The maximum cost of the problem that was split
+      T maxCost() const { return m_maxCost; }
+
+      /// Get a group
+      Group operator[](std::size_t ig) const;
+
+      /// The number of cost elements held for all of the groups
+      std::size_t nCosts() const { return m_costs.size(); }
+
+    private:
+      /// Finds the groups and holds their index lists
+      BasicSolverWorkspace<T> m_grouping;
+      /// Where each group's costs start in m_costs
+      std::vector<std::size_t> m_costOffsets;
+      /// The cost blocks of all of the groups
+      std::vector<T> m_costs;
+      /// The match of each star group
+      std::vector<match_t> m_starMatches;
+      /// The max cost of the current problem
+      T m_maxCost = 0;
+  };
+
+  /// An arena for float costs
+  using GroupArena = BasicGroupArena<float>;
+
+  extern template class BasicGroupArena<float>;
+  extern template class BasicGroupArena<double>;
+  extern template class BasicGroupArena<std::int32_t>;
+  extern template class BasicGroupArena<std::int64_t>;
+}
+
+#endif //> !SparseHungarian_GroupArena_H
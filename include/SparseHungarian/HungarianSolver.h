@@ -2,19 +2,74 @@
 #define SparseHungarian_HungarianSolver_H
 
 #include "Defs.h"
+#include "SolverWorkspace.h"
 #include <vector>
-#include <map>
+#include <limits>
+#include <memory>
 
 namespace SparseHungarian{
+  /**
+   * \brief The strategy used by the HungarianSolver to search for augmenting
+   * paths
+   */
+  enum class HungarianSearchMode {
+    /// Rebuild the search state from scratch for every root vertex. This is
+    /// optimal too but slower, and is kept as a reference for the other mode
+    Rebuild,
+    /// Keep the slacks and the alternating tree across label updates. This
+    /// gives an O(nVtxA^2 nVtxB) bound on the full solve
+    Incremental
+  };
+
+  /**
+   * \brief The full state of a solved HungarianSolver, which can be used to
+   * warm start the solve of a similar problem
+   *
+   * The labels are the dual solution of the clipped problem: for every pair
+   * labelsA[a] + labelsB[b] <= min(costs(a, b), maxCost), with equality for
+   * the matched pairs. Unlike the solution, the matches include pairs at or
+   * above the max cost. Unmatched vertices have a match of -1.
+   */
+  template <typename T>
+  struct BasicDualState {
+    /// The labels of the 'A' vertices
+    std::vector<T> labelsA;
+    /// The labels of the 'B' vertices
+    std::vector<T> labelsB;
+    /// The 'B' vertex matched to each 'A' vertex
+    std::vector<idx_t> matchA;
+    /// The 'A' vertex matched to each 'B' vertex
+    std::vector<idx_t> matchB;
+
+    /// Whether this state has the shape of an nVtxA x nVtxB problem
+    bool fits(idx_t nVtxA, idx_t nVtxB) const
+    {
+      return static_cast<idx_t>(labelsA.size() ) == nVtxA &&
+        static_cast<idx_t>(matchA.size() ) == nVtxA &&
+        static_cast<idx_t>(labelsB.size() ) == nVtxB &&
+        static_cast<idx_t>(matchB.size() ) == nVtxB;
+    }
+  };
+
+  /// The dual state for float costs
+  using DualState = BasicDualState<float>;
+
   /**
    * \brief Class containing all of the information necessary to solve a
    * matching problem
    *
    * This class is the one that is actually used to solve the Hungarian
-   * algorithm.
+   * algorithm. The costs can be of any type in CostTraits. With integer costs
+   * every comparison is exact, while floating point costs can leave rounding
+   * errors in the slacks, so double is the safer choice for large problems
+   * whose costs are close together.
    */
-  class HungarianSolver {
+  template <typename T>
+  class BasicHungarianSolver {
     public:
+      /// The strategy used to search for augmenting paths
+      using SearchMode = HungarianSearchMode;
+
       /**
        * \brief Create the solver, this also performs the matching as part of
        * the constructor
@@ -23,42 +78,164 @@ namespace SparseHungarian{
        * \param maxCost If relevant, the maximum cost allowed to count as a
        * matching
        * \param initialMatching Any preliminary attempt at a matching. Supplying
-       * this can speed up the algorithm
+       * this can speed up the algorithm. Any pairs that are not on the
+       * equality subgraph of the starting labels are ignored.
+       * \param mode The strategy used to search for augmenting paths
+       * \param workspace If provided, all of the solver's state is kept in
+       * here rather than allocated. The solution is also stored in it so it is
+       * only valid until the workspace is reused.
        */
-      HungarianSolver(
-          const cost_matrix_t& costs,
-          float maxCost = std::numeric_limits<float>::infinity(),
-          const match_vec_t& initialMatching = match_vec_t() );
+      BasicHungarianSolver(
+          const basic_cost_view_t<T>& costs,
+          T maxCost = CostTraits<T>::unlimited(),
+          const match_vec_t& initialMatching = match_vec_t(),
+          SearchMode mode = SearchMode::Incremental,
+          BasicSolverWorkspace<T>* workspace = nullptr);
+
+      /**
+       * \brief Create the solver from any Eigen expression. Matrices of either
+       * storage order, blocks and transposes are used without a copy
+       */
+      template <typename Derived>
+        BasicHungarianSolver(
+            const Eigen::DenseBase<Derived>& costs,
+            T maxCost = CostTraits<T>::unlimited(),
+            const match_vec_t& initialMatching = match_vec_t(),
+            SearchMode mode = SearchMode::Incremental,
+            BasicSolverWorkspace<T>* workspace = nullptr)
+        : BasicHungarianSolver(CostViewOf<Derived>(costs).view(), maxCost,
+            initialMatching, mode, workspace) {}
+
+      /**
+       * \brief Create the solver, starting from the state left by a solve of
+       * a similar problem
+       * \param costs The problem's cost matrix
+       * \param maxCost If relevant, the maximum cost allowed to count as a
+       * matching
+       * \param[in,out] state The state of the previous solve, which is
+       * replaced by that of this one. Ignored if its shape does not match
+       * that of this problem, so an empty state gives a cold start
+       * \param mode The strategy used to search for augmenting paths
+       * \param workspace If provided, all of the solver's state is kept in
+       * here rather than allocated
+       *
+       * The 'B' labels are kept and each 'A' label is set to the largest value
+       * that is feasible with them. The previous matches that are still tight
+       * are kept and only the vertices that lost their matches are searched
+       * from. When consecutive problems differ by small changes in the costs
+       * (for example when tracking objects between frames) most of the
+       * matching survives and the solve is much cheaper than starting afresh.
+       * Passing the same state to each solve in turn is all that is needed.
+       */
+      BasicHungarianSolver(
+          const basic_cost_view_t<T>& costs,
+          T maxCost,
+          BasicDualState<T>& state,
+          SearchMode mode = SearchMode::Incremental,
+          BasicSolverWorkspace<T>* workspace = nullptr);
+
+      /// Create the warm started solver from any Eigen expression
+      template <typename Derived>
+        BasicHungarianSolver(
+            const Eigen::DenseBase<Derived>& costs,
+            T maxCost,
+            BasicDualState<T>& state,
+            SearchMode mode = SearchMode::Incremental,
+            BasicSolverWorkspace<T>* workspace = nullptr)
+        : BasicHungarianSolver(CostViewOf<Derived>(costs).view(), maxCost,
+            state, mode, workspace) {}
 
       /// The number of vertices from set A
       const idx_t nVtxA;
       /// The number of vertices from set B
       const idx_t nVtxB;
+      /// The search strategy used by this solver
+      const SearchMode searchMode;
       /// The solution to this problem
       const match_vec_t& solution() const { return m_solution; }
+
+      /**
+       * \brief Copy out the labels and matches of the solution
+       * \param[out] state Receives the state. Its buffers are reused
+       */
+      void dualState(BasicDualState<T>& state) const;
+
+      /// The labels and matches of the solution
+      BasicDualState<T> dualState() const;
     private:
-      /// The cost matrix, modified to be square
-      cost_matrix_t m_costs;
+      /// Set up the working copy of the costs and clear the search state,
+      /// without labelling or solving
+      BasicHungarianSolver(
+          const basic_cost_view_t<T>& costs,
+          T maxCost,
+          SearchMode mode,
+          BasicSolverWorkspace<T>* workspace);
+      /// The workspace, if none was provided
+      std::unique_ptr<BasicSolverWorkspace<T>> m_ownWorkspace;
+      /// The workspace holding all of the state below
+      BasicSolverWorkspace<T>& m_workspace;
+      /// The cost matrix, modified to be square. Stored row-major as the
+      /// searches read rows
+      basic_padded_matrix_t<T> m_costs;
       /// The maximum cost
-      const float m_maxCost;
+      const T m_maxCost;
       /// The labels for set A
-      std::vector<float> m_labelsA;
+      std::vector<T>& m_labelsA;
       /// The labels for set B
-      std::vector<float> m_labelsB;
+      std::vector<T>& m_labelsB;
       /// The solution
-      match_vec_t m_solution;
+      match_vec_t& m_solution;
       /// Matches from A to B vertices
-      std::vector<idx_t> m_matchA;
+      std::vector<idx_t>& m_matchA;
       /// Matches from B to A vertices
-      std::vector<idx_t> m_matchB;
+      std::vector<idx_t>& m_matchB;
+      /// Start from the row maxima of the costs and the given matches
+      void coldStart(const match_vec_t& initialMatching);
+      /// Start from the labels and matches of a previous solve
+      void warmStart(const BasicDualState<T>& state);
+      /// Bring the labels of any unmatched 'B' vertices down to zero, freeing
+      /// the matches that this takes off the equality subgraph. Returns false
+      /// if there were none
+      bool releaseFreeLabelsB();
       /// Try to obtain a solution
       void solve();
+      /// Fill the solution from the matches
+      void loadSolution(const basic_cost_view_t<T>& costs, T maxCost);
       /// Get the slack on an edge
-      float getSlack(idx_t a, idx_t b) const;
-      /// Perform the depth-first search
-      void breadthFirstSearch(idx_t root);
-      /// Augment along the provided path
-      void augmentPath(const std::map<idx_t, idx_t>& path, idx_t end);
+      T getSlack(idx_t a, idx_t b) const;
+      /// Perform the breadth-first search, rebuilding its state for this root.
+      /// Returns false if the root can't be matched
+      bool breadthFirstSearch(idx_t root);
+      /// Augment along the path given by the 'A' predecessor of each 'B' vertex
+      void augmentPath(const std::vector<idx_t>& path, idx_t end);
   };
+
+  /**
+   * \brief Match one more 'A' vertex using the HungarianSolver's incremental
+   * search
+   * \param costs The square matrix of negated costs that the labels describe
+   * \param root The unmatched 'A' vertex to search from
+   * \param workspace Holds the labels and matches. The labels must be
+   * feasible and the matched edges tight. Unmatched vertices are matched to
+   * costs.cols()
+   * \return False if the root can't be matched, which happens when its costs
+   * are all infinite. It is left unmatched
+   *
+   * This is a single augmentation, which costs at most O(n^2). The
+   * DynamicAssignment uses it to restore an optimal matching after a change.
+   */
+  template <typename T>
+    bool incrementalAugment(
+        const basic_padded_matrix_t<T>& costs,
+        idx_t root,
+        BasicSolverWorkspace<T>& workspace);
+
+  /// The solver for float costs
+  using HungarianSolver = BasicHungarianSolver<float>;
+
+  extern template class BasicHungarianSolver<float>;
+  extern template class BasicHungarianSolver<double>;
+  extern template class BasicHungarianSolver<std::int32_t>;
+  extern template class BasicHungarianSolver<std::int64_t>;
 }
 #endif //> !SparseHungarian_HungarianSolver_H
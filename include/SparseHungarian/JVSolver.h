@@ -0,0 +1,102 @@
+#ifndef SparseHungarian_JVSolver_H
+#define SparseHungarian_JVSolver_H
+
+#include "Defs.h"
+#include "SolverWorkspace.h"
+#include <vector>
+#include <limits>
+#include <memory>
+
+namespace SparseHungarian{
+  /**
+   * \brief Solve a matching problem using the Jonker-Volgenant algorithm
+   *
+   * This solves the same problem as the HungarianSolver, but uses the
+   * shortest augmenting path algorithm of Jonker and Volgenant (LAPJV). Most of
+   * the matching is found by the cheap initialisation phases (column reduction,
+   * reduction transfer and augmenting row reduction) so that only a few rows
+   * need a full shortest path search. This is usually much faster on dense
+   * problems. The costs can be of any type in CostTraits.
+   */
+  template <typename T>
+  class BasicJVSolver {
+    public:
+      /**
+       * \brief Create the solver, this also performs the matching as part of
+       * the constructor
+       * \param costs The problem's cost matrix. Not required to be square but
+       * the number of rows must be less than or equal to the number of columns.
+       * \param maxCost If relevant, the maximum cost allowed to count as a
+       * matching
+       * \param initialMatching Any preliminary attempt at a matching. Pairs
+       * which are consistent with the prices found by the column reduction are
+       * kept.
+       * \param workspace If provided, all of the solver's state is kept in
+       * here rather than allocated. The solution is also stored in it so it is
+       * only valid until the workspace is reused.
+       */
+      BasicJVSolver(
+          const basic_cost_view_t<T>& costs,
+          T maxCost = CostTraits<T>::unlimited(),
+          const match_vec_t& initialMatching = match_vec_t(),
+          BasicSolverWorkspace<T>* workspace = nullptr);
+
+      /**
+       * \brief Create the solver from any Eigen expression. Matrices of either
+       * storage order, blocks and transposes are used without a copy
+       */
+      template <typename Derived>
+        BasicJVSolver(
+            const Eigen::DenseBase<Derived>& costs,
+            T maxCost = CostTraits<T>::unlimited(),
+            const match_vec_t& initialMatching = match_vec_t(),
+            BasicSolverWorkspace<T>* workspace = nullptr)
+        : BasicJVSolver(CostViewOf<Derived>(costs).view(), maxCost,
+            initialMatching, workspace) {}
+
+      /// The number of vertices from set A
+      const idx_t nVtxA;
+      /// The number of vertices from set B
+      const idx_t nVtxB;
+      /// The solution to this problem
+      const match_vec_t& solution() const { return m_solution; }
+    private:
+      /// The workspace, if none was provided
+      std::unique_ptr<BasicSolverWorkspace<T>> m_ownWorkspace;
+      /// The workspace holding all of the state below
+      BasicSolverWorkspace<T>& m_workspace;
+      /// The cost matrix, clipped to the max cost. Stored row-major as the
+      /// search phases mostly read rows
+      basic_padded_matrix_t<T> m_costs;
+      /// The prices of the 'B' vertices
+      std::vector<T>& m_prices;
+      /// The solution
+      match_vec_t& m_solution;
+      /// Matches from A to B vertices. Extra dummy 'A' vertices are added to
+      /// make the problem square
+      std::vector<idx_t>& m_matchA;
+      /// Matches from B to A vertices
+      std::vector<idx_t>& m_matchB;
+      /// The 'A' vertices which are not yet matched
+      std::vector<idx_t>& m_free;
+      /// Get the cost of an edge, including those to the dummy vertices
+      T getCost(idx_t a, idx_t b) const
+      { return a < nVtxA ? m_costs.coeff(a, b) : 0; }
+      /// Initialise the prices and matching from the column minima
+      void columnReduction(const match_vec_t& initialMatching);
+      /// Improve the matching by repeatedly moving free rows to their cheapest
+      /// column
+      void augmentingRowReduction();
+      /// Find the shortest augmenting path from a free row and augment along it
+      void augment(idx_t freeRow);
+  };
+
+  /// The solver for float costs
+  using JVSolver = BasicJVSolver<float>;
+
+  extern template class BasicJVSolver<float>;
+  extern template class BasicJVSolver<double>;
+  extern template class BasicJVSolver<std::int32_t>;
+  extern template class BasicJVSolver<std::int64_t>;
+}
+#endif //> !SparseHungarian_JVSolver_H
@@ -3,35 +3,301 @@
 
 #include "Defs.h"
 #include "SparseGroup.h"
+#include "GroupArena.h"
+#include "ThreadPool.h"
+#include "SolverWorkspace.h"
 #include <limits>
 
 namespace SparseHungarian {
+  /**
+   * \brief The engines available to solve a (dense) matching problem
+   */
+  enum class Solver {
+    /// Use the HungarianSolver
+    Hungarian,
+    /// Use the JVSolver
+    JonkerVolgenant,
+    /// Use the AuctionSolver. The result is only approximately optimal
+    Auction,
+    /// Choose the engine based on the size of the problem. Problems no
+    /// larger than maxFixedSize in either dimension use a FixedSizeSolver
+    Automatic
+  };
+
   /**
    * \brief Perform a matching without the sparse implementation
    * \param costs The cost matrix defining the problem
    * \param maxCost The maximum cost for a match
+   * \param solver The engine to use if the simple matching fails
    * \return A vector containing any matches that were found
+   *
+   * The dense matching functions are available for each of the cost types in
+   * CostTraits. The max cost has the type of the costs but is not used to
+   * deduce it, so a float matrix can be matched with a double literal. The
+   * auction solver always works in float precision, so other cost types are
+   * converted for it.
    */
-  match_vec_t match(
-      const cost_matrix_t& costs,
-      float maxCost = std::numeric_limits<float>::infinity() );
+  template <typename T>
+    match_vec_t match(
+        const basic_cost_view_t<T>& costs,
+        std::common_type_t<T> maxCost = CostTraits<T>::unlimited(),
+        Solver solver = Solver::Automatic);
+
+  /**
+   * \brief Perform a matching without the sparse implementation, keeping all
+   * working memory in a workspace
+   * \param costs The cost matrix defining the problem
+   * \param maxCost The maximum cost for a match
+   * \param workspace The workspace to use. Apart from with the auction solver
+   * no allocations are made once its buffers are large enough.
+   * \param solver The engine to use if the simple matching fails
+   * \return The matches, stored in the workspace and so only valid until it is
+   * next used
+   */
+  template <typename T>
+    const match_vec_t& match(
+        const basic_cost_view_t<T>& costs,
+        std::common_type_t<T> maxCost,
+        BasicSolverWorkspace<T>& workspace,
+        Solver solver = Solver::Automatic);
+
+  /**
+   * \brief Perform a matching directly on a sparse cost matrix
+   * \param costs The sparse cost matrix defining the problem
+   * \return A vector containing any matches that were found
+   */
+  match_vec_t match(const SparseCostMatrix& costs);
 
   /**
    * \brief Perform a matching using the sparse implementation
    * \param costs The cost matrix defining the problem
    * \param maxCost The maximum cost for a match
+   * \param solver The engine to use for each group
+   * \return A vector containing any matches that were found
+   */
+  template <typename T>
+    match_vec_t sparseMatch(
+        const basic_cost_view_t<T>& costs,
+        std::common_type_t<T> maxCost,
+        Solver solver = Solver::Automatic);
+
+  /**
+   * \brief Perform a matching using the sparse implementation, keeping all
+   * working memory in a workspace
+   * \param costs The cost matrix defining the problem
+   * \param maxCost The maximum cost for a match
+   * \param workspace The workspace to use. Apart from with the auction solver
+   * no allocations are made once its buffers are large enough.
+   * \param solver The engine to use for each group
+   * \return The matches, stored in the workspace and so only valid until it is
+   * next used
+   */
+  template <typename T>
+    const match_vec_t& sparseMatch(
+        const basic_cost_view_t<T>& costs,
+        std::common_type_t<T> maxCost,
+        BasicSolverWorkspace<T>& workspace,
+        Solver solver = Solver::Automatic);
+
+  /**
+   * \brief Perform the sparse matching, solving the groups in parallel with
+   * finding them
+   * \param costs The cost matrix defining the problem
+   * \param maxCost The maximum cost for a match
+   * \param pool The threads to use. One finds the groups with the breadth
+   * first search and the rest solve them as they arrive
+   * \param solver The engine to use for each group
+   * \return A vector containing any matches that were found
+   *
+   * Completed groups are passed through a BoundedQueue. When it is full the
+   * thread finding the groups solves one itself, and once all of the groups
+   * are found it helps to solve the rest. The groups view the costs rather
+   * than copying them. The result is the same, and in the same order, as
+   * matchFromGroups on the breadth first groups.
+   */
+  template <typename T>
+    match_vec_t sparseMatch(
+        const basic_cost_view_t<T>& costs,
+        std::common_type_t<T> maxCost,
+        ThreadPool& pool,
+        Solver solver = Solver::Automatic);
+
+  /**
+   * \brief Match two sets of points in eta-phi by deltaR using the sparse
+   * implementation
+   * \param pointsA The points in set A
+   * \param pointsB The points in set B
+   * \param maxDR The maximum deltaR for a match
+   * \param solver The engine to use for each group
    * \return A vector containing any matches that were found
    */
   match_vec_t sparseMatch(
-      const cost_matrix_t& costs,
-      float maxCost);
+      const point_vec_t& pointsA,
+      const point_vec_t& pointsB,
+      float maxDR,
+      Solver solver = Solver::Automatic);
+
+  /**
+   * \name Overloads for any Eigen expression
+   *
+   * The dense matching functions accept any Eigen expression holding one of
+   * the cost types.
+   * Matrices of either storage order, blocks and transposes are used without
+   * a copy.
+   */
+  ///@{
+  template <typename Derived>
+    match_vec_t match(
+        const Eigen::DenseBase<Derived>& costs,
+        typename Derived::Scalar maxCost =
+          CostTraits<typename Derived::Scalar>::unlimited(),
+        Solver solver = Solver::Automatic)
+    { return match(CostViewOf<Derived>(costs).view(), maxCost, solver); }
+
+  template <typename Derived>
+    const match_vec_t& match(
+        const Eigen::DenseBase<Derived>& costs,
+        typename Derived::Scalar maxCost,
+        BasicSolverWorkspace<typename Derived::Scalar>& workspace,
+        Solver solver = Solver::Automatic)
+    {
+      return match(
+          CostViewOf<Derived>(costs).view(), maxCost, workspace, solver);
+    }
+
+  template <typename Derived>
+    match_vec_t sparseMatch(
+        const Eigen::DenseBase<Derived>& costs,
+        typename Derived::Scalar maxCost,
+        Solver solver = Solver::Automatic)
+    { return sparseMatch(CostViewOf<Derived>(costs).view(), maxCost, solver); }
+
+  template <typename Derived>
+    const match_vec_t& sparseMatch(
+        const Eigen::DenseBase<Derived>& costs,
+        typename Derived::Scalar maxCost,
+        BasicSolverWorkspace<typename Derived::Scalar>& workspace,
+        Solver solver = Solver::Automatic)
+    {
+      return sparseMatch(
+          CostViewOf<Derived>(costs).view(), maxCost, workspace, solver);
+    }
+
+  template <typename Derived>
+    match_vec_t sparseMatch(
+        const Eigen::DenseBase<Derived>& costs,
+        typename Derived::Scalar maxCost,
+        ThreadPool& pool,
+        Solver solver = Solver::Automatic)
+    {
+      return sparseMatch(
+          CostViewOf<Derived>(costs).view(), maxCost, pool, solver);
+    }
+  ///@}
 
   /**
    * \brief Build a match from a list of (disjoint) sparse groups
    * \param The input sparse groups
+   * \param solver The engine to use for each group
+   *
+   * Groups that view the full cost matrix have their costs gathered into a
+   * single buffer, reused from group to group, just before they are solved.
+   */
+  template <typename T>
+    match_vec_t matchFromGroups(
+        const std::vector<BasicSparseGroup<T>>& groups,
+        Solver solver = Solver::Automatic);
+
+  /**
+   * \brief Build a match from a list of (disjoint) sparse groups, solving the
+   * groups in parallel
+   * \param The input sparse groups
+   * \param pool The threads to spread the groups over
+   * \param solver The engine to use for each group
+   *
+   * The largest groups are started first so that a single large group does
+   * not hold up the end of the matching. The result is the same, and in the
+   * same order, as the serial version.
+   */
+  template <typename T>
+    match_vec_t matchFromGroups(
+        const std::vector<BasicSparseGroup<T>>& groups,
+        ThreadPool& pool,
+        Solver solver = Solver::Automatic);
+
+  /**
+   * \brief Build a match from the groups of one event held in an arena
+   * \param arena The groups to solve
+   * \param workspace Scratch space for the solvers. The matches are kept in its
+   * sparseMatches member
+   * \param solver The engine to use for each group
+   * \return A reference to the matches, valid until the workspace is next used
+   *
+   * Together with BasicGroupArena::split this gives the same matches as
+   * sparseMatch with the same workspace, but the groups can be kept and
+   * inspected.
+   */
+  template <typename T>
+    const match_vec_t& matchFromGroups(
+        const BasicGroupArena<T>& arena,
+        BasicSolverWorkspace<T>& workspace,
+        Solver solver = Solver::Automatic);
+
+  /**
+   * \brief Perform a matching using the sparse implementation, with costs
+   * given by a function instead of a matrix
+   * \param nA The number of 'A' vertices
+   * \param nB The number of 'B' vertices
+   * \param cost Called as cost(ia, ib) to give the cost of a pair
+   * \param candidates Called as candidates(ia, visit). It must call visit(ib)
+   * for every 'B' vertex that could be within maxCost of ia
+   * \param maxCost The maximum cost for a match
+   * \param solver The engine to use for each group
+   * \return A vector containing any matches that were found
+   *
+   * The cost is only evaluated for the candidate pairs and only the edges at
+   * or below the max cost are kept (see SparseCostMatrix::fromFunction), so
+   * no dense matrix is built for the full problem.
+   */
+  template <typename CostFunc, typename CandidateFunc>
+    match_vec_t sparseMatch(
+        idx_t nA,
+        idx_t nB,
+        CostFunc&& cost,
+        CandidateFunc&& candidates,
+        float maxCost,
+        Solver solver = Solver::Automatic)
+    {
+      return matchFromGroups(
+          splitProblemIntoSparseGroups(SparseCostMatrix::fromFunction(
+              nA, nB, maxCost, cost, candidates) ),
+          solver);
+    }
+
+  /**
+   * \brief Perform a matching on costs given by a function, without splitting
+   * it into groups
+   * \param nA The number of 'A' vertices
+   * \param nB The number of 'B' vertices
+   * \param cost Called as cost(ia, ib) to give the cost of a pair
+   * \param candidates Called as candidates(ia, visit). It must call visit(ib)
+   * for every 'B' vertex that could be within maxCost of ia
+   * \param maxCost The maximum cost for a match
+   * \return A vector containing any matches that were found
+   *
+   * The stored edges are solved directly by the ShortestPathSolver.
    */
-  match_vec_t matchFromGroups(
-      const std::vector<SparseGroup>& groups);
+  template <typename CostFunc, typename CandidateFunc>
+    match_vec_t match(
+        idx_t nA,
+        idx_t nB,
+        CostFunc&& cost,
+        CandidateFunc&& candidates,
+        float maxCost)
+    {
+      return match(SparseCostMatrix::fromFunction(
+            nA, nB, maxCost, cost, candidates) );
+    }
 
 };
 
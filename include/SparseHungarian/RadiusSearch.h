@@ -0,0 +1,300 @@
+#ifndef SparseHungarian_RadiusSearch_H
+#define SparseHungarian_RadiusSearch_H
+
+#include "Defs.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+namespace SparseHungarian {
+  /**
+   * \brief The weighted euclidean distance, given the separation along each
+   * axis
+   */
+  template <std::size_t D>
+  struct EuclideanMetric {
+    /// The weight of each axis
+    std::array<float, D> weights;
+
+    /// Weight every axis equally
+    EuclideanMetric() { weights.fill(1); }
+
+    /// Use the given weights
+    explicit EuclideanMetric(const std::array<float, D>& weights)
+      : weights(weights) {}
+
+    float operator()(const std::array<float, D>& diffs) const
+    {
+      float sum = 0;
+      for (std::size_t axis = 0; axis < D; ++axis)
+        sum += weights[axis] * weights[axis] * diffs[axis] * diffs[axis];
+      return std::sqrt(sum);
+    }
+  };
+
+  /**
+   * \brief The largest weighted separation along any axis
+   */
+  template <std::size_t D>
+  struct ChebyshevMetric {
+    /// The weight of each axis
+    std::array<float, D> weights;
+
+    /// Weight every axis equally
+    ChebyshevMetric() { weights.fill(1); }
+
+    /// Use the given weights
+    explicit ChebyshevMetric(const std::array<float, D>& weights)
+      : weights(weights) {}
+
+    float operator()(const std::array<float, D>& diffs) const
+    {
+      float largest = 0;
+      for (std::size_t axis = 0; axis < D; ++axis)
+        largest = std::max(largest, weights[axis] * diffs[axis]);
+      return largest;
+    }
+  };
+
+  /**
+   * \brief Find the points of a set within a radius of a query point, in a
+   * space of a few dimensions
+   *
+   * The points are held in a k-d tree, built in O(n log n), whose nodes keep
+   * the bounding box of their points. A query skips any node whose box is
+   * further than the radius away, so it visits O(log n) nodes plus the
+   * points near the query.
+   *
+   * The metric is called with the absolute separation along each axis and
+   * must not decrease as any one of them grows, which is what allows a
+   * whole box to be skipped. EuclideanMetric and ChebyshevMetric are
+   * provided, both with weights for the axes. Axes with a non-zero period
+   * wrap around, as phi does.
+   *
+   * This works well up to about six dimensions. Beyond that most boxes come
+   * within the radius and the tree does little better than a full scan.
+   */
+  template <std::size_t D, typename Metric = EuclideanMetric<D>>
+  class RadiusSearch {
+    static_assert(D > 0, "RadiusSearch needs at least one dimension");
+    public:
+      /// A point
+      using point_t = std::array<float, D>;
+
+      /**
+       * \brief Build the tree
+       * \param points The points to search. They are copied
+       * \param radius The largest distance to search to
+       * \param metric The metric measuring distances
+       * \param periods The period of each axis, or 0 if it doesn't wrap
+       */
+      RadiusSearch(
+          const std::vector<point_t>& points,
+          float radius,
+          const Metric& metric = Metric(),
+          const point_t& periods = point_t{})
+        : m_radius(radius), m_metric(metric), m_periods(periods)
+      {
+        m_points.reserve(points.size() );
+        for (const point_t& point : points)
+          m_points.push_back(wrap(point) );
+        m_order.resize(points.size() );
+        for (std::size_t ip = 0; ip < points.size(); ++ip)
+          m_order[ip] = ip;
+        if (!points.empty() ) {
+          m_nodes.resize(1);
+          build(0, 0, points.size() );
+        }
+      }
+
+      /// The number of points
+      std::size_t size() const { return m_points.size(); }
+
+      /// The largest distance searched to
+      float radius() const { return m_radius; }
+
+      /// The distance between two points
+      float distance(const point_t& lhs, const point_t& rhs) const
+      {
+        point_t diffs;
+        for (std::size_t axis = 0; axis < D; ++axis) {
+          float diff = std::fabs(lhs[axis] - rhs[axis]);
+          if (m_periods[axis] > 0) {
+            diff = std::fmod(diff, m_periods[axis]);
+            diff = std::min(diff, m_periods[axis] - diff);
+          }
+          diffs[axis] = diff;
+        }
+        return m_metric(diffs);
+      }
+
+      /**
+       * \brief Find the candidates near a point
+       * \param query The point to search around
+       * \param visit Called with the index of each candidate
+       *
+       * Every point within the radius is visited, once, along with some that
+       * share a leaf of the tree with them. This is the candidate generator
+       * for SparseCostMatrix::fromFunction, which computes the distances and
+       * drops the rest.
+       */
+      template <typename Visit>
+        void candidates(const point_t& query, Visit&& visit) const
+        {
+          if (m_nodes.empty() )
+            return;
+          point_t point = wrap(query);
+          std::size_t stack[64];
+          std::size_t depth = 0;
+          stack[depth++] = 0;
+          while (depth > 0) {
+            const Node& node = m_nodes[stack[--depth]];
+            if (gap(node, point) > m_radius)
+              continue;
+            if (node.left == 0) {
+              for (std::size_t ip = node.begin; ip < node.end; ++ip)
+                visit(m_order[ip]);
+            }
+            else {
+              stack[depth++] = node.left + 1;
+              stack[depth++] = node.left;
+            }
+          }
+        }
+
+    private:
+      /// A node of the tree, covering a range of m_order
+      struct Node {
+        /// The first point
+        std::size_t begin;
+        /// One past the last point
+        std::size_t end;
+        /// The first child, 0 for a leaf. The second child follows it
+        std::size_t left;
+        /// The bounding box of the points
+        point_t low;
+        point_t high;
+      };
+      /// The most points in a leaf
+      static constexpr std::size_t leafSize = 8;
+      float m_radius;
+      Metric m_metric;
+      point_t m_periods;
+      /// The points, with periodic axes wrapped into [0, period)
+      std::vector<point_t> m_points;
+      /// The points in tree order
+      std::vector<idx_t> m_order;
+      /// The nodes. The root is the first
+      std::vector<Node> m_nodes;
+
+      /// Move the periodic coordinates of a point into [0, period)
+      point_t wrap(point_t point) const
+      {
+        for (std::size_t axis = 0; axis < D; ++axis) {
+          if (m_periods[axis] > 0) {
+            point[axis] = std::fmod(point[axis], m_periods[axis]);
+            if (point[axis] < 0)
+              point[axis] += m_periods[axis];
+          }
+        }
+        return point;
+      }
+
+      /// Build the node in a slot for a range of m_order, and everything
+      /// below it
+      void build(std::size_t slot, std::size_t begin, std::size_t end)
+      {
+        point_t low = m_points[m_order[begin]];
+        point_t high = low;
+        for (std::size_t ip = begin + 1; ip < end; ++ip) {
+          const point_t& point = m_points[m_order[ip]];
+          for (std::size_t axis = 0; axis < D; ++axis) {
+            low[axis] = std::min(low[axis], point[axis]);
+            high[axis] = std::max(high[axis], point[axis]);
+          }
+        }
+        m_nodes[slot] = Node{begin, end, 0, low, high};
+        if (end - begin <= leafSize)
+          return;
+        // Split the widest axis at the median
+        std::size_t split = 0;
+        for (std::size_t axis = 1; axis < D; ++axis)
+          if (high[axis] - low[axis] > high[split] - low[split])
+            split = axis;
+        std::size_t middle = begin + (end - begin) / 2;
+        std::nth_element(
+            m_order.begin() + begin, m_order.begin() + middle,
+            m_order.begin() + end,
+            [this, split] (idx_t lhs, idx_t rhs) {
+              return m_points[lhs][split] < m_points[rhs][split];
+            });
+        // The two children sit next to each other
+        std::size_t left = m_nodes.size();
+        m_nodes[slot].left = left;
+        m_nodes.resize(left + 2);
+        build(left, begin, middle);
+        build(left + 1, middle, end);
+      }
+
+      /// The smallest distance from a point to anything in a node's box
+      float gap(const Node& node, const point_t& point) const
+      {
+        point_t diffs;
+        for (std::size_t axis = 0; axis < D; ++axis) {
+          float low = node.low[axis];
+          float high = node.high[axis];
+          float value = point[axis];
+          if (value >= low && value <= high)
+            diffs[axis] = 0;
+          else if (m_periods[axis] > 0) {
+            // The nearest part of the box is one of its ends, going either
+            // way around
+            float toLow = std::fabs(value - low);
+            float toHigh = std::fabs(value - high);
+            diffs[axis] = std::min(
+                std::min(toLow, m_periods[axis] - toLow),
+                std::min(toHigh, m_periods[axis] - toHigh) );
+          }
+          else
+            diffs[axis] = value < low ? low - value : value - high;
+        }
+        return m_metric(diffs);
+      }
+  };
+
+  /**
+   * \brief Build the sparse cost matrix between two sets of points, with the
+   * distance between them as the cost
+   * \param pointsA The points for set A (the rows)
+   * \param pointsB The points for set B (the columns)
+   * \param maxCost The largest distance for an edge to be kept
+   * \param metric The metric measuring distances
+   * \param periods The period of each axis, or 0 if it doesn't wrap
+   *
+   * The 'B' points are put in a RadiusSearch so finding the edges takes
+   * O(n log n) rather than comparing every pair. The result can be split into
+   * groups and solved like any other SparseCostMatrix.
+   */
+  template <std::size_t D, typename Metric = EuclideanMetric<D>>
+    SparseCostMatrix buildRadiusCosts(
+        const std::vector<std::array<float, D>>& pointsA,
+        const std::vector<std::array<float, D>>& pointsB,
+        float maxCost,
+        const Metric& metric = Metric(),
+        const std::array<float, D>& periods = std::array<float, D>{})
+    {
+      RadiusSearch<D, Metric> search(pointsB, maxCost, metric, periods);
+      return SparseCostMatrix::fromFunction(
+          pointsA.size(), pointsB.size(), maxCost,
+          [&] (idx_t ia, idx_t ib) {
+            return search.distance(pointsA[ia], pointsB[ib]);
+          },
+          [&] (idx_t ia, auto&& visit) {
+            search.candidates(pointsA[ia], visit);
+          });
+    }
+}
+
+#endif //> !SparseHungarian_RadiusSearch_H
@@ -0,0 +1,66 @@
+#ifndef SparseHungarian_ShortestPathSolver_H
+#define SparseHungarian_ShortestPathSolver_H
+
+#include "Defs.h"
+#include <vector>
+
+namespace SparseHungarian{
+  /**
+   * \brief Solve a matching problem given as a SparseCostMatrix
+   *
+   * This uses successive shortest paths: each 'A' vertex in turn is added to
+   * the matching along the cheapest augmenting path, found with Dijkstra's
+   * algorithm using the 'B' vertex prices as potentials. Each 'A' vertex can
+   * also stay unmatched, at a cost of maxCost, so no dense matrix is ever
+   * built and the work done scales with the number of stored edges rather
+   * than with nVtxB^2.
+   */
+  class ShortestPathSolver {
+    public:
+      /**
+       * \brief Create the solver, this also performs the matching as part of
+       * the constructor
+       * \param costs The problem's cost matrix. May have any shape. If its max
+       * cost is infinite then as many vertices as possible are matched.
+       */
+      ShortestPathSolver(const SparseCostMatrix& costs);
+
+      /// The number of vertices from set A
+      const idx_t nVtxA;
+      /// The number of vertices from set B
+      const idx_t nVtxB;
+      /// The solution to this problem
+      const match_vec_t& solution() const { return m_solution; }
+    private:
+      /// The cost matrix
+      const SparseCostMatrix& m_costs;
+      /// The cost of leaving an 'A' vertex unmatched
+      float m_unmatchedCost;
+      /// The prices of the 'B' vertices. Each 'A' vertex has its own extra 'B'
+      /// vertex, with index nVtxB + ia, which represents leaving it unmatched
+      std::vector<float> m_prices;
+      /// Matches from A to B vertices
+      std::vector<idx_t> m_matchA;
+      /// Matches from B to A vertices
+      std::vector<idx_t> m_matchB;
+      /// The cost of the edge each 'A' vertex is matched along
+      std::vector<float> m_matchCost;
+      /// The shortest distance found to each 'B' vertex in the current search
+      std::vector<float> m_dist;
+      /// The 'A' vertex preceding each 'B' vertex on its shortest path
+      std::vector<idx_t> m_pred;
+      /// The cost of the edge from that 'A' vertex
+      std::vector<float> m_predCost;
+      /// Whether each 'B' vertex has been finalised in the current search
+      std::vector<bool> m_done;
+      /// The 'B' vertices touched by the current search
+      std::vector<idx_t> m_touched;
+      /// The solution
+      match_vec_t m_solution;
+      /// Add an 'A' vertex to the matching along its shortest augmenting path
+      void augment(idx_t root);
+      /// Reset the search state for the next root
+      void resetSearch();
+  };
+}
+#endif //> !SparseHungarian_ShortestPathSolver_H
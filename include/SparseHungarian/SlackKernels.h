@@ -0,0 +1,82 @@
+#ifndef SparseHungarian_SlackKernels_H
+#define SparseHungarian_SlackKernels_H
+
+#include "Defs.h"
+#include <limits>
+
+namespace SparseHungarian {
+  /**
+   * \brief The inner loop of the HungarianSolver's incremental search
+   *
+   * The kernel scans one row of the (negated) cost matrix, lowering the slack
+   * of every 'B' vertex outside of the tree and finding the smallest slack
+   * left. 'B' vertices in the tree are marked by a special slack (see
+   * treeSlack), which none of the comparisons can pick, so no separate mask is
+   * needed.
+   *
+   * Vectorised versions are built for x86 compilers that support them and
+   * chosen at runtime according to what the CPU supports. All versions give
+   * identical results. Kernels exist for each of the cost types in
+   * CostTraits.
+   */
+  namespace SlackKernels {
+    /// The instruction sets that the kernels can use
+    enum class InstructionSet {
+      Scalar,
+      AVX2,
+      AVX512
+    };
+
+    /**
+     * \brief The signature of a kernel
+     * \param costs The row of the cost matrix for the current 'A' vertex
+     * \param labelA The label of the current 'A' vertex
+     * \param labelsB The labels of the 'B' vertices
+     * \param[in,out] slacks The slacks of the 'B' vertices. treeSlack() for
+     * those in the tree
+     * \param[in,out] minSlackIdx The 'A' vertex giving each slack
+     * \param current The index of the current 'A' vertex
+     * \param n The number of 'B' vertices
+     * \param[out] delta The smallest slack outside of the tree
+     * \return The first 'B' vertex with that slack, or n if there is none
+     */
+    template <typename T>
+      using kernel_t = idx_t (*)(
+          const T* costs,
+          T labelA,
+          const T* labelsB,
+          T* slacks,
+          idx_t* minSlackIdx,
+          idx_t current,
+          idx_t n,
+          T& delta);
+
+    /**
+     * \brief The slack marking a 'B' vertex in the tree
+     *
+     * This is NaN for floating point types. Integer types use their lowest
+     * value, which the kernels treat in the same way as a NaN: it is never
+     * less than anything so is neither updated nor picked as the minimum.
+     */
+    template <typename T>
+      constexpr T treeSlack()
+      {
+        return std::numeric_limits<T>::has_quiet_NaN ?
+          std::numeric_limits<T>::quiet_NaN() :
+          std::numeric_limits<T>::lowest();
+      }
+
+    /// The best instruction set supported by this CPU and build
+    InstructionSet bestInstructionSet();
+
+    /// Get the kernel for an instruction set. Throws if the instruction set
+    /// is not supported
+    template <typename T>
+      kernel_t<T> getKernel(InstructionSet instructionSet);
+
+    /// The kernel chosen for this CPU
+    template <typename T>
+      kernel_t<T> bestKernel();
+  }
+}
+#endif //> !SparseHungarian_SlackKernels_H
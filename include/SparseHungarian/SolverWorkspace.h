@@ -0,0 +1,146 @@
+#ifndef SparseHungarian_SolverWorkspace_H
+#define SparseHungarian_SolverWorkspace_H
+
+#include "Defs.h"
+#include <vector>
+#include <new>
+#include <cstdint>
+#include <algorithm>
+
+namespace SparseHungarian {
+  /// The size of a cache line in bytes
+  const std::size_t cacheLineSize = 64;
+
+  /**
+   * \brief An allocator whose memory starts on a cache line
+   */
+  template <typename T>
+  struct CacheAlignedAllocator {
+    using value_type = T;
+    CacheAlignedAllocator() {}
+    template <typename U>
+      CacheAlignedAllocator(const CacheAlignedAllocator<U>&) {}
+
+    T* allocate(std::size_t n)
+    {
+      // Over-allocate and store the original pointer just before the aligned
+      // block
+      char* raw = static_cast<char*>(::operator new(
+            n * sizeof(T) + cacheLineSize + sizeof(void*) ) );
+      std::uintptr_t aligned = reinterpret_cast<std::uintptr_t>(
+          raw + sizeof(void*) + cacheLineSize - 1) & ~(cacheLineSize - 1);
+      reinterpret_cast<void**>(aligned)[-1] = raw;
+      return reinterpret_cast<T*>(aligned);
+    }
+
+    void deallocate(T* ptr, std::size_t)
+    {
+      ::operator delete(reinterpret_cast<void**>(ptr)[-1]);
+    }
+
+    template <typename U>
+      bool operator==(const CacheAlignedAllocator<U>&) const { return true; }
+    template <typename U>
+      bool operator!=(const CacheAlignedAllocator<U>&) const { return false; }
+  };
+
+  /// A working copy of a cost matrix. Row-major, starting on a cache line and
+  /// with each row padded to a whole number of cache lines
+  template <typename T>
+    using basic_padded_matrix_t = Eigen::Map<
+      Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>,
+      Eigen::Aligned64, Eigen::OuterStride<>>;
+  using padded_matrix_t = basic_padded_matrix_t<float>;
+
+  /**
+   * \brief Scratch space that can be reused between solves
+   *
+   * The solvers and the matching functions normally allocate all of their
+   * working memory for each problem. If they are given a workspace instead
+   * they keep everything in its buffers, which only ever grow, so after the
+   * first few problems of a given size no further allocations are made.
+   *
+   * The members are only meaningful to the code using them and their contents
+   * are overwritten by each solve. A workspace must not be used by two solves
+   * at the same time. Its cost type must match that of the problems it is
+   * used for.
+   */
+  template <typename T>
+  struct BasicSolverWorkspace {
+    /// The solvers' working copy of the cost matrix
+    std::vector<T, CacheAlignedAllocator<T>> costs;
+    /// The labels (or prices) of the 'A' vertices
+    std::vector<T> labelsA;
+    /// The labels (or prices) of the 'B' vertices
+    std::vector<T> labelsB;
+    /// Matches from A to B vertices
+    std::vector<idx_t> matchA;
+    /// Matches from B to A vertices
+    std::vector<idx_t> matchB;
+    /// Which 'B' vertices have been visited by a search
+    std::vector<bool> visitedB;
+    /// The search in which each 'B' vertex was last visited. Comparing with
+    /// the current epoch marks them all unvisited in O(1)
+    std::vector<std::size_t> visitStamps;
+    /// The current search
+    std::size_t epoch = 0;
+    /// The 'A' vertex through which each visited 'B' vertex joined the search
+    std::vector<idx_t> treePredecessors;
+    /// The slack or distance of each 'B' vertex in a search
+    std::vector<T> slacks;
+    /// The 'A' vertex preceding each 'B' vertex in a search
+    std::vector<idx_t> predecessors;
+    /// Lists of 'A' vertices used by the searches
+    std::vector<idx_t> listA;
+    /// Lists of 'B' vertices used by the searches
+    std::vector<idx_t> listB;
+    /// The solution found by a solver
+    match_vec_t solution;
+
+    /// Which 'B' vertices are used by the greedy matching
+    std::vector<bool> usedB;
+    /// The result of match
+    match_vec_t matches;
+
+    /// The disjoint set forest used to find the groups
+    std::vector<idx_t> parents;
+    /// The ranks of the disjoint sets
+    std::vector<unsigned char> ranks;
+    /// The group of each vertex. 'B' vertices have index idx + nVtxA
+    std::vector<idx_t> groupOf;
+    /// Where each group's 'A' indices start in groupIndicesA
+    std::vector<std::size_t> groupOffsetsA;
+    /// The 'A' indices of each group
+    std::vector<idx_t> groupIndicesA;
+    /// Where each group's 'B' indices start in groupIndicesB
+    std::vector<std::size_t> groupOffsetsB;
+    /// The 'B' indices of each group
+    std::vector<idx_t> groupIndicesB;
+    /// The cost matrix of the group being solved
+    std::vector<T> groupCosts;
+    /// The result of sparseMatch
+    match_vec_t sparseMatches;
+
+    /// The number of groups found
+    std::size_t nGroups() const
+    { return groupOffsetsA.empty() ? 0 : groupOffsetsA.size() - 1; }
+
+    /**
+     * \brief Lay out the working copy of an nRows x nCols cost matrix
+     *
+     * The contents of the matrix are not initialised.
+     */
+    basic_padded_matrix_t<T> paddedCosts(idx_t nRows, idx_t nCols)
+    {
+      const idx_t lineSize = cacheLineSize / sizeof(T);
+      idx_t stride = (nCols + lineSize - 1) / lineSize * lineSize;
+      // Never map a null pointer
+      costs.resize(std::max<idx_t>(nRows * stride, 1) );
+      return basic_padded_matrix_t<T>(
+          costs.data(), nRows, nCols, Eigen::OuterStride<>(stride) );
+    }
+  };
+
+  using SolverWorkspace = BasicSolverWorkspace<float>;
+}
+#endif //> !SparseHungarian_SolverWorkspace_H
@@ -3,8 +3,11 @@
 
 #include <vector>
 #include <set>
+#include <stdexcept>
+#include <functional>
 //#include "SparseHungarian/Defs.h"
 #include "Defs.h"
+#include "SolverWorkspace.h"
 
 namespace SparseHungarian {
   /**
@@ -16,36 +19,252 @@ namespace SparseHungarian {
    * to match them individually, therefore decreasing the runtime of the
    * matching process.
    */
-  class SparseGroup {
+  template <typename T>
+  class BasicSparseGroup {
     public:
-      SparseGroup() {}
+      BasicSparseGroup() {}
       /// The subset of indices from set A in the group
       std::vector<idx_t> indicesA;
       /// The subset of indices from set B in the group
       std::vector<idx_t> indicesB;
-      /// The costs between the members of this group
-      cost_matrix_t costs;
+      /// The costs between the members of this group. Empty for a group
+      /// that views the full costs instead, see viewCosts
+      basic_cost_matrix_t<T> costs;
       /// The maximum cost in this problem
-      float maxCost;
+      T maxCost{CostTraits<T>::unlimited()};
+      /**
+       * \brief The positions in indicesA and indicesB of the only match in a
+       * star group, (-1, -1) for any other group
+       *
+       * A star group has a single 'A' or 'B' vertex so its best matching is
+       * just its cheapest edge. These groups are solved as they are found and
+       * are not given a cost matrix.
+       */
+      match_t starMatch{-1, -1};
+      /// Whether this is a star group that was solved as it was found
+      bool isStar() const { return starMatch.first != -1; }
       /**
        * \brief build the cost matrix for this group
        * \param fullCosts The cost matrix for the full matching problem
        * \param maxCost The maximum cost in the problem
        */
       void buildCosts(
-         const cost_matrix_t& costs,
-         float maxCost);
+         const basic_cost_view_t<T>& costs,
+         T maxCost);
+
+      /// Build the cost matrix for this group from any Eigen expression
+      template <typename Derived>
+        void buildCosts(
+            const Eigen::DenseBase<Derived>& costs,
+            T maxCost)
+        { buildCosts(CostViewOf<Derived>(costs).view(), maxCost); }
+
+      /**
+       * \brief Read this group's costs straight from the full matrix instead
+       * of copying them
+       * \param fullCosts The cost matrix for the full matching problem. This
+       * must outlive the group
+       * \param maxCost The maximum cost in the problem
+       */
+      void viewCosts(
+         const basic_cost_view_t<T>& fullCosts,
+         T maxCost);
+
+      /// Whether this group views the full costs rather than holding a copy
+      bool isView() const { return m_fullData != nullptr; }
+
+      /// The full problem's costs, for a group made by viewCosts
+      basic_cost_view_t<T> fullCosts() const
+      {
+        return basic_cost_view_t<T>(m_fullData, m_fullRows, m_fullCols,
+            Eigen::Stride<Eigen::Dynamic, Eigen::Dynamic>(
+              m_fullOuterStride, m_fullInnerStride) );
+      }
+
+      /// The group's costs read through the full matrix without a copy, for a
+      /// group made by viewCosts
+      auto costView() const { return fullCosts()(indicesA, indicesB); }
+
+      /**
+       * \brief Get a view of the group's costs that the solvers can take
+       * \param buffer Receives the group's costs if they are not stored here
+       *
+       * A group that owns its costs is viewed where it is. The costs of a
+       * group that views the full matrix are gathered into the buffer, which
+       * can be reused from group to group.
+       */
+      basic_cost_view_t<T> gatherCosts(std::vector<T>& buffer) const;
+
+      /**
+       * \brief Solve a group with a single 'A' or 'B' vertex without building
+       * its cost matrix
+       * \param fullCosts The cost matrix for the full matching problem
+       * \param maxCost The maximum cost in the problem
+       */
+      void solveStar(
+         const basic_cost_view_t<T>& costs,
+         T maxCost);
+    private:
+      /// The full problem's costs for a group made by viewCosts. Stored
+      /// unpacked as a Map can't be reassigned to look at other data
+      const T* m_fullData = nullptr;
+      idx_t m_fullRows = 0;
+      idx_t m_fullCols = 0;
+      idx_t m_fullOuterStride = 0;
+      idx_t m_fullInnerStride = 0;
+  };
+
+  /// A group with float costs
+  using SparseGroup = BasicSparseGroup<float>;
+
+  extern template class BasicSparseGroup<float>;
+  extern template class BasicSparseGroup<double>;
+  extern template class BasicSparseGroup<std::int32_t>;
+  extern template class BasicSparseGroup<std::int64_t>;
+
+  /**
+   * \brief Find the cheapest edge between two subsets of the vertices
+   * \param costs The costs for the full matching problem
+   * \param indicesA The 'A' vertices in the subset
+   * \param nA The number of 'A' vertices in the subset
+   * \param indicesB The 'B' vertices in the subset
+   * \param nB The number of 'B' vertices in the subset
+   * \return The positions in indicesA and indicesB of the first cheapest edge,
+   * taking the 'A' vertices in order
+   *
+   * This is the whole matching for a group with a single 'A' or 'B' vertex.
+   */
+  template <typename T>
+    match_t cheapestEdge(
+        const basic_cost_view_t<T>& costs,
+        const idx_t* indicesA,
+        idx_t nA,
+        const idx_t* indicesB,
+        idx_t nB);
+
+  /**
+   * \brief The algorithms available to find the groups in a dense problem
+   */
+  enum class GroupingAlgorithm {
+    /// A breadth first search from each ungrouped 'A' vertex
+    BreadthFirst,
+    /// A single sweep over the matrix merging disjoint sets
+    UnionFind
+  };
 
+  /**
+   * \brief How the groups of a dense problem get their costs
+   */
+  enum class GroupCosts {
+    /// Copy each group's costs into its own matrix
+    Copy,
+    /// Keep a view of the full matrix, which must outlive the groups. The
+    /// costs are gathered only while a group is being solved
+    View
   };
 
   /**
    * \brief Split a problem into SparseGroups
    * \param costs The costs for this matching problem
    * \param maxCost The maximum cost in this matching problem
+   * \param algorithm The algorithm used to find the groups
+   * \param groupCosts Whether the groups copy or view their costs
+   *
+   * Both algorithms produce the same groups, in order of their lowest 'A'
+   * index. The breadth first search lists the indices in each group in the
+   * order they were found, the union-find in increasing order. Star groups
+   * are solved as they are found, see BasicSparseGroup::starMatch.
+   */
+  template <typename T>
+    std::vector<BasicSparseGroup<T>> splitProblemIntoSparseGroups(
+        const basic_cost_view_t<T>& costs,
+        std::common_type_t<T> maxCost,
+        GroupingAlgorithm algorithm = GroupingAlgorithm::BreadthFirst,
+        GroupCosts groupCosts = GroupCosts::Copy);
+
+  /// Split a problem given by any Eigen expression into SparseGroups. Only
+  /// expressions stored in memory can be viewed by the groups
+  template <typename Derived>
+    std::vector<BasicSparseGroup<typename Derived::Scalar>>
+    splitProblemIntoSparseGroups(
+        const Eigen::DenseBase<Derived>& costs,
+        typename Derived::Scalar maxCost,
+        GroupingAlgorithm algorithm = GroupingAlgorithm::BreadthFirst,
+        GroupCosts groupCosts = GroupCosts::Copy)
+    {
+      if (groupCosts == GroupCosts::View &&
+          !(Eigen::DenseBase<Derived>::Flags & Eigen::DirectAccessBit) )
+        throw std::runtime_error(
+            "Groups can only view costs that are stored in memory");
+      return splitProblemIntoSparseGroups(
+          CostViewOf<Derived>(costs).view(), maxCost, algorithm, groupCosts);
+    }
+
+  /**
+   * \brief Find the groups of a problem one at a time, handing each over as
+   * soon as it is complete
+   * \param costs The costs for this matching problem
+   * \param maxCost The maximum cost in this matching problem
+   * \param onGroup Called with each group. It may move from the group
+   * \param groupCosts Whether the groups copy or view their costs
+   *
+   * This is the breadth first search used by splitProblemIntoSparseGroups, so
+   * the groups arrive in the same order and with the same contents.
+   */
+  template <typename T>
+    void streamSparseGroups(
+        const basic_cost_view_t<T>& costs,
+        std::common_type_t<T> maxCost,
+        const std::function<void(BasicSparseGroup<T>&)>& onGroup,
+        GroupCosts groupCosts = GroupCosts::Copy);
+
+  /**
+   * \brief Find the groups of a problem without building them
+   * \param costs The costs for this matching problem
+   * \param maxCost The maximum cost in this matching problem
+   * \param workspace Receives the groups, in its groupOffsetsA/B and
+   * groupIndicesA/B members. No other allocations are made.
+   *
+   * This is the union-find algorithm, so the groups are in order of their
+   * lowest 'A' index with their indices in increasing order.
+   */
+  template <typename T>
+    void findSparseGroups(
+        const basic_cost_view_t<T>& costs,
+        std::common_type_t<T> maxCost,
+        BasicSolverWorkspace<T>& workspace);
+
+  /// Find the groups of a problem given by any Eigen expression
+  template <typename Derived>
+    void findSparseGroups(
+        const Eigen::DenseBase<Derived>& costs,
+        typename Derived::Scalar maxCost,
+        BasicSolverWorkspace<typename Derived::Scalar>& workspace)
+    { findSparseGroups(CostViewOf<Derived>(costs).view(), maxCost, workspace); }
+
+  /**
+   * \brief Split a problem given by a sparse cost matrix into SparseGroups
+   * \param costs The costs for this matching problem
+   *
+   * Entries of the group cost matrices that are not in the sparse matrix are
+   * set to infinity. Star groups are solved as they are found.
+   */
+  std::vector<SparseGroup> splitProblemIntoSparseGroups(
+      const SparseCostMatrix& costs);
+
+  /**
+   * \brief Split a problem matching points in eta-phi by deltaR into
+   * SparseGroups
+   * \param pointsA The points in set A
+   * \param pointsB The points in set B
+   * \param maxDR The maximum deltaR for a match
+   *
+   * This never builds the full cost matrix, see buildDeltaRCosts.
    */
   std::vector<SparseGroup> splitProblemIntoSparseGroups(
-      const cost_matrix_t& costs,
-      float maxCost);
+      const point_vec_t& pointsA,
+      const point_vec_t& pointsB,
+      float maxDR);
 }
 
 #endif //> !SparseHungarian_SparseGroup_H
@@ -0,0 +1,92 @@
+#ifndef SparseHungarian_StreamingMatcher_H
+#define SparseHungarian_StreamingMatcher_H
+
+#include "Defs.h"
+#include "Matching.h"
+#include "DeltaRMatcher.h"
+#include "EventFile.h"
+#include "ThreadPool.h"
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace SparseHungarian {
+  /**
+   * \brief Match a stream of deltaR events of any length in parallel, with a
+   * bounded number of events in memory
+   *
+   * Events are pulled from a source one at a time, solved on a pool of
+   * threads and handed to a sink in the order they were read. At most
+   * window() events are held at once, counting those being solved and those
+   * waiting for an earlier event to finish before they can be written, so
+   * the memory used doesn't grow with the length of the stream. Reading and
+   * writing happen on whichever thread is free while the others keep
+   * solving, but are never done by two threads at once.
+   *
+   * Each event is solved exactly as DeltaRMatcher::match would solve it. The
+   * threads, the event buffers and the matchers are kept between calls. It
+   * must only be used from one thread at a time.
+   */
+  class StreamingMatcher {
+    public:
+      /**
+       * \brief Fill in the next event
+       *
+       * Returns false once there are no more. The event's buffers are reused,
+       * so it holds whatever it was last filled with.
+       */
+      using source_t = std::function<bool(EventData&)>;
+      /// Receive the matches for an event, given its position in the stream
+      using sink_t = std::function<void(std::size_t, const match_vec_t&)>;
+
+      /**
+       * \brief Create the matcher
+       * \param nThreads The number of threads to use. If 0 then the hardware
+       * concurrency is used
+       * \param window The most events held at once. If 0 then four per thread
+       * \param solver The engine to use for each group
+       */
+      StreamingMatcher(
+          std::size_t nThreads = 0,
+          std::size_t window = 0,
+          Solver solver = Solver::Automatic);
+
+      /// The number of threads used
+      std::size_t nThreads() const { return m_pool.size(); }
+
+      /// The most events held at once
+      std::size_t window() const { return m_slots.size(); }
+
+      /**
+       * \brief Match every event from a source
+       * \param source Provides the events
+       * \param sink Receives the matches, in order
+       * \return The number of events matched
+       *
+       * The source and the sink are only called by one thread at a time. If
+       * either of them or a solver throws then no more events are read and
+       * the exception is rethrown once the threads have stopped.
+       */
+      std::size_t run(const source_t& source, const sink_t& sink);
+
+      /// The engine used for each group
+      const Solver solver;
+    private:
+      /// An event in flight
+      struct Slot {
+        /// The event
+        EventData event;
+        /// Its matches
+        match_vec_t matches;
+        /// Whether the matches are ready to write
+        bool done = false;
+      };
+      /// The threads
+      ThreadPool m_pool;
+      /// The buffers for the events in flight, used as a ring
+      std::vector<Slot> m_slots;
+      /// One matcher per thread, made for the maxDR of its last event
+      std::vector<std::unique_ptr<DeltaRMatcher>> m_matchers;
+  };
+}
+#endif //> !SparseHungarian_StreamingMatcher_H
@@ -0,0 +1,92 @@
+#ifndef SparseHungarian_ThreadPool_H
+#define SparseHungarian_ThreadPool_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace SparseHungarian {
+  /**
+   * \brief A fixed set of threads used to run independent tasks in parallel
+   *
+   * The threads are started when the pool is created and kept waiting until
+   * they are given work, so the pool can be reused for many problems without
+   * paying for thread creation each time.
+   */
+  class ThreadPool {
+    public:
+      /**
+       * \brief Create the pool
+       * \param nThreads The number of threads that run tasks, including the
+       * one that calls parallelFor. If 0 then the hardware concurrency is used
+       */
+      ThreadPool(std::size_t nThreads = 0);
+
+      /// Stop and join all of the threads
+      ~ThreadPool();
+
+      ThreadPool(const ThreadPool&) = delete;
+      ThreadPool& operator=(const ThreadPool&) = delete;
+
+      /// The number of threads that run tasks
+      std::size_t size() const { return m_workers.size() + 1; }
+
+      /**
+       * \brief Run task(0), ..., task(nTasks - 1), returning when all are done
+       *
+       * Tasks are handed out in increasing index order so callers can control
+       * the scheduling by how they number them. The calling thread also runs
+       * tasks. If any task throws then the first exception is rethrown here
+       * once all the running tasks have finished. Calls from several threads
+       * are run one after the other.
+       */
+      void parallelFor(
+          std::size_t nTasks,
+          const std::function<void(std::size_t)>& task);
+
+      /**
+       * \brief Run task(0, thread), ..., task(nTasks - 1, thread)
+       *
+       * As above, but each task is also told the index of the thread running
+       * it, in [0, size() ). The calling thread has index 0. No two tasks with
+       * the same thread index ever run at the same time, so this can be used to
+       * give each thread its own scratch space.
+       */
+      void parallelFor(
+          std::size_t nTasks,
+          const std::function<void(std::size_t, std::size_t)>& task);
+    private:
+      /// The worker threads
+      std::vector<std::thread> m_workers;
+      /// Serialises calls to parallelFor
+      std::mutex m_runMutex;
+      /// Protects the job description below
+      std::mutex m_mutex;
+      /// Wakes the workers when a job is posted or the pool is stopped
+      std::condition_variable m_wake;
+      /// Signals the caller when the last worker leaves a job
+      std::condition_variable m_finished;
+      /// Incremented for each new job
+      std::size_t m_generation;
+      /// The number of workers still working on the current job
+      std::size_t m_active;
+      /// Whether the pool is being destroyed
+      bool m_stop;
+      /// The current job
+      const std::function<void(std::size_t, std::size_t)>* m_task;
+      std::size_t m_nTasks;
+      std::atomic<std::size_t> m_next;
+      /// The first exception thrown by the current job
+      std::exception_ptr m_error;
+      /// The loop run by each worker
+      void workerLoop(std::size_t thread);
+      /// Run tasks from the current job until none are left
+      void runTasks(std::size_t thread);
+  };
+}
+#endif //> !SparseHungarian_ThreadPool_H
@@ -0,0 +1,144 @@
+#include "SparseHungarian/AuctionSolver.h"
+#include <algorithm>
+#include <cmath>
+
+namespace SparseHungarian {
+  AuctionSolver::AuctionSolver(
+      const cost_view_t& costs,
+      float maxCost,
+      float finalEpsilon,
+      float epsilonFactor,
+      float initialEpsilon)
+    :
+      nVtxA(costs.rows() ),
+      nVtxB(costs.cols() ),
+      m_maxCost(maxCost),
+      m_edgeOffsets(nVtxA + nVtxB + 1, 0),
+      m_prices(nVtxB + nVtxA, 0.),
+      m_matchA(nVtxA + nVtxB, nVtxB + nVtxA),
+      m_matchB(nVtxB + nVtxA, nVtxA + nVtxB),
+      m_bound(0)
+  {
+    if (!std::isfinite(m_maxCost) )
+      m_maxCost = costs.size() == 0 ? 1 : costs.maxCoeff() + 1;
+    // Build the list of edges for each 'A' vertex. Walk the matrix in its
+    // storage order, first counting the edges and then filling them. Every
+    // vertex has an edge to its own extra vertex, and each admissible edge
+    // also adds an edge between the two extra vertices.
+    for (idx_t ib = 0; ib < nVtxB; ++ib) {
+      for (idx_t ia = 0; ia < nVtxA; ++ia) {
+        if (costs.coeff(ia, ib) <= maxCost) {
+          ++m_edgeOffsets[ia + 1];
+          ++m_edgeOffsets[nVtxA + ib + 1];
+        }
+      }
+    }
+    for (idx_t ia = 0; ia < nVtxA + nVtxB; ++ia)
+      m_edgeOffsets[ia + 1] += m_edgeOffsets[ia] + 1;
+    m_edgeB.resize(m_edgeOffsets.back() );
+    m_benefits.resize(m_edgeOffsets.back(), 0.);
+    std::vector<std::size_t> next(m_edgeOffsets.begin(), m_edgeOffsets.end() - 1);
+    for (idx_t ia = 0; ia < nVtxA; ++ia)
+      m_edgeB[next[ia]++] = nVtxB + ia;
+    for (idx_t ib = 0; ib < nVtxB; ++ib) {
+      m_edgeB[next[nVtxA + ib]++] = ib;
+      for (idx_t ia = 0; ia < nVtxA; ++ia) {
+        float cost = costs.coeff(ia, ib);
+        if (cost > maxCost)
+          continue;
+        m_edgeB[next[ia]] = ib;
+        m_benefits[next[ia]++] = m_maxCost - cost;
+        m_edgeB[next[nVtxA + ib]++] = nVtxB + ia;
+      }
+    }
+
+    if (finalEpsilon <= 0)
+      finalEpsilon = 1e-5 * m_maxCost;
+    if (initialEpsilon <= 0)
+      initialEpsilon = 0.25 * m_maxCost;
+    m_epsilon = std::max(initialEpsilon, finalEpsilon);
+
+    // Run the auctions with decreasing epsilon, keeping the prices from one to
+    // the next
+    while (true) {
+      auction();
+      if (m_epsilon <= finalEpsilon || epsilonFactor <= 1)
+        break;
+      m_epsilon = std::max(finalEpsilon, m_epsilon / epsilonFactor);
+    }
+    m_bound = dualityGap();
+
+    // Now load the solution into the internal vector
+    for (idx_t ia = 0; ia < nVtxA; ++ia)
+      if (m_matchA[ia] < nVtxB)
+        m_solution.push_back(std::make_pair(ia, m_matchA[ia]) );
+  }
+
+  double AuctionSolver::bestValue(
+      idx_t a, idx_t& best, double& secondBest) const
+  {
+    best = nVtxB + nVtxA;
+    double value = -std::numeric_limits<double>::infinity();
+    secondBest = -std::numeric_limits<double>::infinity();
+    for (std::size_t e = m_edgeOffsets[a]; e < m_edgeOffsets[a + 1]; ++e) {
+      double edgeValue = m_benefits[e] - m_prices[m_edgeB[e]];
+      if (edgeValue > value) {
+        secondBest = value;
+        value = edgeValue;
+        best = m_edgeB[e];
+      }
+      else if (edgeValue > secondBest)
+        secondBest = edgeValue;
+    }
+    return value;
+  }
+
+  void AuctionSolver::auction()
+  {
+    idx_t nVtx = nVtxA + nVtxB;
+    std::fill(m_matchA.begin(), m_matchA.end(), nVtx);
+    std::fill(m_matchB.begin(), m_matchB.end(), nVtx);
+    std::vector<idx_t> unmatched;
+    unmatched.reserve(nVtx);
+    for (idx_t ia = nVtx - 1; ia >= 0; --ia)
+      unmatched.push_back(ia);
+    while (!unmatched.empty() ) {
+      idx_t ia = unmatched.back();
+      unmatched.pop_back();
+      idx_t best;
+      double secondBest;
+      double value = bestValue(ia, best, secondBest);
+      // Bid so that best is only epsilon better than the next best option. If
+      // there is no other option then there is no competition to outbid.
+      double bid = m_epsilon;
+      if (secondBest != -std::numeric_limits<double>::infinity() )
+        bid += value - secondBest;
+      m_prices[best] += bid;
+      idx_t previous = m_matchB[best];
+      if (previous != nVtx) {
+        m_matchA[previous] = nVtx;
+        unmatched.push_back(previous);
+      }
+      m_matchA[ia] = best;
+      m_matchB[best] = ia;
+    }
+  }
+
+  double AuctionSolver::dualityGap() const
+  {
+    // The dual solution is the prices plus the best value for each 'A' vertex
+    double primal = 0;
+    double dual = 0;
+    for (double price : m_prices)
+      dual += price;
+    for (idx_t ia = 0; ia < nVtxA + nVtxB; ++ia) {
+      idx_t best;
+      double secondBest;
+      dual += bestValue(ia, best, secondBest);
+      for (std::size_t e = m_edgeOffsets[ia]; e < m_edgeOffsets[ia + 1]; ++e)
+        if (m_edgeB[e] == m_matchA[ia])
+          primal += m_benefits[e];
+    }
+    return std::max(dual - primal, 0.);
+  }
+}
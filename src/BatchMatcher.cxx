@@ -0,0 +1,65 @@
+#include "SparseHungarian/BatchMatcher.h"
+#include <algorithm>
+
+namespace SparseHungarian {
+  BatchMatcher::BatchMatcher(std::size_t nThreads, Solver solver)
+    :
+      solver(solver),
+      m_pool(nThreads),
+      m_workspaces(m_pool.size() )
+  {}
+
+  template <typename F>
+    BatchResult BatchMatcher::run(std::size_t nEvents, F solveOne)
+    {
+      for (Workspace& workspace : m_workspaces) {
+        // Clearing keeps the capacity from previous batches
+        workspace.matches.clear();
+        workspace.records.clear();
+      }
+      m_pool.parallelFor(nEvents, [&] (std::size_t idx, std::size_t thread) {
+          Workspace& workspace = m_workspaces[thread];
+          const match_vec_t& eventMatches = solveOne(idx, workspace.solver);
+          workspace.records.push_back(
+              Record{idx, workspace.matches.size(), eventMatches.size()});
+          workspace.matches.insert(workspace.matches.end(),
+              eventMatches.begin(), eventMatches.end() );
+        });
+
+      // Lay the events out in order
+      BatchResult result;
+      result.offsets.assign(nEvents + 1, 0);
+      for (const Workspace& workspace : m_workspaces)
+        for (const Record& record : workspace.records)
+          result.offsets[record.event + 1] = record.size;
+      for (std::size_t ie = 0; ie < nEvents; ++ie)
+        result.offsets[ie + 1] += result.offsets[ie];
+      result.matches.resize(result.offsets.back() );
+      for (const Workspace& workspace : m_workspaces) {
+        for (const Record& record : workspace.records) {
+          auto start = workspace.matches.begin() + record.start;
+          std::copy(start, start + record.size,
+              result.matches.begin() + result.offsets[record.event]);
+        }
+      }
+      return result;
+    }
+
+  BatchResult BatchMatcher::match(const std::vector<MatrixEvent>& events)
+  {
+    return run(events.size(), [this, &events] (
+          std::size_t idx, SolverWorkspace& workspace) -> const match_vec_t& {
+        const MatrixEvent& event = events[idx];
+        return sparseMatch(*event.costs, event.maxCost, workspace, solver);
+      });
+  }
+
+  BatchResult BatchMatcher::match(const std::vector<PointEvent>& events)
+  {
+    return run(events.size(), [this, &events] (
+          std::size_t idx, SolverWorkspace&) {
+        const PointEvent& event = events[idx];
+        return sparseMatch(*event.pointsA, *event.pointsB, event.maxDR, solver);
+      });
+  }
+}
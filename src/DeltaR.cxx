@@ -0,0 +1,121 @@
+#include "SparseHungarian/DeltaR.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+  const float pi = 3.14159265358979323846;
+  const float twoPi = 2*pi;
+
+  // Move phi into [0, 2pi)
+  float wrapPhi(float phi)
+  {
+    phi = std::fmod(phi, twoPi);
+    return phi < 0 ? phi + twoPi : phi;
+  }
+}
+
+namespace SparseHungarian {
+  float deltaR(const point_t& a, const point_t& b)
+  {
+    float phiDiff = std::fmod(std::fabs(a.first - b.first), twoPi);
+    phiDiff = std::min(phiDiff, twoPi - phiDiff);
+    float etaDiff = a.second - b.second;
+    return std::sqrt(phiDiff*phiDiff + etaDiff*etaDiff);
+  }
+
+  SparseCostMatrix buildDeltaRCosts(
+      const point_vec_t& pointsA,
+      const point_vec_t& pointsB,
+      float maxDR)
+  {
+    SparseCostMatrix costs(pointsB.size(), maxDR);
+    costs.rowOffsets.reserve(pointsA.size() + 1);
+    if (pointsB.empty() ) {
+      for (std::size_t ia = 0; ia < pointsA.size(); ++ia)
+        costs.endRow();
+      return costs;
+    }
+
+    // Work out the grid. Each cell has to be at least maxDR wide so that all
+    // of a point's neighbours are in the adjacent cells. Don't let the number
+    // of cells grow far beyond the number of points.
+    float etaMin = std::numeric_limits<float>::infinity();
+    float etaMax = -std::numeric_limits<float>::infinity();
+    for (const point_vec_t* points : {&pointsA, &pointsB}) {
+      for (const point_t& p : *points) {
+        etaMin = std::min(etaMin, p.second);
+        etaMax = std::max(etaMax, p.second);
+      }
+    }
+    std::size_t maxCells = 4 * (pointsA.size() + pointsB.size() ) + 16;
+    float cellSize = maxDR;
+    std::size_t nPhiCells = 1;
+    std::size_t nEtaCells = 1;
+    if (std::isfinite(cellSize) && cellSize > 0) {
+      while (true) {
+        nPhiCells = std::max<std::size_t>(1, twoPi / cellSize);
+        nEtaCells = (etaMax - etaMin) / cellSize + 1;
+        if (nPhiCells * nEtaCells <= maxCells)
+          break;
+        cellSize *= 2;
+      }
+    }
+    float phiCellSize = twoPi / nPhiCells;
+    auto phiCell = [&] (const point_t& p) {
+      return std::min<std::size_t>(wrapPhi(p.first) / phiCellSize,
+          nPhiCells - 1);
+    };
+    auto etaCell = [&] (const point_t& p) {
+      return nEtaCells == 1 ? 0 : std::min<std::size_t>(
+          (p.second - etaMin) / cellSize, nEtaCells - 1);
+    };
+
+    // Bin the 'B' points into the cells with a counting sort
+    std::vector<std::size_t> cellOffsets(nPhiCells * nEtaCells + 1, 0);
+    std::vector<std::size_t> cellOfB(pointsB.size() );
+    for (std::size_t ib = 0; ib < pointsB.size(); ++ib) {
+      cellOfB[ib] = phiCell(pointsB[ib]) * nEtaCells + etaCell(pointsB[ib]);
+      ++cellOffsets[cellOfB[ib] + 1];
+    }
+    for (std::size_t ic = 1; ic < cellOffsets.size(); ++ic)
+      cellOffsets[ic] += cellOffsets[ic - 1];
+    std::vector<idx_t> cellPoints(pointsB.size() );
+    {
+      std::vector<std::size_t> next(cellOffsets.begin(), cellOffsets.end() - 1);
+      for (std::size_t ib = 0; ib < pointsB.size(); ++ib)
+        cellPoints[next[cellOfB[ib]]++] = ib;
+    }
+
+    // Now look for the neighbours of each 'A' point
+    std::vector<std::size_t> phiNeighbours;
+    auto candidates = [&] (idx_t ia, auto&& visit) {
+      const point_t& pa = pointsA[ia];
+      std::size_t iPhi = phiCell(pa);
+      // The phi cells wrap around, but make sure that we don't visit the same
+      // one twice when there are fewer than three
+      phiNeighbours.clear();
+      phiNeighbours.push_back(iPhi);
+      if (nPhiCells > 1)
+        phiNeighbours.push_back((iPhi + 1) % nPhiCells);
+      if (nPhiCells > 2)
+        phiNeighbours.push_back((iPhi + nPhiCells - 1) % nPhiCells);
+      std::size_t iEta = etaCell(pa);
+      std::size_t etaLow = iEta == 0 ? 0 : iEta - 1;
+      std::size_t etaHigh = std::min(iEta + 1, nEtaCells - 1);
+      for (std::size_t jPhi : phiNeighbours) {
+        for (std::size_t jEta = etaLow; jEta <= etaHigh; ++jEta) {
+          std::size_t cell = jPhi * nEtaCells + jEta;
+          for (std::size_t ip = cellOffsets[cell]; ip < cellOffsets[cell + 1];
+              ++ip)
+            visit(cellPoints[ip]);
+        }
+      }
+    };
+    // The edges are put back into column order so the output doesn't depend
+    // on the grid
+    return SparseCostMatrix::fromFunction(pointsA.size(), pointsB.size(),
+        maxDR,
+        [&] (idx_t ia, idx_t ib) { return deltaR(pointsA[ia], pointsB[ib]); },
+        candidates);
+  }
+}
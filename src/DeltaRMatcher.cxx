@@ -0,0 +1,160 @@
+#include "SparseHungarian/DeltaRMatcher.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+  const float pi = 3.14159265358979323846;
+  const float twoPi = 2*pi;
+
+  // Move phi into [0, 2pi)
+  float wrapPhi(float phi)
+  {
+    phi = std::fmod(phi, twoPi);
+    return phi < 0 ? phi + twoPi : phi;
+  }
+}
+
+namespace SparseHungarian {
+  DeltaRMatcher::DeltaRMatcher(float maxDR, Solver solver)
+    : m_maxDR(maxDR), m_solver(solver)
+  {}
+
+  const SparseCostMatrix& DeltaRMatcher::buildCosts(
+      const coords_t& phiA,
+      const coords_t& etaA,
+      const coords_t& phiB,
+      const coords_t& etaB)
+  {
+    if (phiA.size() != etaA.size() || phiB.size() != etaB.size() )
+      throw std::runtime_error("DeltaRMatcher given phi and eta arrays of "
+          "different sizes");
+    idx_t nA = phiA.size();
+    idx_t nB = phiB.size();
+
+    // Split the 'B' points into bands in phi at least maxDR wide, so only an
+    // 'A' point's own band and its two neighbours can hold its edges. Within
+    // a band the points are sorted in eta, so the points near an 'A' point
+    // are a contiguous window of each band. Don't make many more bands than
+    // there are points
+    idx_t nBands = 1;
+    if (std::isfinite(m_maxDR) && m_maxDR > 0)
+      nBands = std::max<idx_t>(1, std::min<double>(twoPi / m_maxDR, nB / 4) );
+    const float bandWidth = twoPi / nBands;
+    auto bandOf = [&] (float wrappedPhi) {
+      return std::min<idx_t>(wrappedPhi / bandWidth, nBands - 1);
+    };
+    m_order.resize(nB);
+    m_phiB.resize(nB);
+    m_dr2.resize(nB);
+    m_bandOffsets.assign(nBands + 1, 0);
+    for (idx_t ib = 0; ib < nB; ++ib) {
+      m_order[ib] = ib;
+      m_phiB[ib] = wrapPhi(phiB[ib]);
+      ++m_bandOffsets[bandOf(m_phiB[ib]) + 1];
+    }
+    for (idx_t band = 0; band < nBands; ++band)
+      m_bandOffsets[band + 1] += m_bandOffsets[band];
+    std::sort(m_order.begin(), m_order.end(), [&] (idx_t lhs, idx_t rhs) {
+        idx_t lhsBand = bandOf(m_phiB[lhs]);
+        idx_t rhsBand = bandOf(m_phiB[rhs]);
+        return lhsBand < rhsBand ||
+          (lhsBand == rhsBand && etaB[lhs] < etaB[rhs]);
+        });
+    // Lay the sorted points out contiguously
+    m_etaB.resize(nB);
+    for (idx_t ib = 0; ib < nB; ++ib) {
+      m_dr2[ib] = m_phiB[m_order[ib]];
+      m_etaB[ib] = etaB[m_order[ib]];
+    }
+    m_phiB.swap(m_dr2);
+
+    m_costs.nRows = 0;
+    m_costs.nCols = nB;
+    m_costs.maxCost = m_maxDR;
+    m_costs.rowOffsets.assign(1, 0);
+    m_costs.cols.clear();
+    m_costs.costs.clear();
+    // Widen the window and the pruning cut slightly so that rounding can't
+    // lose an edge. The square root makes the final decision
+    const float margin = 1 + 4 * std::numeric_limits<float>::epsilon();
+    const float window = m_maxDR * margin;
+    const float maxDR2 = m_maxDR * m_maxDR * margin;
+    idx_t bands[3];
+    for (idx_t ia = 0; ia < nA; ++ia) {
+      float phi = wrapPhi(phiA[ia]);
+      float eta = etaA[ia];
+      // The bands wrap around, but don't visit the same one twice when there
+      // are fewer than three
+      idx_t band = bandOf(phi);
+      idx_t nNeighbours = 0;
+      bands[nNeighbours++] = band;
+      if (nBands > 1)
+        bands[nNeighbours++] = (band + 1) % nBands;
+      if (nBands > 2)
+        bands[nNeighbours++] = (band + nBands - 1) % nBands;
+      for (idx_t ii = 0; ii < nNeighbours; ++ii) {
+        const float* etaBegin = m_etaB.data() + m_bandOffsets[bands[ii]];
+        const float* etaEnd = m_etaB.data() + m_bandOffsets[bands[ii] + 1];
+        const float* low = std::lower_bound(etaBegin, etaEnd, eta - window);
+        idx_t start = low - m_etaB.data();
+        idx_t n = std::upper_bound(low, etaEnd, eta + window) - low;
+        if (n == 0)
+          continue;
+        // Both phis are in [0, 2pi) so the difference needs no fmod
+        auto phiDiff = (m_phiB.segment(start, n) - phi).abs();
+        m_dr2.head(n) = phiDiff.min(twoPi - phiDiff).square() +
+          (m_etaB.segment(start, n) - eta).square();
+        for (idx_t jj = 0; jj < n; ++jj) {
+          if (m_dr2[jj] > maxDR2)
+            continue;
+          float dr = std::sqrt(m_dr2[jj]);
+          if (dr <= m_maxDR)
+            m_costs.addEdge(m_order[start + jj], dr);
+        }
+      }
+      m_costs.endRow();
+    }
+
+    // Put the edges of each row back into column order. Sorting each row is
+    // slower than a counting sort into columns and back
+    std::size_t nEdges = m_costs.nEdges();
+    m_colOffsets.assign(nB + 1, 0);
+    for (idx_t ib : m_costs.cols)
+      ++m_colOffsets[ib + 1];
+    for (idx_t ib = 0; ib < nB; ++ib)
+      m_colOffsets[ib + 1] += m_colOffsets[ib];
+    m_colRows.resize(nEdges);
+    m_colCosts.resize(nEdges);
+    m_next.assign(m_colOffsets.begin(), m_colOffsets.end() - 1);
+    for (idx_t ia = 0; ia < nA; ++ia) {
+      for (std::size_t ie = m_costs.rowOffsets[ia];
+          ie < m_costs.rowOffsets[ia + 1]; ++ie) {
+        std::size_t pos = m_next[m_costs.cols[ie]]++;
+        m_colRows[pos] = ia;
+        m_colCosts[pos] = m_costs.costs[ie];
+      }
+    }
+    m_next.assign(m_costs.rowOffsets.begin(), m_costs.rowOffsets.end() - 1);
+    for (idx_t ib = 0; ib < nB; ++ib) {
+      for (std::size_t ie = m_colOffsets[ib]; ie < m_colOffsets[ib + 1]; ++ie) {
+        std::size_t pos = m_next[m_colRows[ie]]++;
+        m_costs.cols[pos] = ib;
+        m_costs.costs[pos] = m_colCosts[ie];
+      }
+    }
+    return m_costs;
+  }
+
+  match_vec_t DeltaRMatcher::match(
+      const coords_t& phiA,
+      const coords_t& etaA,
+      const coords_t& phiB,
+      const coords_t& etaB)
+  {
+    buildCosts(phiA, etaA, phiB, etaB);
+    m_groups = splitProblemIntoSparseGroups(m_costs);
+    return matchFromGroups(m_groups, m_solver);
+  }
+}
@@ -0,0 +1,569 @@
+#include "SparseHungarian/DynamicAssignment.h"
+#include "SparseHungarian/HungarianSolver.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace SparseHungarian {
+  template <typename T>
+  BasicDynamicAssignment<T>::BasicDynamicAssignment(T maxCost)
+    : m_maxCost(maxCost)
+  {}
+
+  template <typename T>
+  BasicDynamicAssignment<T>::BasicDynamicAssignment(
+      const basic_cost_view_t<T>& costs,
+      T maxCost)
+    : m_maxCost(maxCost)
+  {
+    // Make the space while the problem is still empty, so there is nothing to
+    // copy
+    reserve(std::max(costs.rows(), costs.cols() ) );
+    m_nA = costs.rows();
+    m_nB = costs.cols();
+    m_size = std::max(m_nA, m_nB);
+    std::fill(m_workspace.costs.begin(), m_workspace.costs.end(), 0);
+    for (idx_t ia = 0; ia < m_nA; ++ia) {
+      for (idx_t ib = 0; ib < m_nB; ++ib) {
+        cost(ia, ib) = costs.coeff(ia, ib);
+        working(ia, ib) = -std::min(costs.coeff(ia, ib), maxCost);
+      }
+    }
+    // Start from the same labels as the HungarianSolver and add the rows one
+    // at a time
+    m_workspace.labelsA.resize(m_size);
+    m_workspace.labelsB.assign(m_size, 0);
+    m_workspace.matchA.assign(m_size, m_size);
+    m_workspace.matchB.assign(m_size, m_size);
+    for (idx_t ia = 0; ia < m_size; ++ia)
+      m_workspace.labelsA[ia] = workingCosts().row(ia).maxCoeff();
+    repair();
+    // The union-find grouping lists the indices in increasing order
+    m_groupOfA.assign(m_nA, -1);
+    m_groupOfB.assign(m_nB, -1);
+    findSparseGroups(this->costs(), maxCost, m_workspace);
+    for (std::size_t ig = 0; ig < m_workspace.nGroups(); ++ig) {
+      Group group;
+      group.indicesA.assign(
+          m_workspace.groupIndicesA.begin() + m_workspace.groupOffsetsA[ig],
+          m_workspace.groupIndicesA.begin() + m_workspace.groupOffsetsA[ig + 1]);
+      group.indicesB.assign(
+          m_workspace.groupIndicesB.begin() + m_workspace.groupOffsetsB[ig],
+          m_workspace.groupIndicesB.begin() + m_workspace.groupOffsetsB[ig + 1]);
+      for (idx_t ia : group.indicesA)
+        m_groupOfA[ia] = ig;
+      for (idx_t ib : group.indicesB)
+        m_groupOfB[ib] = ig;
+      m_groups.push_back(std::move(group) );
+    }
+  }
+
+  template <typename T>
+  basic_cost_view_t<T> BasicDynamicAssignment<T>::costs() const
+  {
+    return basic_cost_view_t<T>(m_costs.data(), m_nA, m_nB,
+        Eigen::Stride<Eigen::Dynamic, Eigen::Dynamic>(1, m_capacity) );
+  }
+
+  template <typename T>
+  idx_t BasicDynamicAssignment<T>::insertRow(
+      const Eigen::Ref<const row_t>& costs)
+  {
+    if (costs.size() != m_nB)
+      throw std::runtime_error(
+          "Row inserted into DynamicAssignment has the wrong size");
+    idx_t ia = m_nA;
+    if (m_nA < m_nB) {
+      // The first dummy row becomes the new vertex
+      for (idx_t ib = 0; ib < m_nB; ++ib)
+        working(ia, ib) = -std::min(costs[ib], m_maxCost);
+    }
+    else {
+      // The new row needs a new dummy column. Give that a feasible label
+      // before the row has any costs
+      grow();
+      resetColumn(ia);
+      for (idx_t ib = 0; ib < m_nB; ++ib)
+        working(ia, ib) = -std::min(costs[ib], m_maxCost);
+    }
+    for (idx_t ib = 0; ib < m_nB; ++ib)
+      cost(ia, ib) = costs[ib];
+    ++m_nA;
+    resetRow(ia);
+    repair();
+    m_groupOfA.push_back(-1);
+    for (idx_t ib = 0; ib < m_nB; ++ib)
+      if (admissible(ia, ib) )
+        link(ia, ib);
+    return ia;
+  }
+
+  template <typename T>
+  idx_t BasicDynamicAssignment<T>::insertColumn(
+      const Eigen::Ref<const col_t>& costs)
+  {
+    if (costs.size() != m_nA)
+      throw std::runtime_error(
+          "Column inserted into DynamicAssignment has the wrong size");
+    idx_t ib = m_nB;
+    if (m_nB < m_nA) {
+      // The first dummy column becomes the new vertex
+      for (idx_t ia = 0; ia < m_nA; ++ia)
+        working(ia, ib) = -std::min(costs[ia], m_maxCost);
+    }
+    else {
+      // The new column needs a new dummy row. Give that a feasible label
+      // before the column has any costs
+      grow();
+      resetRow(ib);
+      for (idx_t ia = 0; ia < m_nA; ++ia)
+        working(ia, ib) = -std::min(costs[ia], m_maxCost);
+    }
+    for (idx_t ia = 0; ia < m_nA; ++ia)
+      cost(ia, ib) = costs[ia];
+    ++m_nB;
+    resetColumn(ib);
+    repair();
+    m_groupOfB.push_back(-1);
+    for (idx_t ia = 0; ia < m_nA; ++ia)
+      if (admissible(ia, ib) )
+        link(ia, ib);
+    return ib;
+  }
+
+  template <typename T>
+  void BasicDynamicAssignment<T>::removeRow(idx_t ia)
+  {
+    if (ia < 0 || ia >= m_nA)
+      throw std::runtime_error("Invalid row removed from DynamicAssignment");
+    // Take the vertex out of its group, which may split it, before any
+    // indices change
+    idx_t group = m_groupOfA[ia];
+    if (group != -1) {
+      std::vector<idx_t>& indices = m_groups[group].indicesA;
+      indices.erase(std::lower_bound(indices.begin(), indices.end(), ia) );
+      m_groupOfA[ia] = -1;
+      regroup(group);
+    }
+    m_groupOfA.erase(m_groupOfA.begin() + ia);
+    for (Group& g : m_groups)
+      for (idx_t& index : g.indicesA)
+        if (index > ia)
+          --index;
+    moveRowToEnd(ia);
+    idx_t last = --m_nA;
+    if (m_nA < m_nB) {
+      // The row becomes a dummy row
+      for (idx_t ib = 0; ib < m_size; ++ib)
+        working(last, ib) = 0;
+      resetRow(last);
+    }
+    else
+      // Drop it along with a dummy column
+      shrink();
+    repair();
+  }
+
+  template <typename T>
+  void BasicDynamicAssignment<T>::removeColumn(idx_t ib)
+  {
+    if (ib < 0 || ib >= m_nB)
+      throw std::runtime_error(
+          "Invalid column removed from DynamicAssignment");
+    idx_t group = m_groupOfB[ib];
+    if (group != -1) {
+      std::vector<idx_t>& indices = m_groups[group].indicesB;
+      indices.erase(std::lower_bound(indices.begin(), indices.end(), ib) );
+      m_groupOfB[ib] = -1;
+      regroup(group);
+    }
+    m_groupOfB.erase(m_groupOfB.begin() + ib);
+    for (Group& g : m_groups)
+      for (idx_t& index : g.indicesB)
+        if (index > ib)
+          --index;
+    moveColumnToEnd(ib);
+    idx_t last = --m_nB;
+    if (m_nB < m_nA) {
+      // The column becomes a dummy column
+      for (idx_t ia = 0; ia < m_size; ++ia)
+        working(ia, last) = 0;
+      resetColumn(last);
+    }
+    else
+      // Drop it along with a dummy row
+      shrink();
+    repair();
+  }
+
+  template <typename T>
+  void BasicDynamicAssignment<T>::updateCost(idx_t ia, idx_t ib, T cost)
+  {
+    if (ia < 0 || ia >= m_nA || ib < 0 || ib >= m_nB)
+      throw std::runtime_error("Invalid cost updated in DynamicAssignment");
+    bool wasAdmissible = admissible(ia, ib);
+    this->cost(ia, ib) = cost;
+    working(ia, ib) = -std::min(cost, m_maxCost);
+    resetRow(ia);
+    repair();
+    if (!wasAdmissible && admissible(ia, ib) )
+      link(ia, ib);
+    else if (wasAdmissible && !admissible(ia, ib) )
+      regroup(m_groupOfA[ia]);
+  }
+
+  template <typename T>
+  idx_t BasicDynamicAssignment<T>::matchOfA(idx_t ia) const
+  {
+    if (ia < 0 || ia >= m_nA)
+      throw std::runtime_error("Invalid row in DynamicAssignment");
+    idx_t ib = m_workspace.matchA[ia];
+    return ib < m_nB && cost(ia, ib) < m_maxCost ? ib : -1;
+  }
+
+  template <typename T>
+  idx_t BasicDynamicAssignment<T>::matchOfB(idx_t ib) const
+  {
+    if (ib < 0 || ib >= m_nB)
+      throw std::runtime_error("Invalid column in DynamicAssignment");
+    idx_t ia = m_workspace.matchB[ib];
+    return ia < m_nA && cost(ia, ib) < m_maxCost ? ia : -1;
+  }
+
+  template <typename T>
+  match_vec_t BasicDynamicAssignment<T>::solution() const
+  {
+    match_vec_t matches;
+    for (idx_t ia = 0; ia < m_nA; ++ia) {
+      idx_t ib = matchOfA(ia);
+      if (ib != -1)
+        matches.push_back(std::make_pair(ia, ib) );
+    }
+    return matches;
+  }
+
+  template <typename T>
+  BasicSparseGroup<T> BasicDynamicAssignment<T>::sparseGroup(
+      idx_t group) const
+  {
+    BasicSparseGroup<T> sparseGroup;
+    sparseGroup.indicesA = groupIndicesA(group);
+    sparseGroup.indicesB = groupIndicesB(group);
+    if (sparseGroup.indicesA.size() == 1 || sparseGroup.indicesB.size() == 1)
+      sparseGroup.solveStar(costs(), m_maxCost);
+    else
+      sparseGroup.buildCosts(costs(), m_maxCost);
+    return sparseGroup;
+  }
+
+  template <typename T>
+  basic_padded_matrix_t<T> BasicDynamicAssignment<T>::workingCosts()
+  {
+    return basic_padded_matrix_t<T>(m_workspace.costs.data(), m_size, m_size,
+        Eigen::OuterStride<>(m_capacity) );
+  }
+
+  template <typename T>
+  void BasicDynamicAssignment<T>::reserve(idx_t size)
+  {
+    if (size <= m_capacity)
+      return;
+    // Grow geometrically so that adding vertices one at a time only copies
+    // the matrices O(log n) times. Whole cache lines keep the rows aligned
+    const idx_t lineSize = cacheLineSize / sizeof(T);
+    idx_t capacity = std::max(size, 2 * m_capacity);
+    capacity = (capacity + lineSize - 1) / lineSize * lineSize;
+    std::vector<T> costs(capacity * capacity);
+    std::vector<T, CacheAlignedAllocator<T>> working(capacity * capacity);
+    for (idx_t ia = 0; ia < m_size; ++ia) {
+      std::copy_n(m_costs.begin() + ia * m_capacity, m_nB,
+          costs.begin() + ia * capacity);
+      std::copy_n(m_workspace.costs.begin() + ia * m_capacity, m_size,
+          working.begin() + ia * capacity);
+    }
+    m_costs.swap(costs);
+    m_workspace.costs.swap(working);
+    m_capacity = capacity;
+  }
+
+  template <typename T>
+  void BasicDynamicAssignment<T>::grow()
+  {
+    reserve(m_size + 1);
+    idx_t last = m_size++;
+    for (idx_t ii = 0; ii <= last; ++ii) {
+      working(last, ii) = 0;
+      working(ii, last) = 0;
+    }
+    // Unmatched vertices point one past the end, which has moved
+    for (idx_t& ib : m_workspace.matchA)
+      if (ib == last)
+        ib = m_size;
+    for (idx_t& ia : m_workspace.matchB)
+      if (ia == last)
+        ia = m_size;
+    m_workspace.labelsA.push_back(0);
+    m_workspace.labelsB.push_back(0);
+    m_workspace.matchA.push_back(m_size);
+    m_workspace.matchB.push_back(m_size);
+  }
+
+  template <typename T>
+  void BasicDynamicAssignment<T>::moveRowToEnd(idx_t ia)
+  {
+    idx_t last = m_nA - 1;
+    if (ia == last)
+      return;
+    // The row's own costs are about to be replaced so are not kept
+    std::copy(m_costs.begin() + (ia + 1) * m_capacity,
+        m_costs.begin() + (last + 1) * m_capacity,
+        m_costs.begin() + ia * m_capacity);
+    std::copy(m_workspace.costs.begin() + (ia + 1) * m_capacity,
+        m_workspace.costs.begin() + (last + 1) * m_capacity,
+        m_workspace.costs.begin() + ia * m_capacity);
+    std::vector<T>& labelsA = m_workspace.labelsA;
+    std::vector<idx_t>& matchA = m_workspace.matchA;
+    std::rotate(labelsA.begin() + ia, labelsA.begin() + ia + 1,
+        labelsA.begin() + last + 1);
+    std::rotate(matchA.begin() + ia, matchA.begin() + ia + 1,
+        matchA.begin() + last + 1);
+    for (idx_t& match : m_workspace.matchB) {
+      if (match == ia)
+        match = last;
+      else if (match > ia && match <= last)
+        --match;
+    }
+  }
+
+  template <typename T>
+  void BasicDynamicAssignment<T>::moveColumnToEnd(idx_t ib)
+  {
+    idx_t last = m_nB - 1;
+    if (ib == last)
+      return;
+    for (idx_t ia = 0; ia < m_size; ++ia) {
+      if (ia < m_nA) {
+        auto row = m_costs.begin() + ia * m_capacity;
+        std::copy(row + ib + 1, row + last + 1, row + ib);
+      }
+      auto row = m_workspace.costs.begin() + ia * m_capacity;
+      std::copy(row + ib + 1, row + last + 1, row + ib);
+    }
+    std::vector<T>& labelsB = m_workspace.labelsB;
+    std::vector<idx_t>& matchB = m_workspace.matchB;
+    std::rotate(labelsB.begin() + ib, labelsB.begin() + ib + 1,
+        labelsB.begin() + last + 1);
+    std::rotate(matchB.begin() + ib, matchB.begin() + ib + 1,
+        matchB.begin() + last + 1);
+    for (idx_t& match : m_workspace.matchA) {
+      if (match == ib)
+        match = last;
+      else if (match > ib && match <= last)
+        --match;
+    }
+  }
+
+  template <typename T>
+  void BasicDynamicAssignment<T>::shrink()
+  {
+    idx_t last = --m_size;
+    std::vector<idx_t>& matchA = m_workspace.matchA;
+    std::vector<idx_t>& matchB = m_workspace.matchB;
+    // The vertices matched to the ones being dropped are left unmatched, and
+    // one past the end is now the last index
+    idx_t freedA = matchB[last];
+    idx_t freedB = matchA[last];
+    matchA.pop_back();
+    matchB.pop_back();
+    m_workspace.labelsA.pop_back();
+    m_workspace.labelsB.pop_back();
+    if (freedA < last)
+      matchA[freedA] = last;
+    if (freedB < last)
+      matchB[freedB] = last;
+    for (idx_t& ib : matchA)
+      if (ib > last)
+        ib = last;
+    for (idx_t& ia : matchB)
+      if (ia > last)
+        ia = last;
+  }
+
+  template <typename T>
+  void BasicDynamicAssignment<T>::resetRow(idx_t ia)
+  {
+    std::vector<T>& labelsA = m_workspace.labelsA;
+    std::vector<idx_t>& matchA = m_workspace.matchA;
+    std::vector<idx_t>& matchB = m_workspace.matchB;
+    Eigen::Map<const Eigen::Matrix<T, 1, Eigen::Dynamic>> labelsB(
+        m_workspace.labelsB.data(), m_size);
+    labelsA[ia] = (workingCosts().row(ia) - labelsB).maxCoeff();
+    // The test is made on the same expression as the maximum so it is exact
+    // for floating point costs too
+    idx_t ib = matchA[ia];
+    if (ib != m_size && working(ia, ib) - labelsB[ib] != labelsA[ia]) {
+      matchA[ia] = m_size;
+      matchB[ib] = m_size;
+    }
+  }
+
+  template <typename T>
+  void BasicDynamicAssignment<T>::resetColumn(idx_t ib)
+  {
+    const std::vector<T>& labelsA = m_workspace.labelsA;
+    std::vector<T>& labelsB = m_workspace.labelsB;
+    std::vector<idx_t>& matchA = m_workspace.matchA;
+    std::vector<idx_t>& matchB = m_workspace.matchB;
+    T label = working(0, ib) - labelsA[0];
+    for (idx_t ia = 1; ia < m_size; ++ia)
+      label = std::max(label, working(ia, ib) - labelsA[ia]);
+    labelsB[ib] = label;
+    idx_t ia = matchB[ib];
+    if (ia != m_size && working(ia, ib) - labelsA[ia] != label) {
+      matchA[ia] = m_size;
+      matchB[ib] = m_size;
+    }
+  }
+
+  template <typename T>
+  void BasicDynamicAssignment<T>::repair()
+  {
+    // Each change leaves at most one row unmatched, but finding it is cheap
+    for (idx_t ia = 0; ia < m_size; ++ia)
+      if (m_workspace.matchA[ia] == m_size)
+        incrementalAugment(workingCosts(), ia, m_workspace);
+  }
+
+  template <typename T>
+  void BasicDynamicAssignment<T>::link(idx_t ia, idx_t ib)
+  {
+    idx_t groupA = m_groupOfA[ia];
+    idx_t groupB = m_groupOfB[ib];
+    if (groupA == -1 && groupB == -1) {
+      m_groupOfA[ia] = m_groupOfB[ib] = m_groups.size();
+      m_groups.push_back(Group{{ia}, {ib}});
+    }
+    else if (groupA == -1) {
+      std::vector<idx_t>& indices = m_groups[groupB].indicesA;
+      indices.insert(std::upper_bound(indices.begin(), indices.end(), ia), ia);
+      m_groupOfA[ia] = groupB;
+    }
+    else if (groupB == -1) {
+      std::vector<idx_t>& indices = m_groups[groupA].indicesB;
+      indices.insert(std::upper_bound(indices.begin(), indices.end(), ib), ib);
+      m_groupOfB[ib] = groupA;
+    }
+    else if (groupA != groupB) {
+      // Merge the smaller group into the larger
+      auto size = [this] (idx_t group) {
+        return m_groups[group].indicesA.size() +
+          m_groups[group].indicesB.size();
+      };
+      idx_t into = size(groupA) < size(groupB) ? groupB : groupA;
+      idx_t from = into == groupA ? groupB : groupA;
+      auto mergeInto = [] (std::vector<idx_t>& target,
+          const std::vector<idx_t>& source) {
+        std::size_t middle = target.size();
+        target.insert(target.end(), source.begin(), source.end() );
+        std::inplace_merge(
+            target.begin(), target.begin() + middle, target.end() );
+      };
+      for (idx_t index : m_groups[from].indicesA)
+        m_groupOfA[index] = into;
+      for (idx_t index : m_groups[from].indicesB)
+        m_groupOfB[index] = into;
+      mergeInto(m_groups[into].indicesA, m_groups[from].indicesA);
+      mergeInto(m_groups[into].indicesB, m_groups[from].indicesB);
+      eraseGroup(from);
+    }
+  }
+
+  template <typename T>
+  void BasicDynamicAssignment<T>::regroup(idx_t group)
+  {
+    Group old = std::move(m_groups[group]);
+    m_groups[group] = Group();
+    // Mark the members as not yet reached
+    const idx_t unreached = -2;
+    for (idx_t ia : old.indicesA)
+      m_groupOfA[ia] = unreached;
+    for (idx_t ib : old.indicesB)
+      m_groupOfB[ib] = unreached;
+    // A breadth first search over the members, as in
+    // splitProblemIntoSparseGroups. The first group found keeps the number
+    // and any others are added to the end
+    std::vector<idx_t>& queueA = m_workspace.listA;
+    std::vector<idx_t>& queueB = m_workspace.listB;
+    const idx_t nGroups = m_groups.size();
+    idx_t nFound = 0;
+    for (idx_t seed : old.indicesA) {
+      if (m_groupOfA[seed] != unreached)
+        continue;
+      idx_t current = nFound == 0 ? group : nGroups + nFound - 1;
+      queueA.assign(1, seed);
+      queueB.clear();
+      m_groupOfA[seed] = current;
+      std::size_t frontA = 0;
+      std::size_t frontB = 0;
+      while (frontA < queueA.size() || frontB < queueB.size() ) {
+        if (frontA < queueA.size() ) {
+          idx_t ia = queueA[frontA++];
+          for (idx_t ib : old.indicesB) {
+            if (m_groupOfB[ib] != unreached || !admissible(ia, ib) )
+              continue;
+            m_groupOfB[ib] = current;
+            queueB.push_back(ib);
+          }
+        }
+        else {
+          idx_t ib = queueB[frontB++];
+          for (idx_t ia : old.indicesA) {
+            if (m_groupOfA[ia] != unreached || !admissible(ia, ib) )
+              continue;
+            m_groupOfA[ia] = current;
+            queueA.push_back(ia);
+          }
+        }
+      }
+      if (queueB.empty() )
+        // A vertex with no edges is not in any group
+        m_groupOfA[seed] = -1;
+      else
+        ++nFound;
+    }
+    // Every 'B' vertex with an edge was reached from an 'A' vertex
+    for (idx_t ib : old.indicesB)
+      if (m_groupOfB[ib] == unreached)
+        m_groupOfB[ib] = -1;
+    if (nFound == 0) {
+      eraseGroup(group);
+      return;
+    }
+    m_groups.resize(nGroups + nFound - 1);
+    // Filling the groups in order of the old indices keeps them sorted
+    for (idx_t ia : old.indicesA)
+      if (m_groupOfA[ia] != -1)
+        m_groups[m_groupOfA[ia]].indicesA.push_back(ia);
+    for (idx_t ib : old.indicesB)
+      if (m_groupOfB[ib] != -1)
+        m_groups[m_groupOfB[ib]].indicesB.push_back(ib);
+  }
+
+  template <typename T>
+  void BasicDynamicAssignment<T>::eraseGroup(idx_t group)
+  {
+    idx_t last = m_groups.size() - 1;
+    if (group != last) {
+      m_groups[group] = std::move(m_groups[last]);
+      for (idx_t ia : m_groups[group].indicesA)
+        m_groupOfA[ia] = group;
+      for (idx_t ib : m_groups[group].indicesB)
+        m_groupOfB[ib] = group;
+    }
+    m_groups.pop_back();
+  }
+
+  template class BasicDynamicAssignment<float>;
+  template class BasicDynamicAssignment<double>;
+  template class BasicDynamicAssignment<std::int32_t>;
+  template class BasicDynamicAssignment<std::int64_t>;
+}
@@ -0,0 +1,404 @@
+#include "SparseHungarian/EventFile.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+  using SparseHungarian::idx_t;
+  const char eventMagic[4] = {'S', 'H', 'E', 'V'};
+  const char matchMagic[4] = {'S', 'H', 'M', 'T'};
+  const char matchStreamMagic[4] = {'S', 'H', 'M', 'S'};
+  const std::uint32_t version = 1;
+  const std::size_t fileHeaderSize = 24;
+  const std::size_t eventHeaderSize = 16;
+
+  // The files are read in place so the host has to share their byte order
+  void checkLittleEndian()
+  {
+    const std::uint32_t one = 1;
+    char first;
+    std::memcpy(&first, &one, 1);
+    if (first != 1)
+      throw std::runtime_error(
+          "Binary event files are only supported on little-endian hosts");
+  }
+
+  // The most values read from a stream before checking that they arrived.
+  // Streams may be pipes whose size can't be checked up front, so a corrupt
+  // count mustn't be trusted with a single allocation
+  const std::uint64_t streamChunk = 1 << 16;
+
+  // Read floats from a stream into an array, growing it only as they arrive.
+  // Returns false if the stream ends first
+  bool readFloats(std::istream& in, Eigen::ArrayXf& array, std::uint64_t n)
+  {
+    std::uint64_t done = 0;
+    array.resize(std::min(n, streamChunk) );
+    while (true) {
+      std::uint64_t size = array.size();
+      if (!in.read(reinterpret_cast<char*>(array.data() + done),
+            4 * (size - done) ) )
+        return false;
+      done = size;
+      if (done == n)
+        return true;
+      // Doubling keeps the copies linear in the size
+      array.conservativeResize(std::min(n, 2 * done) );
+    }
+  }
+
+  // Read a value from a possibly unaligned position
+  template <typename T>
+  T load(const char* data)
+  {
+    T value;
+    std::memcpy(&value, data, sizeof(T) );
+    return value;
+  }
+}
+
+namespace SparseHungarian {
+  EventFileReader::EventFileReader(const std::string& path)
+  {
+    checkLittleEndian();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+      throw std::runtime_error("Failed to open event file: " + path);
+    struct stat info;
+    if (::fstat(fd, &info) != 0) {
+      ::close(fd);
+      throw std::runtime_error("Failed to read the size of event file: " + path);
+    }
+    m_size = info.st_size;
+    if (m_size < fileHeaderSize) {
+      ::close(fd);
+      throw std::runtime_error("Event file is too short: " + path);
+    }
+    void* data = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping keeps the file open
+    ::close(fd);
+    if (data == MAP_FAILED)
+      throw std::runtime_error("Failed to map event file: " + path);
+    m_data = static_cast<const char*>(data);
+
+    // Check everything up front so that events can be viewed without checks
+    try {
+      if (std::memcmp(m_data, eventMagic, 4) != 0)
+        throw std::runtime_error("Not a binary event file: " + path);
+      if (load<std::uint32_t>(m_data + 4) != version)
+        throw std::runtime_error("Unsupported event file version: " + path);
+      std::uint64_t nEvents = load<std::uint64_t>(m_data + 8);
+      std::uint64_t tableOffset = load<std::uint64_t>(m_data + 16);
+      if (tableOffset < fileHeaderSize || tableOffset > m_size ||
+          (m_size - tableOffset) / 8 < nEvents)
+        throw std::runtime_error("Corrupt offset table in event file: " + path);
+      m_offsets.resize(nEvents);
+      for (std::size_t ie = 0; ie < nEvents; ++ie) {
+        std::uint64_t offset = load<std::uint64_t>(m_data + tableOffset + 8*ie);
+        // The arrays are read as floats so must be aligned for them
+        if (offset < fileHeaderSize || offset % 4 != 0 ||
+            offset > tableOffset || tableOffset - offset < eventHeaderSize)
+          throw std::runtime_error("Corrupt event offset in event file: " + path);
+        std::uint64_t nA = load<std::uint32_t>(m_data + offset + 4);
+        std::uint64_t nB = load<std::uint32_t>(m_data + offset + 8);
+        if ( (tableOffset - offset - eventHeaderSize) / 8 < nA + nB)
+          throw std::runtime_error("Truncated event in event file: " + path);
+        m_offsets[ie] = offset;
+      }
+    }
+    catch (...) {
+      ::munmap(const_cast<char*>(m_data), m_size);
+      throw;
+    }
+  }
+
+  EventFileReader::~EventFileReader()
+  {
+    ::munmap(const_cast<char*>(m_data), m_size);
+  }
+
+  EventView EventFileReader::event(std::size_t index) const
+  {
+    const char* start = m_data + m_offsets.at(index);
+    idx_t nA = load<std::uint32_t>(start + 4);
+    idx_t nB = load<std::uint32_t>(start + 8);
+    const float* arrays =
+      reinterpret_cast<const float*>(start + eventHeaderSize);
+    return EventView{
+      load<float>(start),
+      EventView::coords_t(arrays, nA),
+      EventView::coords_t(arrays + nA, nA),
+      EventView::coords_t(arrays + 2*nA, nB),
+      EventView::coords_t(arrays + 2*nA + nB, nB)};
+  }
+
+  EventFileWriter::EventFileWriter(const std::string& path)
+    : m_out(path, std::ios::binary | std::ios::trunc)
+  {
+    checkLittleEndian();
+    if (!m_out.is_open() )
+      throw std::runtime_error("Failed to open event file for writing: " + path);
+    // Leave space for the header, which is only complete at the end
+    char header[fileHeaderSize] = {};
+    put(header, fileHeaderSize);
+  }
+
+  EventFileWriter::~EventFileWriter()
+  {
+    if (m_out.is_open() ) {
+      try {
+        close();
+      }
+      catch (...) {
+        // Destructors mustn't throw. Call close to see the error
+      }
+    }
+  }
+
+  void EventFileWriter::write(
+      const Eigen::Ref<const Eigen::ArrayXf>& phiA,
+      const Eigen::Ref<const Eigen::ArrayXf>& etaA,
+      const Eigen::Ref<const Eigen::ArrayXf>& phiB,
+      const Eigen::Ref<const Eigen::ArrayXf>& etaB,
+      float maxDR)
+  {
+    if (!m_out.is_open() )
+      throw std::runtime_error("Event written to a closed event file");
+    if (phiA.size() != etaA.size() || phiB.size() != etaB.size() )
+      throw std::runtime_error("Event written with phi and eta arrays of "
+          "different sizes");
+    m_offsets.push_back(m_position);
+    std::uint32_t nA = phiA.size();
+    std::uint32_t nB = phiB.size();
+    std::uint32_t reserved = 0;
+    put(&maxDR, 4);
+    put(&nA, 4);
+    put(&nB, 4);
+    put(&reserved, 4);
+    put(phiA.data(), 4*nA);
+    put(etaA.data(), 4*nA);
+    put(phiB.data(), 4*nB);
+    put(etaB.data(), 4*nB);
+  }
+
+  void EventFileWriter::write(
+      const point_vec_t& pointsA,
+      const point_vec_t& pointsB,
+      float maxDR)
+  {
+    Eigen::ArrayXf phiA(pointsA.size() );
+    Eigen::ArrayXf etaA(pointsA.size() );
+    Eigen::ArrayXf phiB(pointsB.size() );
+    Eigen::ArrayXf etaB(pointsB.size() );
+    for (std::size_t ia = 0; ia < pointsA.size(); ++ia) {
+      phiA[ia] = pointsA[ia].first;
+      etaA[ia] = pointsA[ia].second;
+    }
+    for (std::size_t ib = 0; ib < pointsB.size(); ++ib) {
+      phiB[ib] = pointsB[ib].first;
+      etaB[ib] = pointsB[ib].second;
+    }
+    write(phiA, etaA, phiB, etaB, maxDR);
+  }
+
+  void EventFileWriter::close()
+  {
+    if (!m_out.is_open() )
+      return;
+    std::uint64_t tableOffset = m_position;
+    put(m_offsets.data(), 8*m_offsets.size() );
+    std::uint64_t nEvents = m_offsets.size();
+    m_out.seekp(0);
+    m_out.write(eventMagic, 4);
+    m_out.write(reinterpret_cast<const char*>(&version), 4);
+    m_out.write(reinterpret_cast<const char*>(&nEvents), 8);
+    m_out.write(reinterpret_cast<const char*>(&tableOffset), 8);
+    m_out.close();
+    if (!m_out)
+      throw std::runtime_error("Failed to finish writing event file");
+  }
+
+  void EventFileWriter::put(const void* data, std::size_t size)
+  {
+    m_out.write(static_cast<const char*>(data), size);
+    if (!m_out)
+      throw std::runtime_error("Failed to write to event file");
+    m_position += size;
+  }
+
+  EventStreamReader::EventStreamReader(std::istream& in)
+    : m_in(in)
+  {
+    checkLittleEndian();
+    char header[fileHeaderSize];
+    if (!m_in.read(header, fileHeaderSize) ||
+        std::memcmp(header, eventMagic, 4) != 0)
+      throw std::runtime_error("Stream is not a binary event file");
+    if (load<std::uint32_t>(header + 4) != version)
+      throw std::runtime_error("Unsupported event file version");
+    m_nEvents = load<std::uint64_t>(header + 8);
+    m_tableOffset = load<std::uint64_t>(header + 16);
+    m_position = fileHeaderSize;
+  }
+
+  bool EventStreamReader::read(EventData& event)
+  {
+    if (m_nRead == m_nEvents || m_position >= m_tableOffset)
+      return false;
+    char header[eventHeaderSize];
+    if (m_tableOffset - m_position < eventHeaderSize ||
+        !m_in.read(header, eventHeaderSize) )
+      throw std::runtime_error("Truncated event in event stream");
+    std::uint64_t nA = load<std::uint32_t>(header + 4);
+    std::uint64_t nB = load<std::uint32_t>(header + 8);
+    m_position += eventHeaderSize;
+    if ( (m_tableOffset - m_position) / 8 < nA + nB)
+      throw std::runtime_error("Truncated event in event stream");
+    event.maxDR = load<float>(header);
+    if (!readFloats(m_in, event.phiA, nA) || !readFloats(m_in, event.etaA, nA) ||
+        !readFloats(m_in, event.phiB, nB) || !readFloats(m_in, event.etaB, nB) )
+      throw std::runtime_error("Truncated event in event stream");
+    m_position += 8 * (nA + nB);
+    ++m_nRead;
+    return true;
+  }
+
+  MatchStreamWriter::MatchStreamWriter(std::ostream& out)
+    : m_out(out)
+  {
+    checkLittleEndian();
+    m_out.write(matchStreamMagic, 4);
+    m_out.write(reinterpret_cast<const char*>(&version), 4);
+    if (!m_out)
+      throw std::runtime_error("Failed to write to match stream");
+  }
+
+  void MatchStreamWriter::write(const match_vec_t& matches)
+  {
+    std::uint32_t nMatches = matches.size();
+    m_out.write(reinterpret_cast<const char*>(&nMatches), 4);
+    for (const match_t& match : matches) {
+      std::uint32_t indices[2] = {
+        static_cast<std::uint32_t>(match.first),
+        static_cast<std::uint32_t>(match.second)};
+      m_out.write(reinterpret_cast<const char*>(indices), 8);
+    }
+    if (!m_out)
+      throw std::runtime_error("Failed to write to match stream");
+  }
+
+  MatchStreamReader::MatchStreamReader(std::istream& in)
+    : m_in(in)
+  {
+    checkLittleEndian();
+    char magic[4];
+    std::uint32_t streamVersion = 0;
+    m_in.read(magic, 4);
+    m_in.read(reinterpret_cast<char*>(&streamVersion), 4);
+    if (!m_in || std::memcmp(magic, matchStreamMagic, 4) != 0)
+      throw std::runtime_error("Stream is not a match stream");
+    if (streamVersion != version)
+      throw std::runtime_error("Unsupported match stream version");
+  }
+
+  bool MatchStreamReader::read(match_vec_t& matches)
+  {
+    std::uint32_t nMatches = 0;
+    if (!m_in.read(reinterpret_cast<char*>(&nMatches), 4) ) {
+      // A clean end falls exactly between events
+      if (m_in.gcount() == 0)
+        return false;
+      throw std::runtime_error("Truncated match stream");
+    }
+    // Grow with the matches that arrive rather than trusting the count
+    matches.clear();
+    matches.reserve(std::min<std::uint64_t>(nMatches, streamChunk) );
+    for (std::uint32_t im = 0; im < nMatches; ++im) {
+      std::uint32_t indices[2] = {0, 0};
+      if (!m_in.read(reinterpret_cast<char*>(indices), 8) )
+        throw std::runtime_error("Truncated match stream");
+      matches.emplace_back(indices[0], indices[1]);
+    }
+    return true;
+  }
+
+  void writeMatchFile(const std::string& path, const BatchResult& result)
+  {
+    checkLittleEndian();
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open() )
+      throw std::runtime_error("Failed to open match file for writing: " + path);
+    std::uint64_t nEvents = result.nEvents();
+    std::uint64_t nMatches = result.matches.size();
+    out.write(matchMagic, 4);
+    out.write(reinterpret_cast<const char*>(&version), 4);
+    out.write(reinterpret_cast<const char*>(&nEvents), 8);
+    out.write(reinterpret_cast<const char*>(&nMatches), 8);
+    for (std::size_t offset : result.offsets) {
+      std::uint64_t value = offset;
+      out.write(reinterpret_cast<const char*>(&value), 8);
+    }
+    for (const match_t& match : result.matches) {
+      std::uint32_t indices[2] = {
+        static_cast<std::uint32_t>(match.first),
+        static_cast<std::uint32_t>(match.second)};
+      out.write(reinterpret_cast<const char*>(indices), 8);
+    }
+    if (!out)
+      throw std::runtime_error("Failed to write match file: " + path);
+  }
+
+  BatchResult readMatchFile(const std::string& path)
+  {
+    checkLittleEndian();
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open() )
+      throw std::runtime_error("Failed to open match file: " + path);
+    char magic[4];
+    std::uint32_t fileVersion = 0;
+    std::uint64_t nEvents = 0;
+    std::uint64_t nMatches = 0;
+    in.read(magic, 4);
+    in.read(reinterpret_cast<char*>(&fileVersion), 4);
+    in.read(reinterpret_cast<char*>(&nEvents), 8);
+    in.read(reinterpret_cast<char*>(&nMatches), 8);
+    if (!in || std::memcmp(magic, matchMagic, 4) != 0)
+      throw std::runtime_error("Not a match file: " + path);
+    if (fileVersion != version)
+      throw std::runtime_error("Unsupported match file version: " + path);
+    // Check the counts against what is left of the file before allocating
+    // anything for them
+    std::uint64_t position = in.tellg();
+    in.seekg(0, std::ios::end);
+    std::uint64_t remaining = static_cast<std::uint64_t>(in.tellg() ) - position;
+    in.seekg(position);
+    if (!in || nEvents >= remaining / 8 ||
+        (remaining - 8 * (nEvents + 1) ) / 8 < nMatches)
+      throw std::runtime_error("Truncated match file: " + path);
+    BatchResult result;
+    result.offsets.resize(nEvents + 1);
+    std::uint64_t previous = 0;
+    for (std::size_t& offset : result.offsets) {
+      std::uint64_t value = 0;
+      in.read(reinterpret_cast<char*>(&value), 8);
+      if (value < previous || value > nMatches)
+        throw std::runtime_error("Corrupt match offset in match file: " + path);
+      offset = previous = value;
+    }
+    if (result.offsets.front() != 0 || result.offsets.back() != nMatches)
+      throw std::runtime_error("Corrupt match offset in match file: " + path);
+    result.matches.resize(nMatches);
+    for (match_t& match : result.matches) {
+      std::uint32_t indices[2] = {0, 0};
+      in.read(reinterpret_cast<char*>(indices), 8);
+      match = std::make_pair(indices[0], indices[1]);
+    }
+    if (!in)
+      throw std::runtime_error("Truncated match file: " + path);
+    return result;
+  }
+}
@@ -0,0 +1,60 @@
+#include "SparseHungarian/FixedSizeSolver.h"
+#include <utility>
+
+namespace {
+  using SparseHungarian::basic_cost_view_t;
+  using SparseHungarian::match_vec_t;
+  using SparseHungarian::maxFixedSize;
+
+  template <typename T>
+    using append_t = void (*)(
+        const basic_cost_view_t<T>& costs, T maxCost, match_vec_t& matches);
+
+  template <typename T, int NA, int NB>
+    void appendFixedSize(
+        const basic_cost_view_t<T>& costs,
+        T maxCost,
+        match_vec_t& matches)
+    {
+      SparseHungarian::FixedSizeSolver<T, NA, NB> solver(costs, maxCost);
+      matches.insert(matches.end(), solver.begin(), solver.end() );
+    }
+
+  // One entry for each size, indexed by (nA - 1) * maxFixedSize + nB - 1
+  template <typename T, int... Idx>
+    constexpr std::array<append_t<T>, sizeof...(Idx)> buildTable(
+        std::integer_sequence<int, Idx...>)
+    {
+      return {{
+        &appendFixedSize<T, Idx / maxFixedSize + 1, Idx % maxFixedSize + 1>...
+      }};
+    }
+}
+
+namespace SparseHungarian {
+  template <typename T>
+    bool matchFixedSize(
+        const basic_cost_view_t<T>& costs,
+        std::common_type_t<T> maxCost,
+        match_vec_t& matches)
+    {
+      static constexpr std::array<append_t<T>, maxFixedSize * maxFixedSize>
+        table = buildTable<T>(
+            std::make_integer_sequence<int, maxFixedSize * maxFixedSize>() );
+      idx_t nA = costs.rows();
+      idx_t nB = costs.cols();
+      if (nA < 1 || nB < 1 || nA > maxFixedSize || nB > maxFixedSize)
+        return false;
+      table[(nA - 1) * maxFixedSize + nB - 1](costs, maxCost, matches);
+      return true;
+    }
+
+  template bool matchFixedSize<float>(
+      const basic_cost_view_t<float>&, float, match_vec_t&);
+  template bool matchFixedSize<double>(
+      const basic_cost_view_t<double>&, double, match_vec_t&);
+  template bool matchFixedSize<std::int32_t>(
+      const basic_cost_view_t<std::int32_t>&, std::int32_t, match_vec_t&);
+  template bool matchFixedSize<std::int64_t>(
+      const basic_cost_view_t<std::int64_t>&, std::int64_t, match_vec_t&);
+}
@@ -0,0 +1,77 @@
+#include "SparseHungarian/GroupArena.h"
+
+namespace SparseHungarian {
+  template <typename T>
+  void BasicGroupArena<T>::split(
+      const basic_cost_view_t<T>& costs,
+      std::common_type_t<T> maxCost)
+  {
+    m_maxCost = maxCost;
+    findSparseGroups(costs, maxCost, m_grouping);
+    std::size_t nGroups = m_grouping.nGroups();
+    m_starMatches.assign(nGroups, match_t(-1, -1) );
+    m_costOffsets.assign(1, 0);
+    // Size the cost blocks first so that the buffer grows at most once
+    std::size_t nCosts = 0;
+    for (std::size_t ig = 0; ig < nGroups; ++ig) {
+      idx_t nA = m_grouping.groupOffsetsA[ig + 1] - m_grouping.groupOffsetsA[ig];
+      idx_t nB = m_grouping.groupOffsetsB[ig + 1] - m_grouping.groupOffsetsB[ig];
+      if (nA != 1 && nB != 1)
+        nCosts += nA * nB;
+      m_costOffsets.push_back(nCosts);
+    }
+    m_costs.resize(nCosts);
+    for (std::size_t ig = 0; ig < nGroups; ++ig) {
+      const idx_t* indicesA =
+        m_grouping.groupIndicesA.data() + m_grouping.groupOffsetsA[ig];
+      const idx_t* indicesB =
+        m_grouping.groupIndicesB.data() + m_grouping.groupOffsetsB[ig];
+      idx_t nA = m_grouping.groupOffsetsA[ig + 1] - m_grouping.groupOffsetsA[ig];
+      idx_t nB = m_grouping.groupOffsetsB[ig + 1] - m_grouping.groupOffsetsB[ig];
+      if (nA == 1 || nB == 1) {
+        // Star groups are solved straight away
+        m_starMatches[ig] = cheapestEdge(costs, indicesA, nA, indicesB, nB);
+        continue;
+      }
+      // Gather the group's costs in storage order
+      T* block = m_costs.data() + m_costOffsets[ig];
+      for (idx_t ib = 0; ib < nB; ++ib)
+        for (idx_t ia = 0; ia < nA; ++ia)
+          block[ib * nA + ia] = costs.coeff(indicesA[ia], indicesB[ib]);
+    }
+  }
+
+  template <typename T>
+  void BasicGroupArena<T>::reset()
+  {
+    m_grouping.groupOffsetsA.assign(1, 0);
+    m_grouping.groupOffsetsB.assign(1, 0);
+    m_grouping.groupIndicesA.clear();
+    m_grouping.groupIndicesB.clear();
+    m_costOffsets.assign(1, 0);
+    m_costs.clear();
+    m_starMatches.clear();
+  }
+
+  template <typename T>
+  typename BasicGroupArena<T>::Group BasicGroupArena<T>::operator[](
+      std::size_t ig) const
+  {
+    Group group;
+    group.indicesA =
+      m_grouping.groupIndicesA.data() + m_grouping.groupOffsetsA[ig];
+    group.nA = m_grouping.groupOffsetsA[ig + 1] - m_grouping.groupOffsetsA[ig];
+    group.indicesB =
+      m_grouping.groupIndicesB.data() + m_grouping.groupOffsetsB[ig];
+    group.nB = m_grouping.groupOffsetsB[ig + 1] - m_grouping.groupOffsetsB[ig];
+    group.starMatch = m_starMatches[ig];
+    group.costs = group.isStar() ?
+      nullptr : m_costs.data() + m_costOffsets[ig];
+    return group;
+  }
+
+  template class BasicGroupArena<float>;
+  template class BasicGroupArena<double>;
+  template class BasicGroupArena<std::int32_t>;
+  template class BasicGroupArena<std::int64_t>;
+}
@@ -1,70 +1,252 @@
 #include "SparseHungarian/HungarianSolver.h"
+#include "SparseHungarian/SlackKernels.h"
 #include <exception>
-#include <queue>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
 
 namespace SparseHungarian {
-  HungarianSolver::HungarianSolver(
-      const cost_matrix_t& costs,
-      float maxCost,
-      const match_vec_t& initialMatching)
+  template <typename T>
+  BasicHungarianSolver<T>::BasicHungarianSolver(
+      const basic_cost_view_t<T>& costs,
+      T maxCost,
+      SearchMode mode,
+      BasicSolverWorkspace<T>* workspace)
     : 
       nVtxA(costs.rows() ),
       nVtxB(costs.cols() ),
-      m_costs(-costs),
-      m_maxCost(-maxCost),
-      m_labelsA(nVtxB, -maxCost),
-      m_labelsB(nVtxB, 0.),
-      m_matchA(nVtxB, nVtxB),
-      m_matchB(nVtxB, nVtxB)
+      searchMode(mode),
+      m_ownWorkspace(workspace ? nullptr : new BasicSolverWorkspace<T>() ),
+      m_workspace(workspace ? *workspace : *m_ownWorkspace),
+      m_costs(m_workspace.paddedCosts(nVtxB, nVtxB) ),
+      m_maxCost(-finiteMaxCost(costs, maxCost) ),
+      m_labelsA(m_workspace.labelsA),
+      m_labelsB(m_workspace.labelsB),
+      m_solution(m_workspace.solution),
+      m_matchA(m_workspace.matchA),
+      m_matchB(m_workspace.matchB)
   {
     // Make sure that the input matrix is correct
     if (nVtxA > nVtxB)
       throw std::runtime_error("Invalid matrix supplied to HungarianSolver"
           "The matrix must have nRows <= nCols!");
-    // First square the matrix
-    m_costs.conservativeResize(nVtxB, nVtxB);
-    for (idx_t ia = nVtxA; ia < nVtxB; ++ia)
-      for (idx_t ib = 0; ib < nVtxB; ++ib)
-        m_costs(ia, ib) = m_maxCost;
-    // Now load the initial matching
-    for (const match_t& m : initialMatching) {
-      m_matchA[m.first] = m.second;
-      m_matchB[m.second] = m.first;
+    // Anything above the max cost is equivalent to not being matched at all.
+    // The matrix is squared with extra rows that can only match at the max
+    // cost. Infinite costs are clipped to a finite max cost (see
+    // finiteMaxCost) so that the vertices left unmatched are chosen by cost,
+    // wherever they are in the search order.
+    m_costs.topRows(nVtxA) = -costs.cwiseMin(-m_maxCost);
+    m_costs.bottomRows(nVtxB - nVtxA).setConstant(m_maxCost);
+    m_labelsA.assign(nVtxB, m_maxCost);
+    m_labelsB.assign(nVtxB, 0);
+    m_matchA.assign(nVtxB, nVtxB);
+    m_matchB.assign(nVtxB, nVtxB);
+    m_solution.clear();
+    m_workspace.visitStamps.assign(nVtxB, 0);
+    m_workspace.epoch = 0;
+    m_workspace.treePredecessors.resize(nVtxB);
+  }
+
+  template <typename T>
+  BasicHungarianSolver<T>::BasicHungarianSolver(
+      const basic_cost_view_t<T>& costs,
+      T maxCost,
+      const match_vec_t& initialMatching,
+      SearchMode mode,
+      BasicSolverWorkspace<T>* workspace)
+    : BasicHungarianSolver(costs, maxCost, mode, workspace)
+  {
+    coldStart(initialMatching);
+    solve();
+    loadSolution(costs, maxCost);
+  }
+
+  template <typename T>
+  BasicHungarianSolver<T>::BasicHungarianSolver(
+      const basic_cost_view_t<T>& costs,
+      T maxCost,
+      BasicDualState<T>& state,
+      SearchMode mode,
+      BasicSolverWorkspace<T>* workspace)
+    : BasicHungarianSolver(costs, maxCost, mode, workspace)
+  {
+    if (state.fits(nVtxA, nVtxB) ) {
+      warmStart(state);
+      solve();
+      // Searching from the unmatched vertices cannot raise the label of an
+      // unmatched 'B' vertex, so this only has to be repeated once
+      if (releaseFreeLabelsB() )
+        solve();
+    }
+    else {
+      coldStart(match_vec_t() );
+      solve();
+    }
+    loadSolution(costs, maxCost);
+    dualState(state);
+  }
+
+  template <typename T>
+  void BasicHungarianSolver<T>::dualState(BasicDualState<T>& state) const
+  {
+    // Internally the solver maximises the negated costs, so its labels are
+    // the negatives of the ones for the minimisation
+    state.labelsA.resize(nVtxA);
+    state.matchA.resize(nVtxA);
+    for (idx_t ia = 0; ia < nVtxA; ++ia) {
+      state.labelsA[ia] = -m_labelsA[ia];
+      state.matchA[ia] = m_matchA[ia] == nVtxB ? -1 : m_matchA[ia];
+    }
+    state.labelsB.resize(nVtxB);
+    state.matchB.resize(nVtxB);
+    for (idx_t ib = 0; ib < nVtxB; ++ib) {
+      state.labelsB[ib] = -m_labelsB[ib];
+      // The dummy rows are never matched but check anyway
+      state.matchB[ib] = m_matchB[ib] < nVtxA ? m_matchB[ib] : -1;
     }
+  }
+
+  template <typename T>
+  BasicDualState<T> BasicHungarianSolver<T>::dualState() const
+  {
+    BasicDualState<T> state;
+    dualState(state);
+    return state;
+  }
+
+  template <typename T>
+  void BasicHungarianSolver<T>::coldStart(const match_vec_t& initialMatching)
+  {
     // Initialise the labels to sensible values
     for (idx_t ia = 0; ia < nVtxA; ++ia)
       m_labelsA[ia] = m_costs.row(ia).maxCoeff();
-    solve();
-    // Now load the solution into the internal vector
+    // Now load the initial matching. Only edges on the equality subgraph can
+    // be kept, otherwise the final matching would not be optimal
+    for (const match_t& m : initialMatching) {
+      if (getSlack(m.first, m.second) != 0)
+        continue;
+      m_matchA[m.first] = m.second;
+      m_matchB[m.second] = m.first;
+    }
+  }
+
+  template <typename T>
+  void BasicHungarianSolver<T>::warmStart(const BasicDualState<T>& state)
+  {
+    // Shift the 'B' labels so that the smallest is zero, as for a cold start.
+    // This leaves the slacks unchanged and stops the labels drifting over a
+    // long sequence of problems.
+    T minLabelB = 0;
+    for (idx_t ib = 0; ib < nVtxB; ++ib)
+      if (ib == 0 || -state.labelsB[ib] < minLabelB)
+        minLabelB = -state.labelsB[ib];
+    for (idx_t ib = 0; ib < nVtxB; ++ib)
+      m_labelsB[ib] = -state.labelsB[ib] - minLabelB;
+    // Keep the matches that the two sides agree on. The dummy rows are left
+    // unmatched
     for (idx_t ia = 0; ia < nVtxA; ++ia) {
-      if (costs.coeff(ia, m_matchA[ia]) < maxCost)
-        m_solution.push_back(std::make_pair(ia, m_matchA[ia]) );
+      idx_t ib = state.matchA[ia];
+      if (ib >= 0 && ib < nVtxB && state.matchB[ib] == ia) {
+        m_matchA[ia] = ib;
+        m_matchB[ib] = ia;
+      }
+    }
+    // Give each 'A' vertex the smallest label that is feasible with the 'B'
+    // labels, which puts at least one of its edges on the equality subgraph.
+    // Keep its match only if that edge is one of them. The test is made on
+    // the same expression as the maximum so it is exact for floating point
+    // costs too.
+    Eigen::Map<const Eigen::Matrix<T, 1, Eigen::Dynamic>> labelsB(
+        m_labelsB.data(), nVtxB);
+    for (idx_t ia = 0; ia < nVtxA; ++ia) {
+      m_labelsA[ia] = (m_costs.row(ia) - labelsB).maxCoeff();
+      idx_t ib = m_matchA[ia];
+      if (ib != nVtxB &&
+          m_costs.coeff(ia, ib) - m_labelsB[ib] != m_labelsA[ia]) {
+        m_matchA[ia] = nVtxB;
+        m_matchB[ib] = nVtxB;
+      }
     }
   }
 
-  void HungarianSolver::solve() 
+  template <typename T>
+  bool BasicHungarianSolver<T>::releaseFreeLabelsB()
   {
-    // Begin by looking for an unmatched 'A' vertex
-    // We can stop this search at nVtxA as we don't care about what the extra
-    // dummy vertices match to
-    while (true) {
-      idx_t ia = 0;
-      for (; ia < nVtxA; ++ia)
-        if (m_matchA[ia] == nVtxB)
-          break;
-      if (ia == nVtxA)
-        // This means that the matching is complete!
-        return;
-      breadthFirstSearch(ia);
+    // The dummy rows have to be able to take any 'B' vertex left unmatched,
+    // which is only free if its label is the smallest one, zero. After a warm
+    // start some may still have the label they had when they were matched.
+    std::vector<idx_t>& lowered = m_workspace.listB;
+    std::vector<idx_t>& freed = m_workspace.listA;
+    lowered.clear();
+    for (idx_t ib = 0; ib < nVtxB; ++ib)
+      if (m_matchB[ib] == nVtxB && m_labelsB[ib] > 0)
+        lowered.push_back(ib);
+    if (lowered.empty() )
+      return false;
+    // Lowering these labels raises the labels of the 'A' vertices next to
+    // them, which takes their matches off the equality subgraph and frees
+    // more 'B' vertices. Only the columns that were lowered have to be read.
+    while (!lowered.empty() ) {
+      for (idx_t ib : lowered)
+        m_labelsB[ib] = 0;
+      freed.clear();
+      for (idx_t ia = 0; ia < nVtxA; ++ia) {
+        T label = m_labelsA[ia];
+        for (idx_t ib : lowered)
+          label = std::max(label, m_costs.coeff(ia, ib) );
+        if (!(label > m_labelsA[ia]) )
+          continue;
+        m_labelsA[ia] = label;
+        idx_t matched = m_matchA[ia];
+        if (matched != nVtxB) {
+          m_matchA[ia] = nVtxB;
+          m_matchB[matched] = nVtxB;
+          if (m_labelsB[matched] > 0)
+            freed.push_back(matched);
+        }
+      }
+      lowered.swap(freed);
     }
+    return true;
   }
 
-  float HungarianSolver::getSlack(idx_t a, idx_t b) const
+  template <typename T>
+  void BasicHungarianSolver<T>::solve()
+  {
+    // Search from each unmatched 'A' vertex in turn. Augmenting never
+    // unmatches a vertex so one pass is enough, and a vertex that can't be
+    // matched is left alone rather than searched from again.
+    // We can stop at nVtxA as we don't care about what the extra dummy
+    // vertices match to
+    for (idx_t ia = 0; ia < nVtxA; ++ia) {
+      if (m_matchA[ia] != nVtxB)
+        continue;
+      if (searchMode == SearchMode::Incremental)
+        incrementalAugment(m_costs, ia, m_workspace);
+      else
+        breadthFirstSearch(ia);
+    }
+  }
+
+  template <typename T>
+  void BasicHungarianSolver<T>::loadSolution(
+      const basic_cost_view_t<T>& costs,
+      T maxCost)
+  {
+    for (idx_t ia = 0; ia < nVtxA; ++ia) {
+      if (m_matchA[ia] != nVtxB && costs.coeff(ia, m_matchA[ia]) < maxCost)
+        m_solution.push_back(std::make_pair(ia, m_matchA[ia]) );
+    }
+  }
+
+  template <typename T>
+  T BasicHungarianSolver<T>::getSlack(idx_t a, idx_t b) const
   {
     return m_labelsA[a] + m_labelsB[b] - m_costs.coeff(a, b);
   }
 
-  void HungarianSolver::breadthFirstSearch(idx_t root)
+  template <typename T>
+  bool BasicHungarianSolver<T>::breadthFirstSearch(idx_t root)
   {
     // This is a search for any unmatched 'B' node
 
@@ -72,45 +254,56 @@ namespace SparseHungarian {
     // Vertices which are matched to each other act as single vertices as far as
     // the search is concerned. Therefore we only need to keep track of the root
     // node and which 'B' nodes we have visited.
-    std::vector<bool> visitedB(nVtxB, false);
+    // A vertex is visited if its stamp is the current epoch, so starting a
+    // new search clears them all
+    std::vector<std::size_t>& visitStamps = m_workspace.visitStamps;
+    std::size_t epoch = ++m_workspace.epoch;
+    auto visitedB = [&visitStamps, epoch] (idx_t ib) {
+      return visitStamps[ib] == epoch;
+    };
 
     // The path describes how to go *back* through the tree to the root node -
-    // this is the only way we will traverse the tree so it's all we need
-    std::map<idx_t, idx_t> path;
+    // this is the only way we will traverse the tree so it's all we need. Only
+    // the entries of visited vertices (and the end of the path) are valid.
+    std::vector<idx_t>& path = m_workspace.treePredecessors;
 
     // Keep track of the slacks on the edges between 'A' nodes in the equality
     // subgraph and 'B' nodes outside of it. The index of this vector is the 'B'
     // index
-    std::vector<float> slacks;
-    slacks.reserve(nVtxB);
+    std::vector<T>& slacks = m_workspace.slacks;
+    slacks.resize(nVtxB);
     for (idx_t ib = 0; ib < nVtxB; ++ib)
-      slacks.push_back(getSlack(root, ib) );
+      slacks[ib] = getSlack(root, ib);
     // Also keep track of which 'A' index that corresponds to. This enables
     // skipping a few steps after updating the labels.
-    std::vector<idx_t> minSlackIdx(nVtxB, root);
-    // Keep track of the vertices queued up to be inspected
-    std::queue<idx_t> vtxQueue;
-    vtxQueue.push(root);
+    std::vector<idx_t>& minSlackIdx = m_workspace.predecessors;
+    minSlackIdx.assign(nVtxB, root);
+    // Keep track of the vertices queued up to be inspected. Every 'A' vertex
+    // is queued at most once so the queue is just a list and a read position.
+    std::vector<idx_t>& vtxQueue = m_workspace.listA;
+    vtxQueue.clear();
+    vtxQueue.push_back(root);
+    std::size_t queueFront = 0;
 
     while (true) {
-      idx_t current = vtxQueue.front();
-      vtxQueue.pop();
+      idx_t current = vtxQueue[queueFront++];
       // Find an edge on the equality subgraph leaving from this vertex
       for (idx_t ib = 0; ib < nVtxB; ++ib) {
-        float slack = getSlack(current, ib);
+        T slack = getSlack(current, ib);
         if (slack == 0) { // This is on the equality subgraph
-          if (visitedB[ib])
+          if (visitedB(ib) )
             continue;
           // This is an interesting vertex
           path[ib] = current;
           if (m_matchB[ib] == nVtxB) {
             // it's unmatched! That means we have an alternating augmenting path
-            return augmentPath(path, ib);
+            augmentPath(path, ib);
+            return true;
           }
           else {
             // Add it to the queue and move on...
-            visitedB[ib] = true;
-            vtxQueue.push(m_matchB[ib]);
+            visitStamps[ib] = epoch;
+            vtxQueue.push_back(m_matchB[ib]);
           }
         }
         else if (slack < slacks[ib]) {
@@ -119,15 +312,15 @@ namespace SparseHungarian {
           minSlackIdx[ib] = current;
         }
       }
-      if (vtxQueue.size() == 0) {
+      if (queueFront == vtxQueue.size() ) {
         // Being here means that we didn't find the alternating path
         // This means that we need better labelling
         // We find the minimum slack on a vertex heading out of the equality
         // subgraph
-        float delta = std::numeric_limits<float>::infinity();
+        T delta = CostTraits<T>::largest();
         idx_t minIdx = nVtxB;
         for (idx_t ib = 0; ib < nVtxB; ++ib) {
-          if (visitedB[ib])
+          if (visitedB(ib) )
             // Iff we visited it then it's on the subgraph and we're not
             // interested
             continue;
@@ -136,37 +329,153 @@ namespace SparseHungarian {
             minIdx = ib;
           }
         }
+        // The costs are clipped to a finite max cost, but guard against a
+        // root with no finite slack to any vertex anyway. It can't be matched
+        if (minIdx == nVtxB || !std::isfinite(static_cast<double>(delta) ) )
+          return false;
         // Now we update the labelling. Subtract delta from every 'A' vertex in
         // the equality subgraph and add it to every 'B' vertex in the equality
         // subgraph. This therefore has the effect of adding in a new vertex
         // into the subgraph, the one whose slack we just made 0! That vertex's
-        // index is given by minIdx;
+        // index is given by minIdx. The edges already in the subgraph keep
+        // their slack and those leaving it lose delta.
+        for (idx_t ia : vtxQueue)
+          m_labelsA[ia] -= delta;
+        for (idx_t ib = 0; ib < nVtxB; ++ib) {
+          if (visitedB(ib) )
+            m_labelsB[ib] += delta;
+          else
+            slacks[ib] -= delta;
+        }
         path[minIdx] = minSlackIdx[minIdx];
         if (m_matchB[minIdx] == nVtxB) {
           // It's unmatched!
-          return augmentPath(path, minIdx);
+          augmentPath(path, minIdx);
+          return true;
         }
         else {
-          visitedB[minIdx] = true;
-          vtxQueue.push(m_matchB[minIdx]);
+          visitStamps[minIdx] = epoch;
+          vtxQueue.push_back(m_matchB[minIdx]);
           // And so we go on again :)
         }
       }
     }
   }
 
-  void HungarianSolver::augmentPath(
-      const std::map<idx_t, idx_t>& path,
+  template <typename T>
+  bool incrementalAugment(
+      const basic_padded_matrix_t<T>& costs,
+      idx_t root,
+      BasicSolverWorkspace<T>& workspace)
+  {
+    const idx_t nVtxB = costs.cols();
+    std::vector<T>& labelsA = workspace.labelsA;
+    std::vector<T>& labelsB = workspace.labelsB;
+    std::vector<idx_t>& matchA = workspace.matchA;
+    std::vector<idx_t>& matchB = workspace.matchB;
+    // This is the same search as breadthFirstSearch, but the labels are
+    // updated as soon as the tree cannot grow and the slacks are corrected in
+    // place rather than recomputed. Each step therefore only has to scan the
+    // row of the newest 'A' vertex in the tree, and each step adds one 'B'
+    // vertex to the tree, so finding the path from one root costs
+    // O(nVtxA nVtxB).
+    // Only the rows of vertices that join the tree are read. The solver's
+    // dummy rows are never matched, so they are never read.
+    // The vertices currently in the tree, needed to update the labels
+    std::vector<idx_t>& treeA = workspace.listA;
+    std::vector<idx_t>& treeB = workspace.listB;
+    treeA.clear();
+    treeB.clear();
+    // The minimum slack between the tree and each 'B' vertex outside of it.
+    // Vertices in the tree have the tree slack (NaN for floating point
+    // costs), which is never picked as the minimum nor updated.
+    std::vector<T>& slacks = workspace.slacks;
+    slacks.assign(nVtxB, CostTraits<T>::largest() );
+    // The 'A' vertex giving that minimum. When a 'B' vertex joins the tree this
+    // is the vertex it joins through, so this also records the path back to the
+    // root
+    std::vector<idx_t>& minSlackIdx = workspace.predecessors;
+    minSlackIdx.assign(nVtxB, nVtxB);
+    const T treeSlack = SlackKernels::treeSlack<T>();
+    SlackKernels::kernel_t<T> updateSlacks = SlackKernels::bestKernel<T>();
+
+    idx_t current = root;
+    treeA.push_back(root);
+    while (true) {
+      // Update the slacks with the edges leaving the newest 'A' vertex and
+      // find the smallest slack leaving the tree
+      T delta;
+      idx_t minIdx = updateSlacks(costs.row(current).data(),
+          labelsA[current], labelsB.data(), slacks.data(),
+          minSlackIdx.data(), current, nVtxB, delta);
+      // A root whose costs are all infinite has NaN slacks, so nothing is
+      // picked. Stop before the labels are spoiled and leave it unmatched
+      if (minIdx == nVtxB || !std::isfinite(static_cast<double>(delta) ) )
+        return false;
+      // If the smallest slack is not zero then update the labels so that it
+      // is. Subtracting delta from the tree's 'A' vertices and adding it to
+      // its 'B' vertices leaves the tree's edges on the equality subgraph.
+      if (delta > 0) {
+        for (idx_t ia : treeA)
+          labelsA[ia] -= delta;
+        for (idx_t ib : treeB)
+          labelsB[ib] += delta;
+        // This leaves the NaNs alone. The integer tree slack has to be
+        // skipped explicitly
+        for (idx_t ib = 0; ib < nVtxB; ++ib)
+          if (!CostTraits<T>::isExact || slacks[ib] != treeSlack)
+            slacks[ib] -= delta;
+      }
+      // minIdx is now connected to the tree through the equality subgraph
+      if (matchB[minIdx] == nVtxB) {
+        // It's unmatched! Augment back along the path to the root
+        do {
+          idx_t nextA = minSlackIdx[minIdx];
+          idx_t nextB = matchA[nextA];
+          matchB[minIdx] = nextA;
+          matchA[nextA] = minIdx;
+          minIdx = nextB;
+        }
+        while (minIdx != nVtxB);
+        return true;
+      }
+      slacks[minIdx] = treeSlack;
+      treeB.push_back(minIdx);
+      current = matchB[minIdx];
+      treeA.push_back(current);
+    }
+  }
+
+  template <typename T>
+  void BasicHungarianSolver<T>::augmentPath(
+      const std::vector<idx_t>& path,
       idx_t end)
   {
     do {
-      idx_t nextA = path.at(end);
+      idx_t nextA = path[end];
       idx_t nextB = m_matchA[nextA];
-      m_matchB[end] = path.at(end);
+      m_matchB[end] = nextA;
       m_matchA[nextA] = end;
       end = nextB;
     }
     // m_matchA[root] = nVtxB
     while (end != nVtxB);
   }
+
+  template bool incrementalAugment(
+      const basic_padded_matrix_t<float>&, idx_t, BasicSolverWorkspace<float>&);
+  template bool incrementalAugment(
+      const basic_padded_matrix_t<double>&, idx_t,
+      BasicSolverWorkspace<double>&);
+  template bool incrementalAugment(
+      const basic_padded_matrix_t<std::int32_t>&, idx_t,
+      BasicSolverWorkspace<std::int32_t>&);
+  template bool incrementalAugment(
+      const basic_padded_matrix_t<std::int64_t>&, idx_t,
+      BasicSolverWorkspace<std::int64_t>&);
+
+  template class BasicHungarianSolver<float>;
+  template class BasicHungarianSolver<double>;
+  template class BasicHungarianSolver<std::int32_t>;
+  template class BasicHungarianSolver<std::int64_t>;
 }
@@ -0,0 +1,304 @@
+#include "SparseHungarian/JVSolver.h"
+#include <exception>
+#include <stdexcept>
+
+namespace SparseHungarian {
+  template <typename T>
+  BasicJVSolver<T>::BasicJVSolver(
+      const basic_cost_view_t<T>& costs,
+      T maxCost,
+      const match_vec_t& initialMatching,
+      BasicSolverWorkspace<T>* workspace)
+    :
+      nVtxA(costs.rows() ),
+      nVtxB(costs.cols() ),
+      m_ownWorkspace(workspace ? nullptr : new BasicSolverWorkspace<T>() ),
+      m_workspace(workspace ? *workspace : *m_ownWorkspace),
+      m_costs(m_workspace.paddedCosts(nVtxA, nVtxB) ),
+      m_prices(m_workspace.labelsB),
+      m_solution(m_workspace.solution),
+      m_matchA(m_workspace.matchA),
+      m_matchB(m_workspace.matchB),
+      m_free(m_workspace.listA)
+  {
+    // Make sure that the input matrix is correct
+    if (nVtxA > nVtxB)
+      throw std::runtime_error("Invalid matrix supplied to JVSolver"
+          "The matrix must have nRows <= nCols!");
+    // Anything above the max cost is equivalent to not being matched at all.
+    // Infinite costs would spoil the prices, so they are clipped to a finite
+    // max cost (see finiteMaxCost). This covers rows and columns that are
+    // entirely infinite, which the transpose in match turns into each other.
+    // Those edges are dropped from the solution below
+    m_costs = costs.cwiseMin(finiteMaxCost(costs, maxCost) );
+    m_prices.assign(nVtxB, 0);
+    m_matchA.assign(nVtxB, nVtxB);
+    m_matchB.assign(nVtxB, nVtxB);
+    m_free.clear();
+    m_solution.clear();
+    if (nVtxA == 0)
+      return;
+    if (nVtxB == 1) {
+      // The only possible matching, and the initialisation below needs at
+      // least two columns
+      m_matchA[0] = 0;
+      m_matchB[0] = 0;
+    }
+    else {
+      columnReduction(initialMatching);
+      augmentingRowReduction();
+      // Anything still free needs a full search
+      for (idx_t freeRow : m_free)
+        augment(freeRow);
+    }
+    // Now load the solution into the internal vector
+    for (idx_t ia = 0; ia < nVtxA; ++ia) {
+      if (m_matchA[ia] != nVtxB && costs.coeff(ia, m_matchA[ia]) < maxCost)
+        m_solution.push_back(std::make_pair(ia, m_matchA[ia]) );
+    }
+  }
+
+  template <typename T>
+  void BasicJVSolver<T>::columnReduction(const match_vec_t& initialMatching)
+  {
+    // The problem is made square by adding dummy 'A' vertices which have a
+    // cost of 0 to every 'B' vertex. Every 'A' vertex is matched in the final
+    // solution and any matched to its cheapest 'B' vertex (after subtracting
+    // the prices) is consistent with the prices.
+    idx_t n = nVtxB;
+    // Start by setting each price to its column's minimum. Walk the matrix
+    // row by row to match its memory layout.
+    std::vector<idx_t>& minRow = m_workspace.predecessors;
+    minRow.assign(n, 0);
+    for (idx_t ib = 0; ib < n; ++ib)
+      m_prices[ib] = m_costs.coeff(0, ib);
+    for (idx_t ia = 1; ia < nVtxA; ++ia) {
+      for (idx_t ib = 0; ib < n; ++ib) {
+        T cost = m_costs.coeff(ia, ib);
+        if (cost < m_prices[ib]) {
+          m_prices[ib] = cost;
+          minRow[ib] = ia;
+        }
+      }
+    }
+    // The dummy vertices are all equivalent so hand each column won by a dummy
+    // vertex a different one while they last
+    if (nVtxA < n) {
+      idx_t nextDummy = nVtxA;
+      for (idx_t ib = 0; ib < n; ++ib) {
+        if (m_prices[ib] > 0) {
+          m_prices[ib] = 0;
+          minRow[ib] = nextDummy < n ? nextDummy++ : nVtxA;
+        }
+      }
+    }
+
+    // Keep any of the initial matches for which the 'B' vertex is the
+    // cheapest for its 'A' vertex
+    for (const match_t& m : initialMatching) {
+      if (m_matchA[m.first] != n || m_matchB[m.second] != n)
+        continue;
+      T reduced = getCost(m.first, m.second) - m_prices[m.second];
+      bool cheapest = true;
+      for (idx_t ib = 0; ib < n && cheapest; ++ib)
+        cheapest = getCost(m.first, ib) - m_prices[ib] >= reduced;
+      if (!cheapest)
+        continue;
+      m_matchA[m.first] = m.second;
+      m_matchB[m.second] = m.first;
+    }
+    // Now match each column to its minimum row, if that row is still free.
+    // This order matches the original algorithm
+    for (idx_t ib = n - 1; ib >= 0; --ib) {
+      idx_t ia = minRow[ib];
+      if (m_matchB[ib] != n || m_matchA[ia] != n)
+        continue;
+      m_matchA[ia] = ib;
+      m_matchB[ib] = ia;
+    }
+
+    // Reduction transfer. For each matched row lower the price of its column
+    // as far as possible while keeping it the cheapest for that row. This
+    // makes the column cheaper for everyone else.
+    for (idx_t ia = 0; ia < n; ++ia) {
+      idx_t matched = m_matchA[ia];
+      if (matched == n) {
+        m_free.push_back(ia);
+        continue;
+      }
+      T minReduced = CostTraits<T>::largest();
+      for (idx_t ib = 0; ib < n; ++ib) {
+        if (ib == matched)
+          continue;
+        T reduced = getCost(ia, ib) - m_prices[ib];
+        if (reduced < minReduced)
+          minReduced = reduced;
+      }
+      m_prices[matched] = getCost(ia, matched) - minReduced;
+    }
+  }
+
+  template <typename T>
+  void BasicJVSolver<T>::augmentingRowReduction()
+  {
+    idx_t n = nVtxB;
+    // Two passes is the standard choice. Each free row is moved to its
+    // cheapest column, displacing that column's row. If the cheapest column is
+    // strictly cheaper than the next cheapest then its price can be lowered by
+    // the difference and the displaced row is immediately processed again.
+    for (unsigned int pass = 0; pass < 2; ++pass) {
+      std::vector<idx_t>& freeRows = m_workspace.listB;
+      freeRows.clear();
+      freeRows.swap(m_free);
+      std::size_t k = 0;
+      while (k < freeRows.size() ) {
+        idx_t ia = freeRows[k++];
+        // Find the cheapest and second cheapest columns
+        T uMin = getCost(ia, 0) - m_prices[0];
+        T uSubMin = CostTraits<T>::largest();
+        idx_t b1 = 0;
+        idx_t b2 = 0;
+        for (idx_t ib = 1; ib < n; ++ib) {
+          T reduced = getCost(ia, ib) - m_prices[ib];
+          if (reduced < uSubMin) {
+            if (reduced >= uMin) {
+              uSubMin = reduced;
+              b2 = ib;
+            }
+            else {
+              uSubMin = uMin;
+              uMin = reduced;
+              b2 = b1;
+              b1 = ib;
+            }
+          }
+        }
+        idx_t displaced = m_matchB[b1];
+        // Lower the price so that b1 stays the cheapest column for this row.
+        // A difference too small to change the price in floating point would
+        // let two rows swap the column back and forth forever, so the
+        // displaced row is only reprocessed if the price really dropped.
+        T lowered = m_prices[b1] - (uSubMin - uMin);
+        bool reprocess = lowered < m_prices[b1];
+        if (uMin < uSubMin)
+          m_prices[b1] = lowered;
+        else if (displaced != n) {
+          // The two columns are equally cheap so prefer one that avoids
+          // displacing another row
+          b1 = b2;
+          displaced = m_matchB[b2];
+        }
+        m_matchA[ia] = b1;
+        m_matchB[b1] = ia;
+        if (displaced != n) {
+          m_matchA[displaced] = n;
+          if (reprocess)
+            // Reprocess it straight away
+            freeRows[--k] = displaced;
+          else
+            m_free.push_back(displaced);
+        }
+      }
+    }
+  }
+
+  template <typename T>
+  void BasicJVSolver<T>::augment(idx_t freeRow)
+  {
+    // This is a Dijkstra search for the shortest augmenting path from the free
+    // row, using the prices as potentials
+    idx_t n = nVtxB;
+    // The shortest path length to each column
+    std::vector<T>& dist = m_workspace.slacks;
+    dist.resize(n);
+    // The row preceding each column on the shortest path
+    std::vector<idx_t>& pred = m_workspace.predecessors;
+    pred.assign(n, freeRow);
+    // The columns, partitioned into those that are finished ([0, low)), those
+    // at the current minimum distance ([low, up)) and the rest ([up, n))
+    std::vector<idx_t>& columns = m_workspace.listB;
+    columns.resize(n);
+    for (idx_t ib = 0; ib < n; ++ib) {
+      dist[ib] = getCost(freeRow, ib) - m_prices[ib];
+      columns[ib] = ib;
+    }
+    idx_t low = 0;
+    idx_t up = 0;
+    idx_t last = 0;
+    idx_t end = n;
+    T minDist = 0;
+    while (end == n) {
+      if (up == low) {
+        // Find the columns with the new minimum distance
+        last = low;
+        minDist = dist[columns[up++]];
+        for (idx_t k = up; k < n; ++k) {
+          idx_t ib = columns[k];
+          T d = dist[ib];
+          if (d <= minDist) {
+            if (d < minDist) {
+              up = low;
+              minDist = d;
+            }
+            columns[k] = columns[up];
+            columns[up++] = ib;
+          }
+        }
+        // The clipped costs keep every distance finite, but if that fails no
+        // column can be reached. Stop and leave the row unmatched rather than
+        // search forever
+        if (!(minDist < CostTraits<T>::largest() ) )
+          return;
+        // If any of these are unmatched then we have the path
+        for (idx_t k = low; k < up; ++k) {
+          if (m_matchB[columns[k]] == n) {
+            end = columns[k];
+            break;
+          }
+        }
+      }
+      if (end != n)
+        break;
+      // Scan from the row matched to the next column at the minimum distance
+      idx_t b1 = columns[low++];
+      idx_t ia = m_matchB[b1];
+      T h = getCost(ia, b1) - m_prices[b1] - minDist;
+      for (idx_t k = up; k < n; ++k) {
+        idx_t ib = columns[k];
+        T d = getCost(ia, ib) - m_prices[ib] - h;
+        if (d < dist[ib]) {
+          pred[ib] = ia;
+          if (d == minDist) {
+            if (m_matchB[ib] == n) {
+              end = ib;
+              break;
+            }
+            columns[k] = columns[up];
+            columns[up++] = ib;
+          }
+          dist[ib] = d;
+        }
+      }
+    }
+    // Update the prices of the finished columns
+    for (idx_t k = 0; k < last; ++k) {
+      idx_t ib = columns[k];
+      m_prices[ib] += dist[ib] - minDist;
+    }
+    // Augment along the path
+    idx_t ia;
+    do {
+      ia = pred[end];
+      m_matchB[end] = ia;
+      idx_t next = m_matchA[ia];
+      m_matchA[ia] = end;
+      end = next;
+    }
+    while (ia != freeRow);
+  }
+
+  template class BasicJVSolver<float>;
+  template class BasicJVSolver<double>;
+  template class BasicJVSolver<std::int32_t>;
+  template class BasicJVSolver<std::int64_t>;
+}
@@ -1,53 +1,61 @@
 #include "SparseHungarian/Matching.h"
 #include "SparseHungarian/HungarianSolver.h"
+#include "SparseHungarian/JVSolver.h"
+#include "SparseHungarian/AuctionSolver.h"
+#include "SparseHungarian/ShortestPathSolver.h"
+#include "SparseHungarian/FixedSizeSolver.h"
+#include "SparseHungarian/BoundedQueue.h"
 #include <algorithm>
-#include <map>
+#include <atomic>
+#include <thread>
 
 #include <exception>
 
 namespace {
-  // helper functions for accessing the search record
   using SparseHungarian::idx_t;
-  idx_t& getWithDefault(
-      std::map<idx_t, idx_t>& map,
-      idx_t index,
-      idx_t defaultValue = 0)
-  {
-    auto itr = map.find(index);
-    if (itr == map.end() )
-      itr = map.insert(std::make_pair(index, defaultValue) ).first;
-    return itr->second;
-  }
+  // The smallest problem (in the smaller dimension) for which the automatic
+  // solver choice uses the JVSolver
+  const idx_t minJVSize = 8;
 
-  // Check the value stored under a key in the map.
-  // If the value is missing then return false
-  bool checkValueMissing(
-      std::map<idx_t, idx_t>& map,
-      idx_t index,
-      idx_t comparison)
+  // The auction solver works in float precision so convert anything else
+  template <typename T>
+  SparseHungarian::match_vec_t auctionSolution(
+      const SparseHungarian::basic_cost_view_t<T>& costs,
+      T maxCost)
   {
-    auto itr = map.find(index);
-    if (itr == map.end() )
-      return false;
-    else
-      return itr->second == comparison;
+    using namespace SparseHungarian;
+    // Keep an unlimited max cost unlimited
+    float floatMaxCost = maxCost == CostTraits<T>::unlimited() ?
+      std::numeric_limits<float>::infinity() : static_cast<float>(maxCost);
+    return AuctionSolver(costs.template cast<float>(), floatMaxCost).solution();
   }
-}
 
-namespace SparseHungarian {
-  match_vec_t match(
-      const cost_matrix_t& costs,
-      float maxCost)
+  // Perform the matching, leaving the result in workspace.matches
+  template <typename T>
+  void matchInto(
+      const SparseHungarian::basic_cost_view_t<T>& costs,
+      T maxCost,
+      SparseHungarian::Solver solver,
+      SparseHungarian::BasicSolverWorkspace<T>& workspace)
   {
+    using namespace SparseHungarian;
+    match_vec_t& matches = workspace.matches;
+    matches.clear();
+    // Tiny problems are cheapest to solve directly
+    if (solver == Solver::Automatic && matchFixedSize(costs, maxCost, matches) )
+      return;
     // Not required to receive a square matrix, however it's much simpler if we
     // can assume that nRows <= nCols. Therefore if this isn't the case, just
     // flip the cost matrix
     if (costs.rows() > costs.cols() ) {
-      match_vec_t matches;
-      match_vec_t flippedMatch = match(costs.transpose(), maxCost);
-      for (const match_t& match : flippedMatch)
-        matches.push_back(std::make_pair(match.second, match.first) );
-      return matches;
+      // The view of the transpose just swaps the strides
+      basic_cost_view_t<T> flipped(costs.data(), costs.cols(), costs.rows(),
+          Eigen::Stride<Eigen::Dynamic, Eigen::Dynamic>(
+            costs.innerStride(), costs.outerStride() ) );
+      matchInto(flipped, maxCost, solver, workspace);
+      for (match_t& match : matches)
+        std::swap(match.first, match.second);
+      return;
     }
 
     // First a quick reminder of notation - 'set A' is the smaller set
@@ -58,15 +66,17 @@ namespace SparseHungarian {
 
     // Start by attempting a very simple matching - just match every element in
     // A to the closest element in B
-    match_vec_t matches;
     idx_t nMatchA(costs.rows() ); // number of objects being matched from A
     idx_t nMatchB(costs.cols() ); // number of objects being matched from B
     matches.reserve(nMatchA);
     bool valid = true; // Whether or not the simple match is valid
-    std::vector<bool> matchedIndices(costs.cols(), false);
+    std::vector<bool>& matchedIndices = workspace.usedB;
+    matchedIndices.assign(nMatchB, false);
     for (idx_t ia = 0; ia < nMatchA; ++ia) {
       idx_t minIdx;
-      if (costs.row(ia).minCoeff(&minIdx) <= maxCost) {
+      // As in the solvers, a cost at the max cost is not a match. Nor is an
+      // infinite cost, even with an unlimited max cost
+      if (costs.row(ia).minCoeff(&minIdx) < maxCost) {
         valid &= !matchedIndices[minIdx];
         if (!valid) // stop trying the instant a conflict is found
           break;
@@ -75,32 +85,336 @@ namespace SparseHungarian {
       }
     }
     if (valid)
-      return matches;
+      return;
 
-    HungarianSolver solver(costs, maxCost, matches);
-    return solver.solution();
+    if (solver == Solver::Automatic)
+      // The JV initialisation costs a few passes over the matrix which only
+      // pays off once the problem is reasonably large
+      solver = nMatchA < minJVSize ? Solver::Hungarian : Solver::JonkerVolgenant;
+    // The solvers leave their solution in the workspace
+    if (solver == Solver::JonkerVolgenant)
+      BasicJVSolver<T>(costs, maxCost, matches, &workspace);
+    else if (solver == Solver::Auction)
+      workspace.solution = auctionSolution(costs, maxCost);
+    else
+      BasicHungarianSolver<T>(costs, maxCost, matches,
+          HungarianSearchMode::Incremental, &workspace);
+    matches.assign(workspace.solution.begin(), workspace.solution.end() );
+  }
+
+  // Solve a group, appending its matches in terms of the full problem's
+  // indices
+  template <typename T>
+  void appendGroupMatches(
+      const SparseHungarian::BasicSparseGroup<T>& group,
+      SparseHungarian::Solver solver,
+      SparseHungarian::BasicSolverWorkspace<T>& workspace,
+      SparseHungarian::match_vec_t& matches)
+  {
+    using namespace SparseHungarian;
+    if (group.isStar() ) {
+      matches.push_back(std::make_pair(
+            group.indicesA[group.starMatch.first],
+            group.indicesB[group.starMatch.second]) );
+      return;
+    }
+    std::size_t start = matches.size();
+    basic_cost_view_t<T> costs = group.gatherCosts(workspace.groupCosts);
+    // Tiny groups are solved straight into the output
+    if (solver != Solver::Automatic ||
+        !matchFixedSize(costs, group.maxCost, matches) ) {
+      matchInto(costs, group.maxCost, solver, workspace);
+      matches.insert(matches.end(),
+          workspace.matches.begin(), workspace.matches.end() );
+    }
+    for (std::size_t im = start; im < matches.size(); ++im) {
+      matches[im].first = group.indicesA.at(matches[im].first);
+      matches[im].second = group.indicesB.at(matches[im].second);
+    }
   }
+}
 
+namespace SparseHungarian {
+  template <typename T>
+  match_vec_t match(
+      const basic_cost_view_t<T>& costs,
+      std::common_type_t<T> maxCost,
+      Solver solver)
+  {
+    BasicSolverWorkspace<T> workspace;
+    matchInto(costs, maxCost, solver, workspace);
+    return std::move(workspace.matches);
+  }
+
+  template <typename T>
+  const match_vec_t& match(
+      const basic_cost_view_t<T>& costs,
+      std::common_type_t<T> maxCost,
+      BasicSolverWorkspace<T>& workspace,
+      Solver solver)
+  {
+    matchInto(costs, maxCost, solver, workspace);
+    return workspace.matches;
+  }
+
+  match_vec_t match(const SparseCostMatrix& costs)
+  {
+    return ShortestPathSolver(costs).solution();
+  }
+
+  template <typename T>
   match_vec_t sparseMatch(
-      const cost_matrix_t& cost,
-      float maxCost)
+      const basic_cost_view_t<T>& costs,
+      std::common_type_t<T> maxCost,
+      Solver solver)
   {
-    auto groups = splitProblemIntoSparseGroups(cost, maxCost);
-    return matchFromGroups(groups);
+    BasicSolverWorkspace<T> workspace;
+    sparseMatch(costs, maxCost, workspace, solver);
+    return std::move(workspace.sparseMatches);
   }
 
+  template <typename T>
+  const match_vec_t& sparseMatch(
+      const basic_cost_view_t<T>& costs,
+      std::common_type_t<T> maxCost,
+      BasicSolverWorkspace<T>& workspace,
+      Solver solver)
+  {
+    findSparseGroups(costs, maxCost, workspace);
+    match_vec_t& matches = workspace.sparseMatches;
+    matches.clear();
+    for (std::size_t ig = 0; ig < workspace.nGroups(); ++ig) {
+      const idx_t* indicesA =
+        workspace.groupIndicesA.data() + workspace.groupOffsetsA[ig];
+      const idx_t* indicesB =
+        workspace.groupIndicesB.data() + workspace.groupOffsetsB[ig];
+      idx_t nA = workspace.groupOffsetsA[ig + 1] - workspace.groupOffsetsA[ig];
+      idx_t nB = workspace.groupOffsetsB[ig + 1] - workspace.groupOffsetsB[ig];
+      if (nA == 1 || nB == 1) {
+        // The only match in a star group is its cheapest edge
+        match_t m = cheapestEdge(costs, indicesA, nA, indicesB, nB);
+        matches.push_back(std::make_pair(
+              indicesA[m.first], indicesB[m.second]) );
+        continue;
+      }
+      // Gather the group's costs in storage order
+      workspace.groupCosts.resize(nA * nB);
+      Eigen::Map<basic_cost_matrix_t<T>> groupCosts(
+          workspace.groupCosts.data(), nA, nB);
+      for (idx_t ib = 0; ib < nB; ++ib)
+        for (idx_t ia = 0; ia < nA; ++ia)
+          groupCosts(ia, ib) = costs.coeff(indicesA[ia], indicesB[ib]);
+      matchInto(
+          CostViewOf<Eigen::Map<basic_cost_matrix_t<T>>>(groupCosts).view(),
+          maxCost, solver, workspace);
+      for (const match_t& match : workspace.matches)
+        matches.push_back(std::make_pair(
+              indicesA[match.first], indicesB[match.second]) );
+    }
+    return matches;
+  }
+
+  template <typename T>
+  match_vec_t sparseMatch(
+      const basic_cost_view_t<T>& costs,
+      std::common_type_t<T> maxCost,
+      ThreadPool& pool,
+      Solver solver)
+  {
+    struct Queued {
+      // The position of the group in the breadth first order
+      std::size_t index = 0;
+      BasicSparseGroup<T> group;
+    };
+    // What each thread has solved
+    struct Solved {
+      BasicSolverWorkspace<T> workspace;
+      match_vec_t matches;
+      // The index of each group solved and where its matches start
+      std::vector<std::pair<std::size_t, std::size_t>> starts;
+    };
+    BoundedQueue<Queued> queue(4 * pool.size() );
+    std::vector<Solved> solved(pool.size() );
+    std::size_t nGroups = 0;
+    std::atomic<bool> grouped(false);
+    auto solve = [&] (Queued& item, std::size_t thread) {
+      Solved& out = solved[thread];
+      out.starts.emplace_back(item.index, out.matches.size() );
+      appendGroupMatches(item.group, solver, out.workspace, out.matches);
+    };
+    pool.parallelFor(pool.size(), [&] (std::size_t task, std::size_t thread) {
+        Queued item;
+        if (task == 0) {
+          try {
+            streamSparseGroups<T>(costs, maxCost,
+                [&] (BasicSparseGroup<T>& group) {
+                  item.index = nGroups++;
+                  item.group = std::move(group);
+                  // Star groups are already solved
+                  if (item.group.isStar() ) {
+                    solve(item, thread);
+                    return;
+                  }
+                  Queued other;
+                  while (!queue.tryPush(item) )
+                    // Help out rather than wait for space
+                    if (queue.tryPop(other) )
+                      solve(other, thread);
+                }, GroupCosts::View);
+          }
+          catch (...) {
+            grouped = true;
+            throw;
+          }
+          grouped = true;
+        }
+        while (true) {
+          if (queue.tryPop(item) )
+            solve(item, thread);
+          // Nothing is pushed after the flag is set so once it is, an empty
+          // queue stays empty
+          else if (grouped)
+            return;
+          else
+            std::this_thread::yield();
+        }
+      });
+    // Put the matches back into the order of the groups
+    std::vector<std::pair<std::size_t, std::size_t>> where(nGroups);
+    for (std::size_t thread = 0; thread < solved.size(); ++thread)
+      for (std::size_t ii = 0; ii < solved[thread].starts.size(); ++ii)
+        where[solved[thread].starts[ii].first] = std::make_pair(thread, ii);
+    match_vec_t matches;
+    for (const std::pair<std::size_t, std::size_t>& loc : where) {
+      const Solved& out = solved[loc.first];
+      std::size_t begin = out.starts[loc.second].second;
+      std::size_t end = loc.second + 1 < out.starts.size() ?
+        out.starts[loc.second + 1].second : out.matches.size();
+      matches.insert(matches.end(),
+          out.matches.begin() + begin, out.matches.begin() + end);
+    }
+    return matches;
+  }
+
+  match_vec_t sparseMatch(
+      const point_vec_t& pointsA,
+      const point_vec_t& pointsB,
+      float maxDR,
+      Solver solver)
+  {
+    auto groups = splitProblemIntoSparseGroups(pointsA, pointsB, maxDR);
+    return matchFromGroups(groups, solver);
+  }
+
+  template <typename T>
+  match_vec_t matchFromGroups(
+      const std::vector<BasicSparseGroup<T>>& groups,
+      Solver solver)
+  {
+    match_vec_t matches;
+    // Shared by all of the groups, including the buffer that the costs of
+    // groups viewing the full matrix are gathered into
+    BasicSolverWorkspace<T> workspace;
+    for (const BasicSparseGroup<T>& group : groups)
+      appendGroupMatches(group, solver, workspace, matches);
+    return matches;
+  }
+
+  template <typename T>
   match_vec_t matchFromGroups(
-      const std::vector<SparseGroup>& groups)
+      const std::vector<BasicSparseGroup<T>>& groups,
+      ThreadPool& pool,
+      Solver solver)
   {
+    // Schedule the groups from largest to smallest
+    std::vector<std::size_t> order(groups.size() );
+    for (std::size_t ig = 0; ig < groups.size(); ++ig)
+      order[ig] = ig;
+    std::stable_sort(order.begin(), order.end(),
+        [&groups] (std::size_t lhs, std::size_t rhs) {
+          return groups[lhs].indicesA.size() * groups[lhs].indicesB.size() >
+            groups[rhs].indicesA.size() * groups[rhs].indicesB.size();
+        });
+    // Each group writes only into its own slot
+    std::vector<match_vec_t> groupMatches(groups.size() );
+    pool.parallelFor(groups.size(), [&] (std::size_t idx) {
+        const BasicSparseGroup<T>& group = groups[order[idx]];
+        match_vec_t& slot = groupMatches[order[idx]];
+        // Star groups are already solved and are added below
+        if (group.isStar() )
+          return;
+        std::vector<T> buffer;
+        basic_cost_view_t<T> costs = group.gatherCosts(buffer);
+        if (solver != Solver::Automatic ||
+            !matchFixedSize(costs, group.maxCost, slot) )
+          slot = match(costs, group.maxCost, solver);
+        for (match_t& match : slot) {
+          match.first = group.indicesA.at(match.first);
+          match.second = group.indicesB.at(match.second);
+        }
+      });
+    std::size_t nMatches = 0;
+    for (std::size_t ig = 0; ig < groups.size(); ++ig)
+      nMatches += groups[ig].isStar() ? 1 : groupMatches[ig].size();
     match_vec_t matches;
-    for (const SparseGroup& group : groups) {
-      match_vec_t groupMatch = match(group.costs, group.maxCost);
-      for (const match_t& match : groupMatch) {
+    matches.reserve(nMatches);
+    for (std::size_t ig = 0; ig < groups.size(); ++ig) {
+      const BasicSparseGroup<T>& group = groups[ig];
+      if (group.isStar() )
         matches.push_back(std::make_pair(
-              group.indicesA.at(match.first),
-              group.indicesB.at(match.second) ) );
+              group.indicesA[group.starMatch.first],
+              group.indicesB[group.starMatch.second]) );
+      else
+        matches.insert(matches.end(),
+            groupMatches[ig].begin(), groupMatches[ig].end() );
+    }
+    return matches;
+  }
+
+  template <typename T>
+  const match_vec_t& matchFromGroups(
+      const BasicGroupArena<T>& arena,
+      BasicSolverWorkspace<T>& workspace,
+      Solver solver)
+  {
+    match_vec_t& matches = workspace.sparseMatches;
+    matches.clear();
+    for (std::size_t ig = 0; ig < arena.size(); ++ig) {
+      typename BasicGroupArena<T>::Group group = arena[ig];
+      if (group.isStar() ) {
+        matches.push_back(std::make_pair(
+              group.indicesA[group.starMatch.first],
+              group.indicesB[group.starMatch.second]) );
+        continue;
       }
+      matchInto(group.costView(), arena.maxCost(), solver, workspace);
+      for (const match_t& match : workspace.matches)
+        matches.push_back(std::make_pair(
+              group.indicesA[match.first], group.indicesB[match.second]) );
     }
     return matches;
   }
+
+#define SparseHungarian_INSTANTIATE(T)                                       \
+  template match_vec_t match<T>(                                             \
+      const basic_cost_view_t<T>&, T, Solver);                               \
+  template const match_vec_t& match<T>(                                      \
+      const basic_cost_view_t<T>&, T, BasicSolverWorkspace<T>&, Solver);     \
+  template match_vec_t sparseMatch<T>(                                       \
+      const basic_cost_view_t<T>&, T, Solver);                               \
+  template const match_vec_t& sparseMatch<T>(                                \
+      const basic_cost_view_t<T>&, T, BasicSolverWorkspace<T>&, Solver);     \
+  template match_vec_t sparseMatch<T>(                                       \
+      const basic_cost_view_t<T>&, T, ThreadPool&, Solver);                  \
+  template match_vec_t matchFromGroups<T>(                                   \
+      const std::vector<BasicSparseGroup<T>>&, Solver);                      \
+  template match_vec_t matchFromGroups<T>(                                   \
+      const std::vector<BasicSparseGroup<T>>&, ThreadPool&, Solver);         \
+  template const match_vec_t& matchFromGroups<T>(                            \
+      const BasicGroupArena<T>&, BasicSolverWorkspace<T>&, Solver);
+  SparseHungarian_INSTANTIATE(float)
+  SparseHungarian_INSTANTIATE(double)
+  SparseHungarian_INSTANTIATE(std::int32_t)
+  SparseHungarian_INSTANTIATE(std::int64_t)
+#undef SparseHungarian_INSTANTIATE
 }
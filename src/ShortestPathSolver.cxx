@@ -0,0 +1,135 @@
+#include "SparseHungarian/ShortestPathSolver.h"
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <functional>
+
+namespace SparseHungarian {
+  ShortestPathSolver::ShortestPathSolver(const SparseCostMatrix& costs)
+    :
+      nVtxA(costs.nRows),
+      nVtxB(costs.nCols),
+      m_costs(costs),
+      m_unmatchedCost(costs.maxCost),
+      m_prices(nVtxB + nVtxA, 0.),
+      m_matchA(nVtxA, nVtxB + nVtxA),
+      m_matchB(nVtxB + nVtxA, nVtxA),
+      m_matchCost(nVtxA, 0.),
+      m_dist(nVtxB + nVtxA, std::numeric_limits<float>::infinity() ),
+      m_pred(nVtxB + nVtxA, nVtxA),
+      m_predCost(nVtxB + nVtxA, 0.),
+      m_done(nVtxB + nVtxA, false)
+  {
+    if (!std::isfinite(m_unmatchedCost) ) {
+      // Make leaving a vertex unmatched more expensive than any change in the
+      // cost of the rest of the matching. Only the finite costs can be part
+      // of it
+      float minCost = std::numeric_limits<float>::infinity();
+      float maxCost = -std::numeric_limits<float>::infinity();
+      for (float cost : costs.costs) {
+        if (std::isfinite(cost) ) {
+          minCost = std::min(minCost, cost);
+          maxCost = std::max(maxCost, cost);
+        }
+      }
+      if (maxCost < minCost) {
+        minCost = 0;
+        maxCost = 0;
+      }
+      m_unmatchedCost = (maxCost - minCost) * nVtxA + std::fabs(maxCost) + 1;
+    }
+    for (idx_t ia = 0; ia < nVtxA; ++ia)
+      augment(ia);
+    // Now load the solution into the internal vector
+    for (idx_t ia = 0; ia < nVtxA; ++ia)
+      if (m_matchA[ia] < nVtxB)
+        m_solution.push_back(std::make_pair(ia, m_matchA[ia]) );
+  }
+
+  void ShortestPathSolver::augment(idx_t root)
+  {
+    using entry_t = std::pair<float, idx_t>;
+    std::priority_queue<entry_t, std::vector<entry_t>, std::greater<entry_t>>
+      heap;
+    // Relax all of the edges leaving an 'A' vertex which is at a distance
+    // offset from the root (ignoring the prices of its matched vertex)
+    auto relax = [&] (idx_t ia, float offset, idx_t ib, float cost) {
+      if (m_done[ib])
+        return;
+      float dist = offset + cost - m_prices[ib];
+      if (dist >= m_dist[ib])
+        return;
+      if (m_dist[ib] == std::numeric_limits<float>::infinity() )
+        m_touched.push_back(ib);
+      m_dist[ib] = dist;
+      m_pred[ib] = ia;
+      m_predCost[ib] = cost;
+      heap.push(std::make_pair(dist, ib) );
+    };
+    auto relaxAll = [&] (idx_t ia, float offset) {
+      for (std::size_t e = m_costs.rowOffsets[ia];
+          e < m_costs.rowOffsets[ia + 1]; ++e)
+        relax(ia, offset, m_costs.cols[e], m_costs.costs[e]);
+      relax(ia, offset, nVtxB + ia, m_unmatchedCost);
+    };
+
+    relaxAll(root, 0);
+    // The root can stay unmatched at a finite cost so this should always find
+    // a path
+    idx_t end = nVtxB + nVtxA;
+    float endDist = 0;
+    while (!heap.empty() ) {
+      entry_t top = heap.top();
+      heap.pop();
+      idx_t ib = top.second;
+      if (m_done[ib] || top.first > m_dist[ib])
+        // Stale entry
+        continue;
+      m_done[ib] = true;
+      idx_t ia = m_matchB[ib];
+      if (ia == nVtxA) {
+        // Unmatched, so this is the end of the path
+        end = ib;
+        endDist = top.first;
+        break;
+      }
+      // Continue through the 'A' vertex matched to this one. The edge between
+      // them has a reduced cost of 0.
+      relaxAll(ia, top.first - m_matchCost[ia] + m_prices[ib]);
+    }
+    if (end == nVtxB + nVtxA) {
+      // Nothing was reached, so leave the root unmatched and the prices as
+      // they were rather than follow a path that doesn't exist
+      resetSearch();
+      return;
+    }
+
+    // Update the prices of the finished vertices, keeping the reduced costs
+    // non-negative and those of the matched edges at 0
+    for (idx_t ib : m_touched)
+      if (m_done[ib])
+        m_prices[ib] += m_dist[ib] - endDist;
+
+    // Augment along the path
+    idx_t ia;
+    do {
+      ia = m_pred[end];
+      idx_t next = m_matchA[ia];
+      m_matchA[ia] = end;
+      m_matchB[end] = ia;
+      m_matchCost[ia] = m_predCost[end];
+      end = next;
+    }
+    while (ia != root);
+    resetSearch();
+  }
+
+  void ShortestPathSolver::resetSearch()
+  {
+    for (idx_t ib : m_touched) {
+      m_dist[ib] = std::numeric_limits<float>::infinity();
+      m_done[ib] = false;
+    }
+    m_touched.clear();
+  }
+}
@@ -0,0 +1,502 @@
+#include "SparseHungarian/SlackKernels.h"
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define SparseHungarian_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace {
+  using SparseHungarian::idx_t;
+  using SparseHungarian::CostTraits;
+  using SparseHungarian::SlackKernels::treeSlack;
+
+  // Whether a < b, treating the tree slack like a NaN. The floating point
+  // comparison already does this
+  template <typename T>
+    inline bool lessThan(T a, T b)
+    {
+      return a < b && (!CostTraits<T>::isExact || a != treeSlack<T>() );
+    }
+
+  // Process elements [begin, n) one at a time. This is the whole scalar kernel
+  // and the tail of the vector ones
+  template <typename T>
+    inline void scalarRange(
+        const T* costs,
+        T labelA,
+        const T* labelsB,
+        T* slacks,
+        idx_t* minSlackIdx,
+        idx_t current,
+        idx_t begin,
+        idx_t n,
+        T& delta,
+        idx_t& minIdx)
+    {
+      for (idx_t ib = begin; ib < n; ++ib) {
+        T slack = labelA + labelsB[ib] - costs[ib];
+        // False if slacks[ib] is the tree slack
+        if (lessThan(slack, slacks[ib]) ) {
+          slacks[ib] = slack;
+          minSlackIdx[ib] = current;
+        }
+        if (lessThan(slacks[ib], delta) ) {
+          delta = slacks[ib];
+          minIdx = ib;
+        }
+      }
+    }
+
+  template <typename T>
+    idx_t scalarKernel(
+        const T* costs,
+        T labelA,
+        const T* labelsB,
+        T* slacks,
+        idx_t* minSlackIdx,
+        idx_t current,
+        idx_t n,
+        T& delta)
+    {
+      delta = CostTraits<T>::largest();
+      idx_t minIdx = n;
+      scalarRange(costs, labelA, labelsB, slacks, minSlackIdx, current, 0, n,
+          delta, minIdx);
+      return minIdx;
+    }
+
+#ifdef SparseHungarian_X86_KERNELS
+  // Reduce the per-lane minima and their indices to the overall minimum and
+  // the first index holding it, then process the elements left over by the
+  // vector loop. Lanes that never saw a value still hold the largest value.
+  template <typename T, int nLanes>
+    idx_t finishKernel(
+        const T (&laneMin)[nLanes],
+        const idx_t (&laneIdx)[nLanes],
+        const T* costs,
+        T labelA,
+        const T* labelsB,
+        T* slacks,
+        idx_t* minSlackIdx,
+        idx_t current,
+        idx_t begin,
+        idx_t n,
+        T& delta)
+    {
+      delta = CostTraits<T>::largest();
+      idx_t minIdx = n;
+      for (int lane = 0; lane < nLanes; ++lane) {
+        if (!(laneMin[lane] < CostTraits<T>::largest() ) )
+          continue;
+        if (laneMin[lane] < delta ||
+            (laneMin[lane] == delta && laneIdx[lane] < minIdx) ) {
+          delta = laneMin[lane];
+          minIdx = laneIdx[lane];
+        }
+      }
+      scalarRange(costs, labelA, labelsB, slacks, minSlackIdx, current, begin,
+          n, delta, minIdx);
+      return minIdx;
+    }
+
+  // The operations used by the vector kernels, for each instruction set and
+  // cost type. The comparisons give a mask with a whole lane per element for
+  // AVX2 and a bit mask for AVX-512.
+#define SparseHungarian_AVX2 __attribute__((target("avx2") ))
+#define SparseHungarian_AVX512 __attribute__((target("avx512f") ))
+  template <typename T>
+    struct Avx2Ops;
+
+  // Index handling for 32 bit elements. The lane indices are kept as 32 bit
+  // integers, which is plenty for a row of any matrix that fits in memory
+  struct Avx2Index32 {
+    static constexpr int lanes = 8;
+    using mask_t = __m256i;
+    using index_t = __m256i;
+    SparseHungarian_AVX2 static index_t firstIndices()
+    { return _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7); }
+    SparseHungarian_AVX2 static index_t nextIndices(index_t idx)
+    { return _mm256_add_epi32(idx, _mm256_set1_epi32(lanes) ); }
+    SparseHungarian_AVX2 static index_t blendIndices(
+        index_t a, index_t b, mask_t mask)
+    { return _mm256_blendv_epi8(a, b, mask); }
+    SparseHungarian_AVX2 static void storeIndices(idx_t* out, index_t idx)
+    {
+      alignas(32) std::int32_t idx32[lanes];
+      _mm256_store_si256(reinterpret_cast<__m256i*>(idx32), idx);
+      for (int lane = 0; lane < lanes; ++lane)
+        out[lane] = idx32[lane];
+    }
+    // Record the current 'A' vertex for the masked lanes, four at a time
+    SparseHungarian_AVX2 static void storeCurrent(
+        idx_t* out, mask_t mask, idx_t current)
+    {
+      const __m256i vCurrent = _mm256_set1_epi64x(current);
+      _mm256_maskstore_epi64(
+          reinterpret_cast<long long*>(out),
+          _mm256_cvtepi32_epi64(_mm256_castsi256_si128(mask) ),
+          vCurrent);
+      _mm256_maskstore_epi64(
+          reinterpret_cast<long long*>(out + 4),
+          _mm256_cvtepi32_epi64(_mm256_extracti128_si256(mask, 1) ),
+          vCurrent);
+    }
+  };
+
+  // Index handling for 64 bit elements
+  struct Avx2Index64 {
+    static constexpr int lanes = 4;
+    using mask_t = __m256i;
+    using index_t = __m256i;
+    SparseHungarian_AVX2 static index_t firstIndices()
+    { return _mm256_setr_epi64x(0, 1, 2, 3); }
+    SparseHungarian_AVX2 static index_t nextIndices(index_t idx)
+    { return _mm256_add_epi64(idx, _mm256_set1_epi64x(lanes) ); }
+    SparseHungarian_AVX2 static index_t blendIndices(
+        index_t a, index_t b, mask_t mask)
+    { return _mm256_blendv_epi8(a, b, mask); }
+    SparseHungarian_AVX2 static void storeIndices(idx_t* out, index_t idx)
+    { _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), idx); }
+    SparseHungarian_AVX2 static void storeCurrent(
+        idx_t* out, mask_t mask, idx_t current)
+    {
+      _mm256_maskstore_epi64(reinterpret_cast<long long*>(out), mask,
+          _mm256_set1_epi64x(current) );
+    }
+  };
+
+  template <>
+    struct Avx2Ops<float> : Avx2Index32 {
+      using vec_t = __m256;
+      SparseHungarian_AVX2 static vec_t set1(float x)
+      { return _mm256_set1_ps(x); }
+      SparseHungarian_AVX2 static vec_t load(const float* ptr)
+      { return _mm256_loadu_ps(ptr); }
+      SparseHungarian_AVX2 static void store(float* ptr, vec_t x)
+      { _mm256_storeu_ps(ptr, x); }
+      SparseHungarian_AVX2 static vec_t add(vec_t a, vec_t b)
+      { return _mm256_add_ps(a, b); }
+      SparseHungarian_AVX2 static vec_t sub(vec_t a, vec_t b)
+      { return _mm256_sub_ps(a, b); }
+      // Ordered comparison, so false for the NaN slacks
+      SparseHungarian_AVX2 static mask_t less(vec_t a, vec_t b)
+      { return _mm256_castps_si256(_mm256_cmp_ps(a, b, _CMP_LT_OQ) ); }
+      SparseHungarian_AVX2 static vec_t blend(vec_t a, vec_t b, mask_t mask)
+      { return _mm256_blendv_ps(a, b, _mm256_castsi256_ps(mask) ); }
+    };
+
+  template <>
+    struct Avx2Ops<double> : Avx2Index64 {
+      using vec_t = __m256d;
+      SparseHungarian_AVX2 static vec_t set1(double x)
+      { return _mm256_set1_pd(x); }
+      SparseHungarian_AVX2 static vec_t load(const double* ptr)
+      { return _mm256_loadu_pd(ptr); }
+      SparseHungarian_AVX2 static void store(double* ptr, vec_t x)
+      { _mm256_storeu_pd(ptr, x); }
+      SparseHungarian_AVX2 static vec_t add(vec_t a, vec_t b)
+      { return _mm256_add_pd(a, b); }
+      SparseHungarian_AVX2 static vec_t sub(vec_t a, vec_t b)
+      { return _mm256_sub_pd(a, b); }
+      SparseHungarian_AVX2 static mask_t less(vec_t a, vec_t b)
+      { return _mm256_castpd_si256(_mm256_cmp_pd(a, b, _CMP_LT_OQ) ); }
+      SparseHungarian_AVX2 static vec_t blend(vec_t a, vec_t b, mask_t mask)
+      { return _mm256_blendv_pd(a, b, _mm256_castsi256_pd(mask) ); }
+    };
+
+  template <>
+    struct Avx2Ops<std::int32_t> : Avx2Index32 {
+      using vec_t = __m256i;
+      SparseHungarian_AVX2 static vec_t set1(std::int32_t x)
+      { return _mm256_set1_epi32(x); }
+      SparseHungarian_AVX2 static vec_t load(const std::int32_t* ptr)
+      { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ptr) ); }
+      SparseHungarian_AVX2 static void store(std::int32_t* ptr, vec_t x)
+      { _mm256_storeu_si256(reinterpret_cast<__m256i*>(ptr), x); }
+      SparseHungarian_AVX2 static vec_t add(vec_t a, vec_t b)
+      { return _mm256_add_epi32(a, b); }
+      SparseHungarian_AVX2 static vec_t sub(vec_t a, vec_t b)
+      { return _mm256_sub_epi32(a, b); }
+      // Excludes the tree slack, like the NaN in the floating point versions
+      SparseHungarian_AVX2 static mask_t less(vec_t a, vec_t b)
+      {
+        return _mm256_andnot_si256(
+            _mm256_cmpeq_epi32(a, set1(treeSlack<std::int32_t>() ) ),
+            _mm256_cmpgt_epi32(b, a) );
+      }
+      SparseHungarian_AVX2 static vec_t blend(vec_t a, vec_t b, mask_t mask)
+      { return _mm256_blendv_epi8(a, b, mask); }
+    };
+
+  template <>
+    struct Avx2Ops<std::int64_t> : Avx2Index64 {
+      using vec_t = __m256i;
+      SparseHungarian_AVX2 static vec_t set1(std::int64_t x)
+      { return _mm256_set1_epi64x(x); }
+      SparseHungarian_AVX2 static vec_t load(const std::int64_t* ptr)
+      { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ptr) ); }
+      SparseHungarian_AVX2 static void store(std::int64_t* ptr, vec_t x)
+      { _mm256_storeu_si256(reinterpret_cast<__m256i*>(ptr), x); }
+      SparseHungarian_AVX2 static vec_t add(vec_t a, vec_t b)
+      { return _mm256_add_epi64(a, b); }
+      SparseHungarian_AVX2 static vec_t sub(vec_t a, vec_t b)
+      { return _mm256_sub_epi64(a, b); }
+      SparseHungarian_AVX2 static mask_t less(vec_t a, vec_t b)
+      {
+        return _mm256_andnot_si256(
+            _mm256_cmpeq_epi64(a, set1(treeSlack<std::int64_t>() ) ),
+            _mm256_cmpgt_epi64(b, a) );
+      }
+      SparseHungarian_AVX2 static vec_t blend(vec_t a, vec_t b, mask_t mask)
+      { return _mm256_blendv_epi8(a, b, mask); }
+    };
+
+  template <typename T>
+    struct Avx512Ops;
+
+  struct Avx512Index32 {
+    static constexpr int lanes = 16;
+    using mask_t = __mmask16;
+    using index_t = __m512i;
+    SparseHungarian_AVX512 static index_t firstIndices()
+    {
+      return _mm512_setr_epi32(
+          0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    }
+    SparseHungarian_AVX512 static index_t nextIndices(index_t idx)
+    { return _mm512_add_epi32(idx, _mm512_set1_epi32(lanes) ); }
+    SparseHungarian_AVX512 static index_t blendIndices(
+        index_t a, index_t b, mask_t mask)
+    { return _mm512_mask_blend_epi32(mask, a, b); }
+    SparseHungarian_AVX512 static void storeIndices(idx_t* out, index_t idx)
+    {
+      alignas(64) std::int32_t idx32[lanes];
+      _mm512_store_si512(idx32, idx);
+      for (int lane = 0; lane < lanes; ++lane)
+        out[lane] = idx32[lane];
+    }
+    SparseHungarian_AVX512 static void storeCurrent(
+        idx_t* out, mask_t mask, idx_t current)
+    {
+      const __m512i vCurrent = _mm512_set1_epi64(current);
+      _mm512_mask_storeu_epi64(out, mask & 0xFF, vCurrent);
+      _mm512_mask_storeu_epi64(out + 8, mask >> 8, vCurrent);
+    }
+  };
+
+  struct Avx512Index64 {
+    static constexpr int lanes = 8;
+    using mask_t = __mmask8;
+    using index_t = __m512i;
+    SparseHungarian_AVX512 static index_t firstIndices()
+    { return _mm512_setr_epi64(0, 1, 2, 3, 4, 5, 6, 7); }
+    SparseHungarian_AVX512 static index_t nextIndices(index_t idx)
+    { return _mm512_add_epi64(idx, _mm512_set1_epi64(lanes) ); }
+    SparseHungarian_AVX512 static index_t blendIndices(
+        index_t a, index_t b, mask_t mask)
+    { return _mm512_mask_blend_epi64(mask, a, b); }
+    SparseHungarian_AVX512 static void storeIndices(idx_t* out, index_t idx)
+    { _mm512_storeu_si512(out, idx); }
+    SparseHungarian_AVX512 static void storeCurrent(
+        idx_t* out, mask_t mask, idx_t current)
+    { _mm512_mask_storeu_epi64(out, mask, _mm512_set1_epi64(current) ); }
+  };
+
+  template <>
+    struct Avx512Ops<float> : Avx512Index32 {
+      using vec_t = __m512;
+      SparseHungarian_AVX512 static vec_t set1(float x)
+      { return _mm512_set1_ps(x); }
+      SparseHungarian_AVX512 static vec_t load(const float* ptr)
+      { return _mm512_loadu_ps(ptr); }
+      SparseHungarian_AVX512 static void store(float* ptr, vec_t x)
+      { _mm512_storeu_ps(ptr, x); }
+      SparseHungarian_AVX512 static vec_t add(vec_t a, vec_t b)
+      { return _mm512_add_ps(a, b); }
+      SparseHungarian_AVX512 static vec_t sub(vec_t a, vec_t b)
+      { return _mm512_sub_ps(a, b); }
+      // Ordered comparison, so false for the NaN slacks
+      SparseHungarian_AVX512 static mask_t less(vec_t a, vec_t b)
+      { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+      SparseHungarian_AVX512 static vec_t blend(vec_t a, vec_t b, mask_t mask)
+      { return _mm512_mask_blend_ps(mask, a, b); }
+    };
+
+  template <>
+    struct Avx512Ops<double> : Avx512Index64 {
+      using vec_t = __m512d;
+      SparseHungarian_AVX512 static vec_t set1(double x)
+      { return _mm512_set1_pd(x); }
+      SparseHungarian_AVX512 static vec_t load(const double* ptr)
+      { return _mm512_loadu_pd(ptr); }
+      SparseHungarian_AVX512 static void store(double* ptr, vec_t x)
+      { _mm512_storeu_pd(ptr, x); }
+      SparseHungarian_AVX512 static vec_t add(vec_t a, vec_t b)
+      { return _mm512_add_pd(a, b); }
+      SparseHungarian_AVX512 static vec_t sub(vec_t a, vec_t b)
+      { return _mm512_sub_pd(a, b); }
+      SparseHungarian_AVX512 static mask_t less(vec_t a, vec_t b)
+      { return _mm512_cmp_pd_mask(a, b, _CMP_LT_OQ); }
+      SparseHungarian_AVX512 static vec_t blend(vec_t a, vec_t b, mask_t mask)
+      { return _mm512_mask_blend_pd(mask, a, b); }
+    };
+
+  template <>
+    struct Avx512Ops<std::int32_t> : Avx512Index32 {
+      using vec_t = __m512i;
+      SparseHungarian_AVX512 static vec_t set1(std::int32_t x)
+      { return _mm512_set1_epi32(x); }
+      SparseHungarian_AVX512 static vec_t load(const std::int32_t* ptr)
+      { return _mm512_loadu_si512(ptr); }
+      SparseHungarian_AVX512 static void store(std::int32_t* ptr, vec_t x)
+      { _mm512_storeu_si512(ptr, x); }
+      SparseHungarian_AVX512 static vec_t add(vec_t a, vec_t b)
+      { return _mm512_add_epi32(a, b); }
+      SparseHungarian_AVX512 static vec_t sub(vec_t a, vec_t b)
+      { return _mm512_sub_epi32(a, b); }
+      // Excludes the tree slack, like the NaN in the floating point versions
+      SparseHungarian_AVX512 static mask_t less(vec_t a, vec_t b)
+      {
+        return _mm512_mask_cmplt_epi32_mask(
+            _mm512_cmpneq_epi32_mask(a, set1(treeSlack<std::int32_t>() ) ),
+            a, b);
+      }
+      SparseHungarian_AVX512 static vec_t blend(vec_t a, vec_t b, mask_t mask)
+      { return _mm512_mask_blend_epi32(mask, a, b); }
+    };
+
+  template <>
+    struct Avx512Ops<std::int64_t> : Avx512Index64 {
+      using vec_t = __m512i;
+      SparseHungarian_AVX512 static vec_t set1(std::int64_t x)
+      { return _mm512_set1_epi64(x); }
+      SparseHungarian_AVX512 static vec_t load(const std::int64_t* ptr)
+      { return _mm512_loadu_si512(ptr); }
+      SparseHungarian_AVX512 static void store(std::int64_t* ptr, vec_t x)
+      { _mm512_storeu_si512(ptr, x); }
+      SparseHungarian_AVX512 static vec_t add(vec_t a, vec_t b)
+      { return _mm512_add_epi64(a, b); }
+      SparseHungarian_AVX512 static vec_t sub(vec_t a, vec_t b)
+      { return _mm512_sub_epi64(a, b); }
+      SparseHungarian_AVX512 static mask_t less(vec_t a, vec_t b)
+      {
+        return _mm512_mask_cmplt_epi64_mask(
+            _mm512_cmpneq_epi64_mask(a, set1(treeSlack<std::int64_t>() ) ),
+            a, b);
+      }
+      SparseHungarian_AVX512 static vec_t blend(vec_t a, vec_t b, mask_t mask)
+      { return _mm512_mask_blend_epi64(mask, a, b); }
+    };
+
+  // The vector kernels only differ in their operations and their target, and
+  // the target can't be a template parameter, so stamp them out with a macro
+#define SparseHungarian_VECTOR_KERNEL(name, OpsTemplate, target)             \
+  template <typename T>                                                      \
+    target                                                                   \
+    idx_t name(                                                              \
+        const T* costs,                                                      \
+        T labelA,                                                            \
+        const T* labelsB,                                                    \
+        T* slacks,                                                           \
+        idx_t* minSlackIdx,                                                  \
+        idx_t current,                                                       \
+        idx_t n,                                                             \
+        T& delta)                                                            \
+    {                                                                        \
+      using Ops = OpsTemplate<T>;                                            \
+      const auto vLabelA = Ops::set1(labelA);                                \
+      auto vMin = Ops::set1(CostTraits<T>::largest() );                      \
+      auto vMinIdx = Ops::firstIndices();                                    \
+      auto vIdx = Ops::firstIndices();                                       \
+      idx_t ib = 0;                                                          \
+      for (; ib + Ops::lanes <= n; ib += Ops::lanes) {                       \
+        auto slack = Ops::sub(                                               \
+            Ops::add(vLabelA, Ops::load(labelsB + ib) ),                     \
+            Ops::load(costs + ib) );                                         \
+        auto old = Ops::load(slacks + ib);                                   \
+        auto lower = Ops::less(slack, old);                                  \
+        auto updated = Ops::blend(old, slack, lower);                        \
+        Ops::store(slacks + ib, updated);                                    \
+        Ops::storeCurrent(minSlackIdx + ib, lower, current);                 \
+        /* Strictly less so each lane keeps its first minimum */             \
+        auto better = Ops::less(updated, vMin);                              \
+        vMin = Ops::blend(vMin, updated, better);                            \
+        vMinIdx = Ops::blendIndices(vMinIdx, vIdx, better);                  \
+        vIdx = Ops::nextIndices(vIdx);                                       \
+      }                                                                      \
+      T laneMin[Ops::lanes];                                                 \
+      idx_t laneIdx[Ops::lanes];                                             \
+      Ops::store(laneMin, vMin);                                             \
+      Ops::storeIndices(laneIdx, vMinIdx);                                   \
+      return finishKernel(laneMin, laneIdx, costs, labelA, labelsB, slacks,  \
+          minSlackIdx, current, ib, n, delta);                               \
+    }
+
+  SparseHungarian_VECTOR_KERNEL(avx2Kernel, Avx2Ops, SparseHungarian_AVX2)
+  SparseHungarian_VECTOR_KERNEL(avx512Kernel, Avx512Ops, SparseHungarian_AVX512)
+#undef SparseHungarian_VECTOR_KERNEL
+#undef SparseHungarian_AVX2
+#undef SparseHungarian_AVX512
+#endif
+}
+
+namespace SparseHungarian {
+  namespace SlackKernels {
+    InstructionSet bestInstructionSet()
+    {
+#ifdef SparseHungarian_X86_KERNELS
+      __builtin_cpu_init();
+      if (__builtin_cpu_supports("avx512f") )
+        return InstructionSet::AVX512;
+      if (__builtin_cpu_supports("avx2") )
+        return InstructionSet::AVX2;
+#endif
+      return InstructionSet::Scalar;
+    }
+
+    template <typename T>
+      kernel_t<T> getKernel(InstructionSet instructionSet)
+      {
+        switch (instructionSet) {
+          case InstructionSet::Scalar:
+            return scalarKernel<T>;
+#ifdef SparseHungarian_X86_KERNELS
+          case InstructionSet::AVX2:
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2") )
+              return avx2Kernel<T>;
+            break;
+          case InstructionSet::AVX512:
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx512f") )
+              return avx512Kernel<T>;
+            break;
+#endif
+          default:
+            break;
+        }
+        throw std::runtime_error(
+            "Requested slack kernel is not supported on this machine");
+      }
+
+    template <typename T>
+      kernel_t<T> bestKernel()
+      {
+        // Only check the CPU once
+        static const kernel_t<T> kernel = getKernel<T>(bestInstructionSet() );
+        return kernel;
+      }
+
+    template kernel_t<float> getKernel<float>(InstructionSet);
+    template kernel_t<double> getKernel<double>(InstructionSet);
+    template kernel_t<std::int32_t> getKernel<std::int32_t>(InstructionSet);
+    template kernel_t<std::int64_t> getKernel<std::int64_t>(InstructionSet);
+    template kernel_t<float> bestKernel<float>();
+    template kernel_t<double> bestKernel<double>();
+    template kernel_t<std::int32_t> bestKernel<std::int32_t>();
+    template kernel_t<std::int64_t> bestKernel<std::int64_t>();
+  }
+}
@@ -0,0 +1,21 @@
+#include "SparseHungarian/Defs.h"
+
+namespace SparseHungarian {
+  SparseCostMatrix SparseCostMatrix::fromDense(
+      const cost_matrix_t& costs,
+      float maxCost)
+  {
+    SparseCostMatrix sparse(costs.cols(), maxCost);
+    sparse.rowOffsets.reserve(costs.rows() + 1);
+    for (idx_t ia = 0; ia < costs.rows(); ++ia) {
+      for (idx_t ib = 0; ib < costs.cols(); ++ib) {
+        float cost = costs.coeff(ia, ib);
+        // An infinite cost is never an edge, even with an unlimited max cost
+        if (cost <= maxCost && cost < std::numeric_limits<float>::infinity() )
+          sparse.addEdge(ib, cost);
+      }
+      sparse.endRow();
+    }
+    return sparse;
+  }
+}
@@ -1,27 +1,277 @@
 #include "SparseHungarian/SparseGroup.h"
+#include "SparseHungarian/DeltaR.h"
 #include <memory>
 #include <algorithm>
 #include <queue>
+#include <stdexcept>
+
+namespace {
+  using SparseHungarian::idx_t;
+
+  /**
+   * A disjoint set forest with path compression and union by rank, kept in
+   * external buffers
+   */
+  class DisjointSets {
+    public:
+      DisjointSets(
+          std::vector<idx_t>& parents,
+          std::vector<unsigned char>& ranks,
+          idx_t n)
+        : m_parent(parents), m_rank(ranks)
+      {
+        m_parent.resize(n);
+        for (idx_t ii = 0; ii < n; ++ii)
+          m_parent[ii] = ii;
+        m_rank.assign(n, 0);
+      }
+
+      /// Find the representative of the set containing x
+      idx_t find(idx_t x)
+      {
+        idx_t root = x;
+        while (m_parent[root] != root)
+          root = m_parent[root];
+        // Point everything on the way at the root
+        while (m_parent[x] != root) {
+          idx_t next = m_parent[x];
+          m_parent[x] = root;
+          x = next;
+        }
+        return root;
+      }
+
+      /// Merge the sets containing x and y
+      void merge(idx_t x, idx_t y)
+      {
+        x = find(x);
+        y = find(y);
+        if (x == y)
+          return;
+        if (m_rank[x] < m_rank[y])
+          std::swap(x, y);
+        m_parent[y] = x;
+        if (m_rank[x] == m_rank[y])
+          ++m_rank[x];
+      }
+    private:
+      std::vector<idx_t>& m_parent;
+      std::vector<unsigned char>& m_rank;
+  };
+
+  // Whether an edge can put its vertices in the same group. An infinite cost
+  // is never a match, even with an unlimited max cost
+  template <typename T>
+    bool admissible(T cost, T maxCost)
+    {
+      return cost <= maxCost &&
+        cost < SparseHungarian::CostTraits<T>::largest();
+    }
+
+  template <typename T>
+  std::vector<SparseHungarian::BasicSparseGroup<T>> unionFindGroups(
+      const SparseHungarian::basic_cost_view_t<T>& costs,
+      T maxCost,
+      SparseHungarian::GroupCosts groupCosts)
+  {
+    SparseHungarian::BasicSolverWorkspace<T> workspace;
+    SparseHungarian::findSparseGroups(costs, maxCost, workspace);
+    std::vector<SparseHungarian::BasicSparseGroup<T>> groups(
+        workspace.nGroups() );
+    for (std::size_t ig = 0; ig < groups.size(); ++ig) {
+      SparseHungarian::BasicSparseGroup<T>& group = groups[ig];
+      group.indicesA.assign(
+          workspace.groupIndicesA.begin() + workspace.groupOffsetsA[ig],
+          workspace.groupIndicesA.begin() + workspace.groupOffsetsA[ig + 1]);
+      group.indicesB.assign(
+          workspace.groupIndicesB.begin() + workspace.groupOffsetsB[ig],
+          workspace.groupIndicesB.begin() + workspace.groupOffsetsB[ig + 1]);
+      if (group.indicesA.size() == 1 || group.indicesB.size() == 1)
+        group.solveStar(costs, maxCost);
+      else if (groupCosts == SparseHungarian::GroupCosts::View)
+        group.viewCosts(costs, maxCost);
+      else
+        group.buildCosts(costs, maxCost);
+    }
+    return groups;
+  }
+}
 
 namespace SparseHungarian {
-  void SparseGroup::buildCosts(
-      const cost_matrix_t& fullCosts,
-      float maxCost)
+  template <typename T>
+  void BasicSparseGroup<T>::buildCosts(
+      const basic_cost_view_t<T>& fullCosts,
+      T maxCost)
   {
     this->maxCost = maxCost;
     costs.resize(indicesA.size(), indicesB.size() );
-    for (idx_t ia = 0; ia < indicesA.size(); ++ia)
-      for (idx_t ib = 0; ib < indicesB.size(); ++ib)
+    // Fill in storage order
+    for (idx_t ib = 0; ib < indicesB.size(); ++ib)
+      for (idx_t ia = 0; ia < indicesA.size(); ++ia)
         costs(ia, ib) = fullCosts(indicesA[ia], indicesB[ib]);
   }
 
-  std::vector<SparseGroup> splitProblemIntoSparseGroups(
-      const Eigen::MatrixXf& costs,
-      float maxCost)
+  template <typename T>
+  void BasicSparseGroup<T>::viewCosts(
+      const basic_cost_view_t<T>& fullCosts,
+      T maxCost)
+  {
+    this->maxCost = maxCost;
+    costs.resize(0, 0);
+    m_fullData = fullCosts.data();
+    m_fullRows = fullCosts.rows();
+    m_fullCols = fullCosts.cols();
+    m_fullOuterStride = fullCosts.outerStride();
+    m_fullInnerStride = fullCosts.innerStride();
+  }
+
+  template <typename T>
+  basic_cost_view_t<T> BasicSparseGroup<T>::gatherCosts(
+      std::vector<T>& buffer) const
+  {
+    if (!isView() )
+      return CostViewOf<basic_cost_matrix_t<T>>(costs).view();
+    idx_t nA = indicesA.size();
+    idx_t nB = indicesB.size();
+    buffer.resize(nA * nB);
+    Eigen::Map<basic_cost_matrix_t<T>> gathered(buffer.data(), nA, nB);
+    gathered = costView();
+    return CostViewOf<Eigen::Map<basic_cost_matrix_t<T>>>(gathered).view();
+  }
+
+  template <typename T>
+  void BasicSparseGroup<T>::solveStar(
+      const basic_cost_view_t<T>& fullCosts,
+      T maxCost)
+  {
+    if (indicesA.size() != 1 && indicesB.size() != 1)
+      throw std::runtime_error(
+          "Only a group with a single 'A' or 'B' vertex can be solved directly");
+    this->maxCost = maxCost;
+    costs.resize(0, 0);
+    starMatch = cheapestEdge(fullCosts,
+        indicesA.data(), indicesA.size(), indicesB.data(), indicesB.size() );
+  }
+
+  template <typename T>
+  match_t cheapestEdge(
+      const basic_cost_view_t<T>& costs,
+      const idx_t* indicesA,
+      idx_t nA,
+      const idx_t* indicesB,
+      idx_t nB)
+  {
+    match_t best(0, 0);
+    T bestCost = costs.coeff(indicesA[0], indicesB[0]);
+    for (idx_t ia = 0; ia < nA; ++ia) {
+      for (idx_t ib = 0; ib < nB; ++ib) {
+        T cost = costs.coeff(indicesA[ia], indicesB[ib]);
+        if (cost < bestCost) {
+          bestCost = cost;
+          best = match_t(ia, ib);
+        }
+      }
+    }
+    return best;
+  }
+
+  template <typename T>
+  void findSparseGroups(
+      const basic_cost_view_t<T>& costs,
+      std::common_type_t<T> maxCost,
+      BasicSolverWorkspace<T>& workspace)
+  {
+    idx_t nVtxA = costs.rows();
+    idx_t nVtxB = costs.cols();
+    idx_t nVtx = nVtxA + nVtxB;
+    // 'B' vertices are stored as idx + nVtxA
+    DisjointSets sets(workspace.parents, workspace.ranks, nVtx);
+    // Vertices without any admissible edge are marked with -1
+    std::vector<idx_t>& groupOf = workspace.groupOf;
+    groupOf.assign(nVtx, -1);
+    auto addEdge = [&] (idx_t ia, idx_t ib) {
+      sets.merge(ia, ib + nVtxA);
+      groupOf[ia] = 0;
+      groupOf[ib + nVtxA] = 0;
+    };
+    // Walk the matrix in its storage order, merging the vertices at either
+    // end of every admissible edge
+    if (costs.innerStride() <= costs.outerStride() ) {
+      for (idx_t ib = 0; ib < nVtxB; ++ib) {
+        const T* column = costs.data() + ib * costs.outerStride();
+        for (idx_t ia = 0; ia < nVtxA; ++ia)
+          if (admissible<T>(column[ia * costs.innerStride()], maxCost) )
+            addEdge(ia, ib);
+      }
+    }
+    else {
+      for (idx_t ia = 0; ia < nVtxA; ++ia) {
+        const T* row = costs.data() + ia * costs.innerStride();
+        for (idx_t ib = 0; ib < nVtxB; ++ib)
+          if (admissible<T>(row[ib * costs.outerStride()], maxCost) )
+            addEdge(ia, ib);
+      }
+    }
+    // Point every grouped vertex directly at its set's representative. The
+    // forest isn't needed after this so its buffer is reused below.
+    for (idx_t iv = 0; iv < nVtx; ++iv)
+      if (groupOf[iv] != -1)
+        groupOf[iv] = sets.find(iv);
+    // Number the groups in order of their lowest 'A' index and count their
+    // members. The counts are stored one place along to become the offsets.
+    std::vector<std::size_t>& offsetsA = workspace.groupOffsetsA;
+    std::vector<std::size_t>& offsetsB = workspace.groupOffsetsB;
+    offsetsA.assign(1, 0);
+    offsetsB.assign(1, 0);
+    std::vector<idx_t>& groupOfRoot = workspace.parents;
+    groupOfRoot.assign(nVtx, -1);
+    for (idx_t iv = 0; iv < nVtx; ++iv) {
+      idx_t root = groupOf[iv];
+      if (root == -1)
+        continue;
+      if (groupOfRoot[root] == -1) {
+        // 'A' vertices come first so this creates every group in order
+        groupOfRoot[root] = offsetsA.size() - 1;
+        offsetsA.push_back(0);
+        offsetsB.push_back(0);
+      }
+      groupOf[iv] = groupOfRoot[root];
+      if (iv < nVtxA)
+        ++offsetsA[groupOf[iv] + 1];
+      else
+        ++offsetsB[groupOf[iv] + 1];
+    }
+    for (std::size_t ig = 1; ig < offsetsA.size(); ++ig) {
+      offsetsA[ig] += offsetsA[ig - 1];
+      offsetsB[ig] += offsetsB[ig - 1];
+    }
+    // Now bucket the vertices into their groups, counting how many have been
+    // placed in each so far
+    workspace.groupIndicesA.resize(offsetsA.back() );
+    workspace.groupIndicesB.resize(offsetsB.back() );
+    std::vector<idx_t>& placed = workspace.parents;
+    placed.assign(2 * workspace.nGroups(), 0);
+    for (idx_t iv = 0; iv < nVtx; ++iv) {
+      idx_t ig = groupOf[iv];
+      if (ig == -1)
+        continue;
+      if (iv < nVtxA)
+        workspace.groupIndicesA[offsetsA[ig] + placed[2 * ig]++] = iv;
+      else
+        workspace.groupIndicesB[offsetsB[ig] + placed[2 * ig + 1]++] =
+          iv - nVtxA;
+    }
+  }
+
+  template <typename T>
+  void streamSparseGroups(
+      const basic_cost_view_t<T>& costs,
+      std::common_type_t<T> maxCost,
+      const std::function<void(BasicSparseGroup<T>&)>& onGroup,
+      GroupCosts groupCosts)
   {
     idx_t nVtxA = costs.rows();
     idx_t nVtxB = costs.cols();
-    std::vector<SparseGroup> groups;
     // This is essentially a graph partioning problem. Use a breadth first
     // search
     // Keep track of which vertices we've visited
@@ -33,6 +283,7 @@ namespace SparseHungarian {
 
     // Step through the A vertices to seed the groups
     idx_t nextVtx = 0;
+    BasicSparseGroup<T> group;
     while (nextVtx != nVtxA) {
       if (visitedA[nextVtx]) {
         ++nextVtx;
@@ -40,8 +291,7 @@ namespace SparseHungarian {
       }
       visitedA[nextVtx] = true;
       vtxQueue.push(nextVtx);
-      groups.emplace_back();
-      SparseGroup& group = groups.back();
+      group = BasicSparseGroup<T>();
       group.indicesA.push_back(nextVtx);
       while (vtxQueue.size() != 0) {
         idx_t current = vtxQueue.front();
@@ -52,7 +302,8 @@ namespace SparseHungarian {
           // Start from nextVtx+1, we've already visited all the 'A' vertices
           // before this
           for (idx_t ia = nextVtx + 1; ia < nVtxA; ++ia) {
-            if (visitedA[ia] || costs.coeff(ia, current) > maxCost)
+            if (visitedA[ia] ||
+                !admissible<T>(costs.coeff(ia, current), maxCost) )
               continue;
             vtxQueue.push(ia);
             group.indicesA.push_back(ia);
@@ -62,7 +313,8 @@ namespace SparseHungarian {
         else {
           // This is an 'A' vertex
           for (idx_t ib = 0; ib < nVtxB; ++ib) {
-            if (visitedB[ib] || costs.coeff(current, ib) > maxCost)
+            if (visitedB[ib] ||
+                !admissible<T>(costs.coeff(current, ib), maxCost) )
               continue;
             vtxQueue.push(ib+nVtxA);
             group.indicesB.push_back(ib);
@@ -70,15 +322,175 @@ namespace SparseHungarian {
           }
         }
       }
-      // Reaching here means that we've completed the group
-      if (group.indicesB.size() == 0)
-        // We only want to return groups that contain some matchings
-        groups.pop_back();
-      else
-        group.buildCosts(costs, maxCost);
+      // Reaching here means that we've completed the group. We only want
+      // groups that contain some matchings
+      if (group.indicesB.size() != 0) {
+        if (group.indicesA.size() == 1 || group.indicesB.size() == 1)
+          group.solveStar(costs, maxCost);
+        else if (groupCosts == GroupCosts::View)
+          group.viewCosts(costs, maxCost);
+        else
+          group.buildCosts(costs, maxCost);
+        onGroup(group);
+      }
       // Walk on the A index
       ++nextVtx;
     }
+  }
+
+  template <typename T>
+  std::vector<BasicSparseGroup<T>> splitProblemIntoSparseGroups(
+      const basic_cost_view_t<T>& costs,
+      std::common_type_t<T> maxCost,
+      GroupingAlgorithm algorithm,
+      GroupCosts groupCosts)
+  {
+    if (algorithm == GroupingAlgorithm::UnionFind)
+      return unionFindGroups(costs, maxCost, groupCosts);
+    std::vector<BasicSparseGroup<T>> groups;
+    streamSparseGroups<T>(costs, maxCost,
+        [&groups] (BasicSparseGroup<T>& group) {
+          groups.push_back(std::move(group) );
+        }, groupCosts);
+    return groups;
+  }
+
+  std::vector<SparseGroup> splitProblemIntoSparseGroups(
+      const SparseCostMatrix& costs)
+  {
+    idx_t nVtxA = costs.nRows;
+    idx_t nVtxB = costs.nCols;
+    std::vector<SparseGroup> groups;
+    // A matrix built by hand can hold edges that could never be matches, and
+    // these are skipped as for a dense matrix
+    auto admissibleEdge = [&costs] (std::size_t e) {
+      return admissible(costs.costs[e], costs.maxCost);
+    };
+    auto hasEdge = [&] (idx_t ia) {
+      for (std::size_t e = costs.rowOffsets[ia]; e < costs.rowOffsets[ia + 1]; ++e)
+        if (admissibleEdge(e) )
+          return true;
+      return false;
+    };
+    // The same breadth first search as above, but only following the stored
+    // edges. This needs the edges for each 'B' vertex too, so build the
+    // transpose of the matrix
+    std::vector<std::size_t> colOffsets(nVtxB + 1, 0);
+    for (std::size_t e = 0; e < costs.nEdges(); ++e)
+      if (admissibleEdge(e) )
+        ++colOffsets[costs.cols[e] + 1];
+    for (idx_t ib = 0; ib < nVtxB; ++ib)
+      colOffsets[ib + 1] += colOffsets[ib];
+    std::vector<idx_t> colRows(colOffsets.back() );
+    {
+      std::vector<std::size_t> next(colOffsets.begin(), colOffsets.end() - 1);
+      for (idx_t ia = 0; ia < nVtxA; ++ia)
+        for (std::size_t e = costs.rowOffsets[ia]; e < costs.rowOffsets[ia + 1]; ++e)
+          if (admissibleEdge(e) )
+            colRows[next[costs.cols[e]]++] = ia;
+    }
+
+    std::vector<bool> visitedA(nVtxA, false);
+    std::vector<bool> visitedB(nVtxB, false);
+    // The position of each 'B' vertex in its group
+    std::vector<idx_t> localB(nVtxB, 0);
+    std::queue<idx_t> vtxQueue;
+    for (idx_t nextVtx = 0; nextVtx < nVtxA; ++nextVtx) {
+      // Vertices without edges can't be in a group with any matches
+      if (visitedA[nextVtx] || !hasEdge(nextVtx) )
+        continue;
+      visitedA[nextVtx] = true;
+      vtxQueue.push(nextVtx);
+      groups.emplace_back();
+      SparseGroup& group = groups.back();
+      group.indicesA.push_back(nextVtx);
+      while (vtxQueue.size() != 0) {
+        idx_t current = vtxQueue.front();
+        vtxQueue.pop();
+        if (current >= nVtxA) {
+          // this is a 'B' vertex
+          current -= nVtxA;
+          for (std::size_t e = colOffsets[current]; e < colOffsets[current + 1]; ++e) {
+            idx_t ia = colRows[e];
+            if (visitedA[ia])
+              continue;
+            vtxQueue.push(ia);
+            group.indicesA.push_back(ia);
+            visitedA[ia] = true;
+          }
+        }
+        else {
+          // This is an 'A' vertex
+          for (std::size_t e = costs.rowOffsets[current];
+              e < costs.rowOffsets[current + 1]; ++e) {
+            idx_t ib = costs.cols[e];
+            if (visitedB[ib] || !admissibleEdge(e) )
+              continue;
+            vtxQueue.push(ib+nVtxA);
+            localB[ib] = group.indicesB.size();
+            group.indicesB.push_back(ib);
+            visitedB[ib] = true;
+          }
+        }
+      }
+      group.maxCost = costs.maxCost;
+      if (group.indicesA.size() == 1 || group.indicesB.size() == 1) {
+        // A star group's only match is its cheapest stored edge
+        float bestCost = std::numeric_limits<float>::infinity();
+        for (std::size_t ia = 0; ia < group.indicesA.size(); ++ia) {
+          idx_t row = group.indicesA[ia];
+          for (std::size_t e = costs.rowOffsets[row]; e < costs.rowOffsets[row + 1]; ++e) {
+            if (!admissibleEdge(e) )
+              continue;
+            if (group.starMatch.first == -1 || costs.costs[e] < bestCost) {
+              bestCost = costs.costs[e];
+              group.starMatch = match_t(ia, localB[costs.cols[e]]);
+            }
+          }
+        }
+        continue;
+      }
+      // Fill the group's costs from the stored edges
+      group.costs.setConstant(group.indicesA.size(), group.indicesB.size(),
+          std::numeric_limits<float>::infinity() );
+      for (std::size_t ia = 0; ia < group.indicesA.size(); ++ia) {
+        idx_t row = group.indicesA[ia];
+        for (std::size_t e = costs.rowOffsets[row]; e < costs.rowOffsets[row + 1]; ++e)
+          if (admissibleEdge(e) )
+            group.costs(ia, localB[costs.cols[e]]) = costs.costs[e];
+      }
+    }
     return groups;
   }
+
+  std::vector<SparseGroup> splitProblemIntoSparseGroups(
+      const point_vec_t& pointsA,
+      const point_vec_t& pointsB,
+      float maxDR)
+  {
+    return splitProblemIntoSparseGroups(
+        buildDeltaRCosts(pointsA, pointsB, maxDR) );
+  }
+
+  template class BasicSparseGroup<float>;
+  template class BasicSparseGroup<double>;
+  template class BasicSparseGroup<std::int32_t>;
+  template class BasicSparseGroup<std::int64_t>;
+
+#define SparseHungarian_INSTANTIATE(T)                                       \
+  template match_t cheapestEdge<T>(                                          \
+      const basic_cost_view_t<T>&,                                           \
+      const idx_t*, idx_t, const idx_t*, idx_t);                             \
+  template void findSparseGroups<T>(                                         \
+      const basic_cost_view_t<T>&, T, BasicSolverWorkspace<T>&);             \
+  template void streamSparseGroups<T>(                                       \
+      const basic_cost_view_t<T>&, T,                                        \
+      const std::function<void(BasicSparseGroup<T>&)>&, GroupCosts);         \
+  template std::vector<BasicSparseGroup<T>> splitProblemIntoSparseGroups<T>( \
+      const basic_cost_view_t<T>&, T, GroupingAlgorithm, GroupCosts);
+  SparseHungarian_INSTANTIATE(float)
+  SparseHungarian_INSTANTIATE(double)
+  SparseHungarian_INSTANTIATE(std::int32_t)
+  SparseHungarian_INSTANTIATE(std::int64_t)
+#undef SparseHungarian_INSTANTIATE
 }
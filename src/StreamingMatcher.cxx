@@ -0,0 +1,104 @@
+#include "SparseHungarian/StreamingMatcher.h"
+#include <condition_variable>
+#include <mutex>
+
+namespace SparseHungarian {
+  StreamingMatcher::StreamingMatcher(
+      std::size_t nThreads, std::size_t window, Solver solver)
+    :
+      solver(solver),
+      m_pool(nThreads),
+      m_slots(window == 0 ? 4 * m_pool.size() : window),
+      m_matchers(m_pool.size() )
+  {}
+
+  std::size_t StreamingMatcher::run(const source_t& source, const sink_t& sink)
+  {
+    std::mutex mutex;
+    // Signalled whenever a slot is freed or the stream stops
+    std::condition_variable changed;
+    // Event i lives in slot i % window(). Events from nWritten up to nRead
+    // are in flight
+    std::size_t nRead = 0;
+    std::size_t nWritten = 0;
+    bool exhausted = false;
+    bool failed = false;
+    for (Slot& slot : m_slots)
+      slot.done = false;
+
+    // Stop the other threads before passing on an exception
+    auto fail = [&] () {
+      std::lock_guard<std::mutex> lock(mutex);
+      failed = true;
+      changed.notify_all();
+    };
+
+    // Every thread loops over reading, solving and writing events until the
+    // stream runs out
+    m_pool.parallelFor(m_pool.size(), [&] (std::size_t, std::size_t thread) {
+        while (true) {
+          Slot* slot;
+          {
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [&] {
+                return failed || exhausted || nRead - nWritten < m_slots.size();
+              });
+            if (failed || exhausted)
+              return;
+            slot = &m_slots[nRead % m_slots.size()];
+            bool more;
+            try {
+              more = source(slot->event);
+            }
+            catch (...) {
+              failed = true;
+              changed.notify_all();
+              throw;
+            }
+            if (!more) {
+              exhausted = true;
+              changed.notify_all();
+              return;
+            }
+            ++nRead;
+          }
+
+          try {
+            std::unique_ptr<DeltaRMatcher>& matcher = m_matchers[thread];
+            if (!matcher || matcher->maxDR() != slot->event.maxDR)
+              matcher = std::make_unique<DeltaRMatcher>(slot->event.maxDR, solver);
+            slot->matches = matcher->match(
+                slot->event.phiA, slot->event.etaA,
+                slot->event.phiB, slot->event.etaB);
+          }
+          catch (...) {
+            fail();
+            throw;
+          }
+
+          std::lock_guard<std::mutex> lock(mutex);
+          slot->done = true;
+          // Write every finished event at the front of the stream. The event
+          // at the front is always being solved by some thread, which writes
+          // it when it finishes
+          while (!failed && nWritten < nRead) {
+            Slot& front = m_slots[nWritten % m_slots.size()];
+            if (!front.done)
+              break;
+            try {
+              sink(nWritten, front.matches);
+            }
+            catch (...) {
+              failed = true;
+              changed.notify_all();
+              throw;
+            }
+            front.done = false;
+            ++nWritten;
+          }
+          changed.notify_all();
+        }
+      });
+    return nWritten;
+  }
+}
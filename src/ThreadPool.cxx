@@ -0,0 +1,102 @@
+#include "SparseHungarian/ThreadPool.h"
+#include <algorithm>
+
+namespace SparseHungarian {
+  ThreadPool::ThreadPool(std::size_t nThreads)
+    :
+      m_generation(0),
+      m_active(0),
+      m_stop(false),
+      m_task(nullptr),
+      m_nTasks(0),
+      m_next(0)
+  {
+    if (nThreads == 0)
+      nThreads = std::max(1u, std::thread::hardware_concurrency() );
+    m_workers.reserve(nThreads - 1);
+    for (std::size_t ii = 1; ii < nThreads; ++ii)
+      m_workers.emplace_back(&ThreadPool::workerLoop, this, ii);
+  }
+
+  ThreadPool::~ThreadPool()
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_stop = true;
+    }
+    m_wake.notify_all();
+    for (std::thread& worker : m_workers)
+      worker.join();
+  }
+
+  void ThreadPool::parallelFor(
+      std::size_t nTasks,
+      const std::function<void(std::size_t)>& task)
+  {
+    parallelFor(nTasks,
+        std::function<void(std::size_t, std::size_t)>(
+          [&task] (std::size_t idx, std::size_t) { task(idx); }) );
+  }
+
+  void ThreadPool::parallelFor(
+      std::size_t nTasks,
+      const std::function<void(std::size_t, std::size_t)>& task)
+  {
+    if (nTasks == 0)
+      return;
+    std::lock_guard<std::mutex> runLock(m_runMutex);
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_task = &task;
+      m_nTasks = nTasks;
+      m_next = 0;
+      m_error = nullptr;
+      m_active = m_workers.size();
+      ++m_generation;
+    }
+    m_wake.notify_all();
+    runTasks(0);
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_finished.wait(lock, [this] () { return m_active == 0; });
+    m_task = nullptr;
+    if (m_error)
+      std::rethrow_exception(m_error);
+  }
+
+  void ThreadPool::workerLoop(std::size_t thread)
+  {
+    std::size_t seen = 0;
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_wake.wait(lock, [&] () { return m_stop || m_generation != seen; });
+        if (m_stop)
+          return;
+        seen = m_generation;
+      }
+      runTasks(thread);
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (--m_active == 0)
+        m_finished.notify_one();
+    }
+  }
+
+  void ThreadPool::runTasks(std::size_t thread)
+  {
+    while (true) {
+      std::size_t idx = m_next++;
+      if (idx >= m_nTasks)
+        return;
+      try {
+        (*m_task)(idx, thread);
+      }
+      catch (...) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_error)
+          m_error = std::current_exception();
+        // Don't start any more tasks
+        m_next = m_nTasks;
+      }
+    }
+  }
+}
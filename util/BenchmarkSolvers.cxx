@@ -0,0 +1,1688 @@
+#include "SparseHungarian/HungarianSolver.h"
+#include "SparseHungarian/JVSolver.h"
+#include "SparseHungarian/AuctionSolver.h"
+#include "SparseHungarian/ShortestPathSolver.h"
+#include "SparseHungarian/Matching.h"
+#include "SparseHungarian/SparseGroup.h"
+#include "SparseHungarian/ThreadPool.h"
+#include "SparseHungarian/BatchMatcher.h"
+#include "SparseHungarian/SolverWorkspace.h"
+#include "SparseHungarian/SlackKernels.h"
+#include "SparseHungarian/GroupArena.h"
+#include "SparseHungarian/DynamicAssignment.h"
+#include "SparseHungarian/DeltaR.h"
+#include "SparseHungarian/DeltaRMatcher.h"
+#include "SparseHungarian/RadiusSearch.h"
+#include "SparseHungarian/EventFile.h"
+#include "SparseHungarian/StreamingMatcher.h"
+#include "CountAllocations.h"
+#include "json.hpp"
+#include "boost/program_options.hpp"
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <array>
+#include <filesystem>
+#include <fstream>
+#include <cstdint>
+#include <type_traits>
+#include <tuple>
+
+namespace {
+  using namespace SparseHungarian;
+
+  // Build a random matrix with costs uniform in [0, 1)
+  cost_matrix_t randomCosts(idx_t nRows, idx_t nCols, std::mt19937& rng)
+  {
+    std::uniform_real_distribution<float> dist(0, 1);
+    cost_matrix_t costs(nRows, nCols);
+    for (idx_t ib = 0; ib < nCols; ++ib)
+      for (idx_t ia = 0; ia < nRows; ++ia)
+        costs(ia, ib) = dist(rng);
+    return costs;
+  }
+
+  const float pi = 3.14159265358979323846;
+
+  // Points in (phi, eta)
+  using point_vec_t = std::vector<std::pair<float, float>>;
+
+  // Generate points in the same way as python/generate_points.py. The 'A'
+  // points are uniform in eta-phi and the 'B' points are displaced from them
+  // by a gaussian distance in a random direction, with some extra uniform
+  // points added. The 'B' points are then shuffled.
+  void generatePoints(
+      std::size_t nPoints,
+      std::size_t nExtraPoints,
+      float maxEta,
+      float sigmaDR,
+      std::mt19937& rng,
+      point_vec_t& pointsA,
+      point_vec_t& pointsB)
+  {
+    std::uniform_real_distribution<float> etaDist(-maxEta, maxEta);
+    std::uniform_real_distribution<float> phiDist(0, 2*pi);
+    std::normal_distribution<float> drDist(0, sigmaDR);
+    pointsA.clear();
+    pointsB.clear();
+    for (std::size_t ii = 0; ii < nPoints; ++ii)
+      pointsA.emplace_back(phiDist(rng), etaDist(rng) );
+    for (const auto& pa : pointsA) {
+      float dr = drDist(rng);
+      float direction = phiDist(rng);
+      float phi = std::fmod(pa.first + dr*std::sin(direction), 2*pi);
+      if (phi < 0)
+        phi += 2*pi;
+      pointsB.emplace_back(phi, pa.second + dr*std::cos(direction) );
+    }
+    for (std::size_t ii = 0; ii < nExtraPoints; ++ii)
+      pointsB.emplace_back(phiDist(rng), etaDist(rng) );
+    std::shuffle(pointsB.begin(), pointsB.end(), rng);
+  }
+
+  // Build the deltaR cost matrix in the same way as MatchTestPoints
+  cost_matrix_t deltaRCosts(
+      const point_vec_t& pointsA,
+      const point_vec_t& pointsB)
+  {
+    cost_matrix_t costs(pointsA.size(), pointsB.size() );
+    for (std::size_t ia = 0; ia < pointsA.size(); ++ia) {
+      for (std::size_t ib = 0; ib < pointsB.size(); ++ib) {
+        const auto& pa = pointsA[ia];
+        const auto& pb = pointsB[ib];
+        float phiDiff = std::fmod(std::fabs(pa.first - pb.first), 2*pi);
+        phiDiff = std::min(phiDiff, 2*pi - phiDiff);
+        float etaDiff = pa.second - pb.second;
+        costs(ia, ib) = std::sqrt(phiDiff*phiDiff + etaDiff*etaDiff);
+      }
+    }
+    return costs;
+  }
+
+  // The total cost of a matching, where each unmatched 'A' vertex costs
+  // maxCost (if finite)
+  double totalCost(
+      const cost_matrix_t& costs,
+      const match_vec_t& matches,
+      float maxCost = std::numeric_limits<float>::infinity() )
+  {
+    double total = 0;
+    for (const match_t& m : matches)
+      total += costs(m.first, m.second);
+    if (std::isfinite(maxCost) )
+      total += maxCost * (costs.rows() - matches.size() );
+    return total;
+  }
+
+  // Time a single call of the provided function, returning the number of
+  // seconds taken
+  double timeIt(const std::function<void()>& func)
+  {
+    auto start = std::chrono::steady_clock::now();
+    func();
+    std::chrono::duration<double> duration =
+      std::chrono::steady_clock::now() - start;
+    return duration.count();
+  }
+
+  void benchmarkHungarian(
+      const std::vector<idx_t>& sizes,
+      idx_t maxRebuildSize,
+      std::mt19937& rng)
+  {
+    std::cout << "Comparing HungarianSolver search modes on random square "
+      << "matrices" << std::endl;
+    std::cout << std::setw(8) << "size"
+      << std::setw(16) << "rebuild [s]"
+      << std::setw(16) << "incremental [s]"
+      << std::setw(16) << "cost diff" << std::endl;
+    for (idx_t n : sizes) {
+      cost_matrix_t costs = randomCosts(n, n, rng);
+      match_vec_t rebuildMatches;
+      match_vec_t incrementalMatches;
+      double rebuildTime = -1;
+      if (n <= maxRebuildSize)
+        rebuildTime = timeIt([&] () {
+            HungarianSolver solver(costs,
+                std::numeric_limits<float>::infinity(),
+                match_vec_t(),
+                HungarianSolver::SearchMode::Rebuild);
+            rebuildMatches = solver.solution();
+            });
+      double incrementalTime = timeIt([&] () {
+          HungarianSolver solver(costs,
+              std::numeric_limits<float>::infinity(),
+              match_vec_t(),
+              HungarianSolver::SearchMode::Incremental);
+          incrementalMatches = solver.solution();
+          });
+      std::cout << std::setw(8) << n << std::setw(16);
+      if (rebuildTime < 0)
+        std::cout << "skipped" << std::setw(16) << incrementalTime
+          << std::setw(16) << "-" << std::endl;
+      else
+        std::cout << rebuildTime << std::setw(16) << incrementalTime
+          << std::setw(16) << totalCost(costs, rebuildMatches) -
+          totalCost(costs, incrementalMatches) << std::endl;
+    }
+  }
+
+  // Solve a problem with a solver that needs no more rows than columns,
+  // transposing it if necessary
+  template <typename T, typename Solve>
+    match_vec_t solveWide(const basic_cost_matrix_t<T>& costs, Solve&& solve)
+    {
+      if (costs.rows() <= costs.cols() )
+        return solve(costs);
+      match_vec_t matches = solve(basic_cost_matrix_t<T>(costs.transpose() ) );
+      for (match_t& match : matches)
+        std::swap(match.first, match.second);
+      return matches;
+    }
+
+  template <typename T>
+    void benchmarkInfinite(
+        const std::string& typeName,
+        const std::vector<idx_t>& sizes,
+        std::size_t nProblems,
+        std::mt19937& rng)
+    {
+      const T inf = std::numeric_limits<T>::infinity();
+      using matrix_t = basic_cost_matrix_t<T>;
+      using engine_t = std::function<match_vec_t(const matrix_t&)>;
+      std::vector<std::pair<std::string, engine_t>> engines{
+        {"incremental", [&] (const matrix_t& costs) {
+            return solveWide(costs, [&] (const matrix_t& wide) {
+                return BasicHungarianSolver<T>(wide, inf, match_vec_t(),
+                    HungarianSearchMode::Incremental).solution();
+              });
+          }},
+        {"rebuild", [&] (const matrix_t& costs) {
+            return solveWide(costs, [&] (const matrix_t& wide) {
+                return BasicHungarianSolver<T>(wide, inf, match_vec_t(),
+                    HungarianSearchMode::Rebuild).solution();
+              });
+          }},
+        {"jv", [&] (const matrix_t& costs) {
+            return solveWide(costs, [&] (const matrix_t& wide) {
+                return BasicJVSolver<T>(wide).solution();
+              });
+          }},
+        {"automatic", [&] (const matrix_t& costs) {
+            return match(costs, inf, Solver::Automatic);
+          }},
+        {"sparse", [&] (const matrix_t& costs) {
+            return sparseMatch(costs, inf);
+          }},
+        {"lazy", [&] (const matrix_t& costs) {
+            // Only the finite costs are candidates
+            return sparseMatch(costs.rows(), costs.cols(),
+                [&] (idx_t ia, idx_t ib) { return float(costs(ia, ib) ); },
+                [&] (idx_t ia, auto&& visit) {
+                  for (idx_t ib = 0; ib < costs.cols(); ++ib)
+                    if (std::isfinite(costs(ia, ib) ) )
+                      visit(ib);
+                },
+                std::numeric_limits<float>::infinity() );
+          }},
+        {"warmstart", [&] (const matrix_t& costs) {
+            return solveWide(costs, [&] (const matrix_t& wide) {
+                // Start the second solve from the state left by the first
+                BasicDualState<T> state;
+                BasicHungarianSolver<T>(wide, inf, state);
+                return BasicHungarianSolver<T>(wide, inf, state).solution();
+              });
+          }},
+        {"dynamic", [&] (const matrix_t& costs) {
+            return BasicDynamicAssignment<T>(costs).solution();
+          }}
+      };
+      std::cout << "Number of " << nProblems << " random " << typeName
+        << " matrices with infinite rows where an engine's matches differ "
+        << "from those with the infinite rows removed. A quarter of the rows "
+        << "of the square matrices are infinite, and half of those of the "
+        << "tall ones" << std::endl;
+      std::cout << std::setw(10) << "shape";
+      for (const auto& engine : engines)
+        std::cout << std::setw(14) << engine.first;
+      std::cout << std::endl;
+      for (idx_t n : sizes) {
+        // A tall problem is transposed by the solvers, so its infinite rows
+        // become infinite columns. There are more of them than extra rows
+        for (idx_t nA : {n, n + n / 2}) {
+          idx_t nInfinite = nA == n ? std::max<idx_t>(n / 4, 1) : nA / 2;
+          std::vector<std::size_t> nDiffer(engines.size(), 0);
+          for (std::size_t ip = 0; ip < nProblems; ++ip) {
+            matrix_t costs = randomCosts(nA, n, rng).template cast<T>();
+            std::vector<idx_t> rows(nA);
+            for (idx_t ia = 0; ia < nA; ++ia)
+              rows[ia] = ia;
+            std::shuffle(rows.begin(), rows.end(), rng);
+            rows.resize(nInfinite);
+            std::sort(rows.begin(), rows.end() );
+            for (idx_t ia : rows)
+              costs.row(ia).setConstant(inf);
+            // The rows that can't be matched are dropped from the reference
+            matrix_t finite(nA - rows.size(), n);
+            for (idx_t ia = 0, row = 0; ia < nA; ++ia)
+              if (!std::binary_search(rows.begin(), rows.end(), ia) )
+                finite.row(row++) = costs.row(ia);
+            match_vec_t reference = solveWide(finite,
+                [] (const matrix_t& wide) {
+                  return BasicHungarianSolver<T>(wide).solution();
+                });
+            double expected = totalCost(finite.template cast<float>(),
+                reference);
+            for (std::size_t ie = 0; ie < engines.size(); ++ie) {
+              match_vec_t matches = engines[ie].second(costs);
+              if (matches.size() != reference.size() ||
+                  std::fabs(totalCost(costs.template cast<float>(), matches) -
+                    expected) > 1e-3)
+                ++nDiffer[ie];
+            }
+          }
+          std::cout << std::setw(10) <<
+            std::to_string(nA) + "x" + std::to_string(n);
+          for (std::size_t count : nDiffer)
+            std::cout << std::setw(14) << count;
+          std::cout << std::endl;
+        }
+      }
+    }
+
+  void benchmarkJV(
+      const std::vector<idx_t>& sizes,
+      double aspect,
+      std::mt19937& rng)
+  {
+    std::cout << "Comparing the HungarianSolver and JVSolver on random "
+      << "matrices with " << aspect << " columns per row" << std::endl;
+    std::cout << std::setw(8) << "rows"
+      << std::setw(16) << "hungarian [s]"
+      << std::setw(16) << "jv [s]"
+      << std::setw(16) << "cost diff" << std::endl;
+    for (idx_t n : sizes) {
+      cost_matrix_t costs = randomCosts(n, n * aspect, rng);
+      match_vec_t hungarianMatches;
+      match_vec_t jvMatches;
+      double hungarianTime = timeIt([&] () {
+          hungarianMatches = HungarianSolver(costs).solution();
+          });
+      double jvTime = timeIt([&] () {
+          jvMatches = JVSolver(costs).solution();
+          });
+      std::cout << std::setw(8) << n << std::setw(16) << hungarianTime
+        << std::setw(16) << jvTime
+        << std::setw(16) << totalCost(costs, hungarianMatches) -
+        totalCost(costs, jvMatches) << std::endl;
+    }
+  }
+
+  void benchmarkAuction(
+      const std::vector<idx_t>& sizes,
+      double extraFraction,
+      float sigmaDR,
+      float maxDR,
+      std::mt19937& rng)
+  {
+    std::cout << "Comparing the HungarianSolver, JVSolver and AuctionSolver "
+      << "on generated points with sigma = " << sigmaDR << " and MaxDR = "
+      << maxDR << std::endl;
+    std::cout << std::setw(8) << "points"
+      << std::setw(16) << "hungarian [s]"
+      << std::setw(16) << "jv [s]"
+      << std::setw(16) << "auction [s]"
+      << std::setw(16) << "auction diff"
+      << std::setw(16) << "auction bound" << std::endl;
+    point_vec_t pointsA;
+    point_vec_t pointsB;
+    for (idx_t n : sizes) {
+      generatePoints(n, n * extraFraction, 2.4, sigmaDR, rng, pointsA, pointsB);
+      cost_matrix_t costs = deltaRCosts(pointsA, pointsB);
+      match_vec_t hungarianMatches;
+      match_vec_t jvMatches;
+      match_vec_t auctionMatches;
+      double bound = 0;
+      double hungarianTime = timeIt([&] () {
+          hungarianMatches = HungarianSolver(costs, maxDR).solution();
+          });
+      double jvTime = timeIt([&] () {
+          jvMatches = JVSolver(costs, maxDR).solution();
+          });
+      double auctionTime = timeIt([&] () {
+          AuctionSolver solver(costs, maxDR);
+          auctionMatches = solver.solution();
+          bound = solver.optimalityBound();
+          });
+      std::cout << std::setw(8) << n << std::setw(16) << hungarianTime
+        << std::setw(16) << jvTime
+        << std::setw(16) << auctionTime
+        << std::setw(16) << totalCost(costs, auctionMatches, maxDR) -
+        totalCost(costs, hungarianMatches, maxDR)
+        << std::setw(16) << bound << std::endl;
+    }
+  }
+
+  void benchmarkSparse(
+      const std::vector<idx_t>& sizes,
+      double extraFraction,
+      float sigmaDR,
+      float maxDR,
+      idx_t maxHungarianSize,
+      std::mt19937& rng)
+  {
+    std::cout << "Comparing the dense solvers with the ShortestPathSolver on "
+      << "generated points with " << extraFraction << " extra 'B' points per "
+      << "'A' point" << std::endl;
+    std::cout << std::setw(8) << "points"
+      << std::setw(16) << "hungarian [s]"
+      << std::setw(16) << "jv [s]"
+      << std::setw(16) << "sparse [s]"
+      << std::setw(16) << "dense [MB]"
+      << std::setw(16) << "sparse [MB]"
+      << std::setw(16) << "cost diff" << std::endl;
+    point_vec_t pointsA;
+    point_vec_t pointsB;
+    for (idx_t n : sizes) {
+      generatePoints(n, n * extraFraction, 2.4, sigmaDR, rng, pointsA, pointsB);
+      cost_matrix_t costs = deltaRCosts(pointsA, pointsB);
+      idx_t nB = costs.cols();
+      match_vec_t jvMatches;
+      match_vec_t sparseMatches;
+      double hungarianTime = -1;
+      if (nB <= maxHungarianSize)
+        hungarianTime = timeIt([&] () { HungarianSolver(costs, maxDR); });
+      double jvTime = timeIt([&] () {
+          jvMatches = JVSolver(costs, maxDR).solution();
+          });
+      std::size_t nEdges = 0;
+      double sparseTime = timeIt([&] () {
+          SparseCostMatrix sparse = SparseCostMatrix::fromDense(costs, maxDR);
+          nEdges = sparse.nEdges();
+          sparseMatches = ShortestPathSolver(sparse).solution();
+          });
+      // The HungarianSolver's working copy is nVtxB x nVtxB
+      double denseMB = nB * nB * sizeof(float) / 1e6;
+      double sparseMB = (nEdges * (sizeof(idx_t) + sizeof(float) ) +
+          (costs.rows() + 1) * sizeof(std::size_t) ) / 1e6;
+      std::cout << std::setw(8) << n << std::setw(16);
+      if (hungarianTime < 0)
+        std::cout << "skipped";
+      else
+        std::cout << hungarianTime;
+      std::cout << std::setw(16) << jvTime
+        << std::setw(16) << sparseTime
+        << std::setw(16) << denseMB
+        << std::setw(16) << sparseMB
+        << std::setw(16) << totalCost(costs, sparseMatches, maxDR) -
+        totalCost(costs, jvMatches, maxDR) << std::endl;
+    }
+  }
+
+  void benchmarkGrouping(
+      const std::vector<idx_t>& sizes,
+      const std::vector<double>& occupancies,
+      std::mt19937& rng)
+  {
+    std::cout << "Comparing the grouping algorithms on random square matrices "
+      << "with a fraction of admissible edges" << std::endl;
+    std::cout << std::setw(8) << "size"
+      << std::setw(12) << "occupancy"
+      << std::setw(12) << "groups"
+      << std::setw(12) << "largest"
+      << std::setw(16) << "bfs [s]"
+      << std::setw(16) << "union-find [s]" << std::endl;
+    for (idx_t n : sizes) {
+      cost_matrix_t costs = randomCosts(n, n, rng);
+      for (double occupancy : occupancies) {
+        // The costs are uniform in [0, 1) so this is the fraction of edges
+        // which pass the cut
+        float maxCost = occupancy;
+        std::size_t nGroups = 0;
+        std::size_t largest = 0;
+        double bfsTime = timeIt([&] () {
+            splitProblemIntoSparseGroups(costs, maxCost,
+                GroupingAlgorithm::BreadthFirst);
+            });
+        double unionFindTime = timeIt([&] () {
+            std::vector<SparseGroup> groups = splitProblemIntoSparseGroups(
+                costs, maxCost, GroupingAlgorithm::UnionFind);
+            nGroups = groups.size();
+            for (const SparseGroup& group : groups)
+              largest = std::max(largest, group.indicesA.size() );
+            });
+        std::cout << std::setw(8) << n << std::setw(12) << occupancy
+          << std::setw(12) << nGroups << std::setw(12) << largest
+          << std::setw(16) << bfsTime << std::setw(16) << unionFindTime
+          << std::endl;
+      }
+    }
+  }
+
+  void benchmarkGroupCosts(
+      const std::vector<idx_t>& sizes,
+      const std::vector<double>& degrees,
+      std::mt19937& rng)
+  {
+    std::cout << "Comparing groups that copy their costs with groups that view "
+      << "the full matrix on random square matrices. The memory is what the "
+      << "groups hold for the copy and the largest gather for the view"
+      << std::endl;
+    std::cout << std::setw(8) << "size"
+      << std::setw(8) << "degree"
+      << std::setw(12) << "copy [MB]"
+      << std::setw(12) << "view [MB]"
+      << std::setw(16) << "copy split [s]"
+      << std::setw(16) << "view split [s]"
+      << std::setw(16) << "copy match [s]"
+      << std::setw(16) << "view match [s]"
+      << std::setw(8) << "same" << std::endl;
+    for (idx_t n : sizes) {
+      cost_matrix_t costs = randomCosts(n, n, rng);
+      for (double degree : degrees) {
+        // The costs are uniform in [0, 1) so this gives each vertex this many
+        // admissible edges on average
+        float maxCost = degree / n;
+        std::vector<SparseGroup> copyGroups;
+        std::vector<SparseGroup> viewGroups;
+        double copySplitTime = timeIt([&] () {
+            copyGroups = splitProblemIntoSparseGroups(costs, maxCost,
+                GroupingAlgorithm::UnionFind, GroupCosts::Copy);
+            });
+        double viewSplitTime = timeIt([&] () {
+            viewGroups = splitProblemIntoSparseGroups(costs, maxCost,
+                GroupingAlgorithm::UnionFind, GroupCosts::View);
+            });
+        std::size_t copyElements = 0;
+        std::size_t largest = 0;
+        for (const SparseGroup& group : copyGroups) {
+          copyElements += group.costs.size();
+          largest = std::max<std::size_t>(largest, group.costs.size() );
+        }
+        match_vec_t copyMatches;
+        match_vec_t viewMatches;
+        double copyMatchTime = timeIt([&] () {
+            copyMatches = matchFromGroups(copyGroups);
+            });
+        double viewMatchTime = timeIt([&] () {
+            viewMatches = matchFromGroups(viewGroups);
+            });
+        std::cout << std::setw(8) << n << std::setw(8) << degree
+          << std::setw(12) << copyElements * sizeof(float) / 1e6
+          << std::setw(12) << largest * sizeof(float) / 1e6
+          << std::setw(16) << copySplitTime
+          << std::setw(16) << viewSplitTime
+          << std::setw(16) << copyMatchTime
+          << std::setw(16) << viewMatchTime
+          << std::setw(8) << (copyMatches == viewMatches ? "yes" : "no")
+          << std::endl;
+      }
+    }
+  }
+
+  void benchmarkParallel(
+      const std::vector<idx_t>& sizes,
+      double extraFraction,
+      float sigmaDR,
+      float maxDR,
+      std::size_t nThreads,
+      std::mt19937& rng)
+  {
+    ThreadPool pool(nThreads);
+    std::cout << "Comparing serial and parallel matchFromGroups with "
+      << pool.size() << " threads on generated points" << std::endl;
+    std::cout << std::setw(8) << "points"
+      << std::setw(12) << "groups"
+      << std::setw(16) << "serial [s]"
+      << std::setw(16) << "parallel [s]"
+      << std::setw(16) << "same result" << std::endl;
+    point_vec_t pointsA;
+    point_vec_t pointsB;
+    for (idx_t n : sizes) {
+      generatePoints(n, n * extraFraction, 2.4, sigmaDR, rng, pointsA, pointsB);
+      std::vector<SparseGroup> groups = splitProblemIntoSparseGroups(
+          pointsA, pointsB, maxDR);
+      match_vec_t serialMatches;
+      match_vec_t parallelMatches;
+      double serialTime = timeIt([&] () {
+          serialMatches = matchFromGroups(groups);
+          });
+      double parallelTime = timeIt([&] () {
+          parallelMatches = matchFromGroups(groups, pool);
+          });
+      std::cout << std::setw(8) << n << std::setw(12) << groups.size()
+        << std::setw(16) << serialTime << std::setw(16) << parallelTime
+        << std::setw(16) << (serialMatches == parallelMatches ? "yes" : "no")
+        << std::endl;
+    }
+  }
+
+  void benchmarkPipeline(
+      const std::vector<idx_t>& sizes,
+      double extraFraction,
+      float sigmaDR,
+      float maxDR,
+      std::size_t nThreads,
+      std::mt19937& rng)
+  {
+    ThreadPool pool(nThreads);
+    std::cout << "Comparing grouping then solving with solving the groups as "
+      << "they are found, with " << pool.size() << " threads on generated "
+      << "points" << std::endl;
+    std::cout << std::setw(8) << "points"
+      << std::setw(16) << "grouping [s]"
+      << std::setw(16) << "solving [s]"
+      << std::setw(16) << "sequential [s]"
+      << std::setw(16) << "pipelined [s]"
+      << std::setw(16) << "same result" << std::endl;
+    point_vec_t pointsA;
+    point_vec_t pointsB;
+    for (idx_t n : sizes) {
+      generatePoints(n, n * extraFraction, 2.4, sigmaDR, rng, pointsA, pointsB);
+      cost_matrix_t costs = deltaRCosts(pointsA, pointsB);
+      std::vector<SparseGroup> groups;
+      match_vec_t sequentialMatches;
+      match_vec_t pipelinedMatches;
+      double groupingTime = timeIt([&] () {
+          groups = splitProblemIntoSparseGroups(costs, maxDR,
+              GroupingAlgorithm::BreadthFirst, GroupCosts::View);
+          });
+      double solvingTime = timeIt([&] () {
+          sequentialMatches = matchFromGroups(groups, pool);
+          });
+      double pipelinedTime = timeIt([&] () {
+          pipelinedMatches = sparseMatch(costs, maxDR, pool);
+          });
+      std::cout << std::setw(8) << n
+        << std::setw(16) << groupingTime
+        << std::setw(16) << solvingTime
+        << std::setw(16) << groupingTime + solvingTime
+        << std::setw(16) << pipelinedTime
+        << std::setw(16) <<
+        (sequentialMatches == pipelinedMatches ? "yes" : "no") << std::endl;
+    }
+  }
+
+  void benchmarkBatch(
+      const std::vector<idx_t>& sizes,
+      std::size_t nEvents,
+      double extraFraction,
+      float sigmaDR,
+      float maxDR,
+      std::size_t nThreads,
+      std::mt19937& rng)
+  {
+    BatchMatcher matcher(nThreads);
+    std::cout << "Comparing a loop over sparseMatch with a BatchMatcher using "
+      << matcher.nThreads() << " threads on " << nEvents
+      << " events of generated points" << std::endl;
+    std::cout << std::setw(8) << "points"
+      << std::setw(16) << "loop [s]"
+      << std::setw(16) << "batch [s]"
+      << std::setw(16) << "same result" << std::endl;
+    for (idx_t n : sizes) {
+      std::vector<point_vec_t> pointsA(nEvents);
+      std::vector<point_vec_t> pointsB(nEvents);
+      std::vector<PointEvent> events;
+      for (std::size_t ie = 0; ie < nEvents; ++ie) {
+        generatePoints(n, n * extraFraction, 2.4, sigmaDR, rng,
+            pointsA[ie], pointsB[ie]);
+        events.push_back(PointEvent{&pointsA[ie], &pointsB[ie], maxDR});
+      }
+      std::vector<match_vec_t> loopMatches(nEvents);
+      BatchResult batchMatches;
+      double loopTime = timeIt([&] () {
+          for (std::size_t ie = 0; ie < nEvents; ++ie)
+            loopMatches[ie] = sparseMatch(pointsA[ie], pointsB[ie], maxDR);
+          });
+      double batchTime = timeIt([&] () {
+          batchMatches = matcher.match(events);
+          });
+      bool same = true;
+      for (std::size_t ie = 0; ie < nEvents; ++ie)
+        same &= std::equal(loopMatches[ie].begin(), loopMatches[ie].end(),
+            batchMatches.begin(ie), batchMatches.end(ie) );
+      std::cout << std::setw(8) << n << std::setw(16) << loopTime
+        << std::setw(16) << batchTime
+        << std::setw(16) << (same ? "yes" : "no") << std::endl;
+    }
+  }
+
+  /// Returns false if any solve that reuses a warmed-up workspace allocated
+  bool benchmarkWorkspace(
+      const std::vector<idx_t>& sizes,
+      std::size_t nEvents,
+      double extraFraction,
+      float sigmaDR,
+      float maxDR,
+      std::mt19937& rng)
+  {
+    std::cout << "Comparing sparseMatch with and without a SolverWorkspace on "
+      << nEvents << " events of generated points. Allocations are counted "
+      << "after one warm-up pass over the events" << std::endl;
+    std::cout << std::setw(8) << "points"
+      << std::setw(16) << "plain [s]"
+      << std::setw(16) << "workspace [s]"
+      << std::setw(16) << "plain allocs"
+      << std::setw(16) << "ws allocs" << std::endl;
+    bool allocationFree = true;
+    for (idx_t n : sizes) {
+      std::vector<cost_matrix_t> events;
+      point_vec_t pointsA;
+      point_vec_t pointsB;
+      for (std::size_t ie = 0; ie < nEvents; ++ie) {
+        generatePoints(n, n * extraFraction, 2.4, sigmaDR, rng, pointsA, pointsB);
+        events.push_back(deltaRCosts(pointsA, pointsB) );
+      }
+      SolverWorkspace workspace;
+      for (const cost_matrix_t& costs : events)
+        sparseMatch(costs, maxDR, workspace);
+      // Count inside the timed functions so as not to include the allocation
+      // made by the std::function itself
+      std::size_t plainAllocs = 0;
+      double plainTime = timeIt([&] () {
+          std::size_t start = allocationCount();
+          for (const cost_matrix_t& costs : events)
+            sparseMatch(costs, maxDR);
+          plainAllocs = allocationCount() - start;
+          });
+      std::size_t workspaceAllocs = 0;
+      double workspaceTime = timeIt([&] () {
+          std::size_t start = allocationCount();
+          for (const cost_matrix_t& costs : events)
+            sparseMatch(costs, maxDR, workspace);
+          workspaceAllocs = allocationCount() - start;
+          });
+      std::cout << std::setw(8) << n << std::setw(16) << plainTime
+        << std::setw(16) << workspaceTime
+        << std::setw(16) << plainAllocs
+        << std::setw(16) << workspaceAllocs << std::endl;
+      allocationFree &= workspaceAllocs == 0;
+    }
+    if (!allocationFree)
+      std::cerr << "sparseMatch allocated after warming up its workspace!"
+        << std::endl;
+    return allocationFree;
+  }
+
+  void benchmarkArena(
+      const std::vector<idx_t>& sizes,
+      std::size_t nEvents,
+      double extraFraction,
+      float sigmaDR,
+      float maxDR,
+      std::mt19937& rng)
+  {
+    std::cout << "Comparing a vector of SparseGroups with a GroupArena on "
+      << nEvents << " events of generated points. Allocations are counted "
+      << "after one warm-up pass over the events" << std::endl;
+    std::cout << std::setw(8) << "points"
+      << std::setw(12) << "groups"
+      << std::setw(16) << "vector [us]"
+      << std::setw(16) << "arena [us]"
+      << std::setw(16) << "vector allocs"
+      << std::setw(16) << "arena allocs"
+      << std::setw(8) << "same" << std::endl;
+    for (idx_t n : sizes) {
+      std::vector<cost_matrix_t> events;
+      point_vec_t pointsA;
+      point_vec_t pointsB;
+      for (std::size_t ie = 0; ie < nEvents; ++ie) {
+        generatePoints(n, n * extraFraction, 2.4, sigmaDR, rng, pointsA, pointsB);
+        events.push_back(deltaRCosts(pointsA, pointsB) );
+      }
+      std::vector<match_vec_t> vectorMatches(nEvents);
+      std::vector<match_vec_t> arenaMatches(nEvents);
+      GroupArena arena;
+      SolverWorkspace workspace;
+      std::size_t nGroups = 0;
+      for (std::size_t ie = 0; ie < nEvents; ++ie) {
+        arena.split(events[ie], maxDR);
+        nGroups += arena.size();
+        const match_vec_t& matches = matchFromGroups(arena, workspace);
+        arenaMatches[ie].assign(matches.begin(), matches.end() );
+      }
+      // Count inside the timed functions so as not to include the allocation
+      // made by the std::function itself
+      std::size_t vectorAllocs = 0;
+      double vectorTime = timeIt([&] () {
+          std::size_t start = allocationCount();
+          for (std::size_t ie = 0; ie < nEvents; ++ie)
+            vectorMatches[ie] = matchFromGroups(splitProblemIntoSparseGroups(
+                  events[ie], maxDR, GroupingAlgorithm::UnionFind) );
+          vectorAllocs = allocationCount() - start;
+          });
+      std::size_t arenaAllocs = 0;
+      double arenaTime = timeIt([&] () {
+          std::size_t start = allocationCount();
+          for (std::size_t ie = 0; ie < nEvents; ++ie) {
+            arena.split(events[ie], maxDR);
+            const match_vec_t& matches = matchFromGroups(arena, workspace);
+            arenaMatches[ie].assign(matches.begin(), matches.end() );
+          }
+          arenaAllocs = allocationCount() - start;
+          });
+      std::cout << std::setw(8) << n
+        << std::setw(12) << static_cast<double>(nGroups) / nEvents
+        << std::setw(16) << 1e6 * vectorTime / nEvents
+        << std::setw(16) << 1e6 * arenaTime / nEvents
+        << std::setw(16) << static_cast<double>(vectorAllocs) / nEvents
+        << std::setw(16) << static_cast<double>(arenaAllocs) / nEvents
+        << std::setw(8) << (vectorMatches == arenaMatches ? "yes" : "no")
+        << std::endl;
+    }
+  }
+
+  void benchmarkAugment(
+      const std::vector<idx_t>& sizes,
+      std::size_t nRepeats,
+      std::mt19937& rng)
+  {
+    std::cout << "Time per augmentation of the HungarianSolver search modes on "
+      << "random square matrices, using a workspace" << std::endl;
+    std::cout << std::setw(8) << "size"
+      << std::setw(16) << "rebuild [us]"
+      << std::setw(18) << "incremental [us]" << std::endl;
+    SolverWorkspace workspace;
+    for (idx_t n : sizes) {
+      cost_matrix_t costs = randomCosts(n, n, rng);
+      // Every 'A' vertex is the root of one augmentation
+      auto perAugmentation = [&] (HungarianSolver::SearchMode mode) {
+        double time = timeIt([&] () {
+            for (std::size_t ii = 0; ii < nRepeats; ++ii)
+              HungarianSolver(costs, std::numeric_limits<float>::infinity(),
+                  match_vec_t(), mode, &workspace);
+            });
+        return 1e6 * time / (nRepeats * n);
+      };
+      // Warm the workspace up
+      perAugmentation(HungarianSolver::SearchMode::Incremental);
+      double rebuild = perAugmentation(HungarianSolver::SearchMode::Rebuild);
+      double incremental = perAugmentation(
+          HungarianSolver::SearchMode::Incremental);
+      std::cout << std::setw(8) << n << std::setw(16) << rebuild
+        << std::setw(18) << incremental << std::endl;
+    }
+  }
+
+  // Move each point by a gaussian distance in a random direction, keeping phi
+  // in [0, 2pi)
+  void driftPoints(point_vec_t& points, float step, std::mt19937& rng)
+  {
+    std::uniform_real_distribution<float> phiDist(0, 2*pi);
+    std::normal_distribution<float> drDist(0, step);
+    for (auto& p : points) {
+      float dr = drDist(rng);
+      float direction = phiDist(rng);
+      float phi = std::fmod(p.first + dr*std::sin(direction), 2*pi);
+      if (phi < 0)
+        phi += 2*pi;
+      p = std::make_pair(phi, p.second + dr*std::cos(direction) );
+    }
+  }
+
+  void benchmarkWarmStart(
+      const std::vector<idx_t>& sizes,
+      std::size_t nFrames,
+      double extraFraction,
+      float sigmaDR,
+      float maxDR,
+      float drift,
+      std::mt19937& rng)
+  {
+    std::cout << "Comparing cold and warm started HungarianSolvers on "
+      << nFrames << " frames of drifting points. Both sets keep their order "
+      << "between frames" << std::endl;
+    std::cout << std::setw(8) << "points"
+      << std::setw(16) << "cold [ms]"
+      << std::setw(16) << "warm [ms]"
+      << std::setw(16) << "kept matches"
+      << std::setw(8) << "same" << std::endl;
+    for (idx_t n : sizes) {
+      point_vec_t pointsA;
+      point_vec_t pointsB;
+      generatePoints(n, n * extraFraction, 2.4, sigmaDR, rng, pointsA, pointsB);
+      std::vector<cost_matrix_t> frames;
+      for (std::size_t iframe = 0; iframe < nFrames; ++iframe) {
+        frames.push_back(deltaRCosts(pointsA, pointsB) );
+        driftPoints(pointsA, drift, rng);
+        driftPoints(pointsB, drift, rng);
+      }
+      std::vector<match_vec_t> coldMatches(nFrames);
+      std::vector<match_vec_t> warmMatches(nFrames);
+      SolverWorkspace workspace;
+      double coldTime = timeIt([&] () {
+          for (std::size_t iframe = 0; iframe < nFrames; ++iframe) {
+            HungarianSolver solver(frames[iframe], maxDR, match_vec_t(),
+                HungarianSolver::SearchMode::Incremental, &workspace);
+            coldMatches[iframe] = solver.solution();
+          }
+          });
+      DualState state;
+      std::size_t nKept = 0;
+      double warmTime = timeIt([&] () {
+          for (std::size_t iframe = 0; iframe < nFrames; ++iframe) {
+            HungarianSolver solver(frames[iframe], maxDR, state,
+                HungarianSolver::SearchMode::Incremental, &workspace);
+            warmMatches[iframe] = solver.solution();
+          }
+          });
+      // Count the matches that carried over from the previous frame
+      std::vector<idx_t> previous(n);
+      for (std::size_t iframe = 1; iframe < nFrames; ++iframe) {
+        std::fill(previous.begin(), previous.end(), -1);
+        for (const match_t& m : warmMatches[iframe - 1])
+          previous[m.first] = m.second;
+        for (const match_t& m : warmMatches[iframe])
+          nKept += previous[m.first] == m.second;
+      }
+      bool same = true;
+      for (std::size_t iframe = 0; iframe < nFrames; ++iframe)
+        same &= std::fabs(
+            totalCost(frames[iframe], coldMatches[iframe], maxDR) -
+            totalCost(frames[iframe], warmMatches[iframe], maxDR) ) < 1e-3;
+      std::cout << std::setw(8) << n
+        << std::setw(16) << 1e3 * coldTime / nFrames
+        << std::setw(16) << 1e3 * warmTime / nFrames
+        << std::setw(16) << static_cast<double>(nKept) / (n * (nFrames - 1) )
+        << std::setw(8) << (same ? "yes" : "no") << std::endl;
+    }
+  }
+
+  void benchmarkDynamic(
+      const std::vector<idx_t>& sizes,
+      std::size_t nOps,
+      double extraFraction,
+      float sigmaDR,
+      float maxDR,
+      std::mt19937& rng)
+  {
+    std::cout << "Comparing a DynamicAssignment with fresh HungarianSolvers "
+      << "over " << nOps << " changes, each replacing one point" << std::endl;
+    std::cout << std::setw(8) << "points"
+      << std::setw(16) << "fresh [ms]"
+      << std::setw(16) << "dynamic [ms]"
+      << std::setw(8) << "same" << std::endl;
+    for (idx_t n : sizes) {
+      point_vec_t pointsA;
+      point_vec_t pointsB;
+      generatePoints(n, n * extraFraction, 2.4, sigmaDR, rng, pointsA, pointsB);
+      cost_matrix_t initial = deltaRCosts(pointsA, pointsB);
+      // Alternate between replacing an 'A' and a 'B' point. The new point is
+      // appended, as insertRow and insertColumn do
+      std::vector<idx_t> removed;
+      std::vector<cost_matrix_t> inserted;
+      std::vector<cost_matrix_t> frames;
+      for (std::size_t iop = 0; iop < nOps; ++iop) {
+        point_vec_t newA;
+        point_vec_t newB;
+        generatePoints(1, 0, 2.4, sigmaDR, rng, newA, newB);
+        if (iop % 2 == 0) {
+          idx_t ia = std::uniform_int_distribution<idx_t>(0, n - 1)(rng);
+          pointsA.erase(pointsA.begin() + ia);
+          removed.push_back(ia);
+          inserted.push_back(deltaRCosts(newA, pointsB) );
+          pointsA.push_back(newA.front() );
+        }
+        else {
+          idx_t ib = std::uniform_int_distribution<idx_t>(
+              0, pointsB.size() - 1)(rng);
+          pointsB.erase(pointsB.begin() + ib);
+          removed.push_back(ib);
+          inserted.push_back(deltaRCosts(pointsA, newB) );
+          pointsB.push_back(newB.front() );
+        }
+        frames.push_back(deltaRCosts(pointsA, pointsB) );
+      }
+      SolverWorkspace workspace;
+      match_vec_t freshMatches;
+      double freshTime = timeIt([&] () {
+          for (std::size_t iop = 0; iop < nOps; ++iop) {
+            HungarianSolver solver(frames[iop], maxDR, match_vec_t(),
+                HungarianSolver::SearchMode::Incremental, &workspace);
+            freshMatches = solver.solution();
+          }
+          });
+      DynamicAssignment dynamic(initial, maxDR);
+      double dynamicTime = timeIt([&] () {
+          for (std::size_t iop = 0; iop < nOps; ++iop) {
+            if (iop % 2 == 0) {
+              dynamic.removeRow(removed[iop]);
+              dynamic.insertRow(inserted[iop].row(0) );
+            }
+            else {
+              dynamic.removeColumn(removed[iop]);
+              dynamic.insertColumn(inserted[iop].col(0) );
+            }
+          }
+          });
+      bool same = std::fabs(
+          totalCost(frames.back(), freshMatches, maxDR) -
+          totalCost(frames.back(), dynamic.solution(), maxDR) ) < 1e-3;
+      std::cout << std::setw(8) << n
+        << std::setw(16) << 1e3 * freshTime / nOps
+        << std::setw(16) << 1e3 * dynamicTime / nOps
+        << std::setw(8) << (same ? "yes" : "no") << std::endl;
+    }
+  }
+
+  void benchmarkLazy(
+      const std::vector<idx_t>& sizes,
+      double extraFraction,
+      float sigmaDR,
+      float maxDR,
+      std::mt19937& rng)
+  {
+    std::cout << "Comparing the sparse matching on a dense deltaR matrix with "
+      << "the same matching on a cost function, whose candidates are the 'B' "
+      << "points in an eta window around each 'A' point" << std::endl;
+    std::cout << std::setw(8) << "points"
+      << std::setw(16) << "dense [ms]"
+      << std::setw(16) << "lazy [ms]"
+      << std::setw(16) << "evaluated"
+      << std::setw(8) << "same" << std::endl;
+    for (idx_t n : sizes) {
+      point_vec_t pointsA;
+      point_vec_t pointsB;
+      generatePoints(n, n * extraFraction, 2.4, sigmaDR, rng, pointsA, pointsB);
+      idx_t nB = pointsB.size();
+      match_vec_t denseMatches;
+      double denseTime = timeIt([&] () {
+          denseMatches = sparseMatch(deltaRCosts(pointsA, pointsB), maxDR);
+          });
+      match_vec_t lazyMatches;
+      std::size_t nEvaluated = 0;
+      double lazyTime = timeIt([&] () {
+          // Sort the 'B' points in eta so each 'A' point only looks at a
+          // window of them
+          std::vector<idx_t> order(nB);
+          for (idx_t ib = 0; ib < nB; ++ib)
+            order[ib] = ib;
+          std::sort(order.begin(), order.end(), [&] (idx_t lhs, idx_t rhs) {
+              return pointsB[lhs].second < pointsB[rhs].second;
+              });
+          std::vector<float> etas(nB);
+          for (idx_t ib = 0; ib < nB; ++ib)
+            etas[ib] = pointsB[order[ib]].second;
+          nEvaluated = 0;
+          lazyMatches = sparseMatch(n, nB,
+              [&] (idx_t ia, idx_t ib) {
+                ++nEvaluated;
+                return deltaR(pointsA[ia], pointsB[ib]);
+              },
+              [&] (idx_t ia, auto&& visit) {
+                float eta = pointsA[ia].second;
+                auto begin = std::lower_bound(
+                    etas.begin(), etas.end(), eta - maxDR);
+                auto end = std::upper_bound(begin, etas.end(), eta + maxDR);
+                for (auto itr = begin; itr != end; ++itr)
+                  visit(order[itr - etas.begin()]);
+              },
+              maxDR);
+          });
+      cost_matrix_t costs = deltaRCosts(pointsA, pointsB);
+      bool same = std::fabs(totalCost(costs, denseMatches, maxDR) -
+          totalCost(costs, lazyMatches, maxDR) ) < 1e-3;
+      std::cout << std::setw(8) << n
+        << std::setw(16) << 1e3 * denseTime
+        << std::setw(16) << 1e3 * lazyTime
+        << std::setw(16) << static_cast<double>(nEvaluated) / (n * nB)
+        << std::setw(8) << (same ? "yes" : "no") << std::endl;
+    }
+  }
+
+  void benchmarkDeltaR(
+      const std::vector<idx_t>& sizes,
+      double extraFraction,
+      float sigmaDR,
+      float maxDR,
+      std::mt19937& rng)
+  {
+    std::cout << "Time to build the deltaR costs densely, with the grid in "
+      << "buildDeltaRCosts and with the DeltaRMatcher" << std::endl;
+    std::cout << std::setw(8) << "points"
+      << std::setw(16) << "dense [ms]"
+      << std::setw(16) << "grid [ms]"
+      << std::setw(16) << "matcher [ms]"
+      << std::setw(8) << "same" << std::endl;
+    for (idx_t n : sizes) {
+      point_vec_t pointsA;
+      point_vec_t pointsB;
+      generatePoints(n, n * extraFraction, 2.4, sigmaDR, rng, pointsA, pointsB);
+      Eigen::ArrayXf phiA(pointsA.size() );
+      Eigen::ArrayXf etaA(pointsA.size() );
+      Eigen::ArrayXf phiB(pointsB.size() );
+      Eigen::ArrayXf etaB(pointsB.size() );
+      for (std::size_t ia = 0; ia < pointsA.size(); ++ia)
+        std::tie(phiA[ia], etaA[ia]) = pointsA[ia];
+      for (std::size_t ib = 0; ib < pointsB.size(); ++ib)
+        std::tie(phiB[ib], etaB[ib]) = pointsB[ib];
+      double denseTime = timeIt([&] () { deltaRCosts(pointsA, pointsB); });
+      SparseCostMatrix gridCosts;
+      double gridTime = timeIt([&] () {
+          gridCosts = buildDeltaRCosts(pointsA, pointsB, maxDR);
+          });
+      DeltaRMatcher matcher(maxDR);
+      double matcherTime = timeIt([&] () {
+          matcher.buildCosts(phiA, etaA, phiB, etaB);
+          });
+      bool same = matcher.costs().cols == gridCosts.cols &&
+        matcher.costs().costs == gridCosts.costs &&
+        matcher.costs().rowOffsets == gridCosts.rowOffsets;
+      std::cout << std::setw(8) << n
+        << std::setw(16) << 1e3 * denseTime
+        << std::setw(16) << 1e3 * gridTime
+        << std::setw(16) << 1e3 * matcherTime
+        << std::setw(8) << (same ? "yes" : "no") << std::endl;
+    }
+  }
+
+  void benchmarkRadius(
+      const std::vector<idx_t>& sizes,
+      std::mt19937& rng)
+  {
+    using point3_t = std::array<float, 3>;
+    std::cout << "Time to find the edges between 3D points, uniform in a unit "
+      << "box with the last axis periodic, by comparing every pair and with "
+      << "a RadiusSearch" << std::endl;
+    std::cout << std::setw(8) << "points"
+      << std::setw(16) << "all pairs [ms]"
+      << std::setw(16) << "k-d tree [ms]"
+      << std::setw(16) << "edges"
+      << std::setw(8) << "same" << std::endl;
+    std::uniform_real_distribution<float> coordDist(0, 1);
+    for (idx_t n : sizes) {
+      std::vector<point3_t> pointsA(n);
+      std::vector<point3_t> pointsB(n);
+      for (std::vector<point3_t>* points : {&pointsA, &pointsB})
+        for (point3_t& point : *points)
+          for (float& coord : point)
+            coord = coordDist(rng);
+      // About four neighbours per point
+      float radius = std::cbrt(4 / (4 * pi / 3 * n) );
+      point3_t periods{0, 0, 1};
+      SparseCostMatrix allCosts;
+      double allTime = timeIt([&] () {
+          RadiusSearch<3> search(pointsB, radius, EuclideanMetric<3>(), periods);
+          allCosts = SparseCostMatrix::fromFunction(n, n, radius,
+              [&] (idx_t ia, idx_t ib) {
+                return search.distance(pointsA[ia], pointsB[ib]);
+              },
+              [&] (idx_t, auto&& visit) {
+                for (idx_t ib = 0; ib < n; ++ib)
+                  visit(ib);
+              });
+          });
+      SparseCostMatrix treeCosts;
+      double treeTime = timeIt([&] () {
+          treeCosts = buildRadiusCosts<3>(
+              pointsA, pointsB, radius, EuclideanMetric<3>(), periods);
+          });
+      bool same = allCosts.cols == treeCosts.cols &&
+        allCosts.costs == treeCosts.costs;
+      std::cout << std::setw(8) << n
+        << std::setw(16) << 1e3 * allTime
+        << std::setw(16) << 1e3 * treeTime
+        << std::setw(16) << treeCosts.nEdges()
+        << std::setw(8) << (same ? "yes" : "no") << std::endl;
+    }
+  }
+
+  void benchmarkEvents(
+      const std::vector<idx_t>& sizes,
+      std::size_t nEvents,
+      double extraFraction,
+      float sigmaDR,
+      float maxDR,
+      std::mt19937& rng)
+  {
+    std::cout << "Time to load " << nEvents << " events from JSON text and "
+      << "from a binary event file" << std::endl;
+    std::cout << std::setw(8) << "points"
+      << std::setw(16) << "json [ms]"
+      << std::setw(16) << "binary [ms]"
+      << std::setw(16) << "json [kB]"
+      << std::setw(16) << "binary [kB]" << std::endl;
+    std::string path = (std::filesystem::temp_directory_path() /
+        "BenchmarkSolvers.events").string();
+    for (idx_t n : sizes) {
+      std::vector<std::string> texts;
+      std::size_t textSize = 0;
+      {
+        EventFileWriter writer(path);
+        for (std::size_t ie = 0; ie < nEvents; ++ie) {
+          point_vec_t pointsA;
+          point_vec_t pointsB;
+          generatePoints(
+              n, n * extraFraction, 2.4, sigmaDR, rng, pointsA, pointsB);
+          nlohmann::json j;
+          j["PointsA"] = pointsA;
+          j["PointsB"] = pointsB;
+          j["MaxDR"] = maxDR;
+          texts.push_back(j.dump() );
+          textSize += texts.back().size();
+          writer.write(pointsA, pointsB, maxDR);
+        }
+      }
+      // Sum the coordinates so that both really read them
+      double jsonSum = 0;
+      double jsonTime = timeIt([&] () {
+          for (const std::string& text : texts) {
+            nlohmann::json j = nlohmann::json::parse(text);
+            for (const char* key : {"PointsA", "PointsB"})
+              for (const point_t& point : j[key].get<point_vec_t>() )
+                jsonSum += point.first + point.second;
+          }
+          });
+      double binarySum = 0;
+      double binaryTime = timeIt([&] () {
+          EventFileReader reader(path);
+          for (std::size_t ie = 0; ie < reader.nEvents(); ++ie) {
+            EventView event = reader.event(ie);
+            binarySum += event.phiA.sum() + event.etaA.sum() +
+              event.phiB.sum() + event.etaB.sum();
+          }
+          });
+      std::cout << std::setw(8) << n
+        << std::setw(16) << 1e3 * jsonTime
+        << std::setw(16) << 1e3 * binaryTime
+        << std::setw(16) << textSize / 1024
+        << std::setw(16) << std::filesystem::file_size(path) / 1024
+        << std::endl;
+    }
+    std::filesystem::remove(path);
+  }
+
+  void benchmarkStream(
+      const std::vector<idx_t>& sizes,
+      std::size_t nEvents,
+      double extraFraction,
+      float sigmaDR,
+      float maxDR,
+      std::size_t nThreads,
+      std::mt19937& rng)
+  {
+    StreamingMatcher matcher(nThreads);
+    std::cout << "Time to match " << nEvents << " events streamed from a "
+      << "binary event file one at a time and with a StreamingMatcher using "
+      << matcher.nThreads() << " threads and a window of " << matcher.window()
+      << " events" << std::endl;
+    std::cout << std::setw(8) << "points"
+      << std::setw(16) << "serial [ms]"
+      << std::setw(16) << "stream [ms]"
+      << std::setw(16) << "events/s" << std::endl;
+    std::string path = (std::filesystem::temp_directory_path() /
+        "BenchmarkSolvers.stream").string();
+    for (idx_t n : sizes) {
+      {
+        EventFileWriter writer(path);
+        for (std::size_t ie = 0; ie < nEvents; ++ie) {
+          point_vec_t pointsA;
+          point_vec_t pointsB;
+          generatePoints(
+              n, n * extraFraction, 2.4, sigmaDR, rng, pointsA, pointsB);
+          writer.write(pointsA, pointsB, maxDR);
+        }
+      }
+      // Count the matches so that both really solve every event
+      std::size_t serialMatches = 0;
+      double serialTime = timeIt([&] () {
+          std::ifstream in(path, std::ios::binary);
+          EventStreamReader reader(in);
+          EventData event;
+          DeltaRMatcher deltaR(maxDR);
+          while (reader.read(event) )
+            serialMatches += deltaR.match(
+                event.phiA, event.etaA, event.phiB, event.etaB).size();
+          });
+      std::size_t streamMatches = 0;
+      double streamTime = timeIt([&] () {
+          std::ifstream in(path, std::ios::binary);
+          EventStreamReader reader(in);
+          matcher.run(
+              [&] (EventData& event) { return reader.read(event); },
+              [&] (std::size_t, const match_vec_t& matches) {
+                streamMatches += matches.size();
+              });
+          });
+      if (streamMatches != serialMatches)
+        std::cerr << "Streamed matches differ from serial matches!"
+          << std::endl;
+      std::cout << std::setw(8) << n
+        << std::setw(16) << 1e3 * serialTime
+        << std::setw(16) << 1e3 * streamTime
+        << std::setw(16) << std::size_t(nEvents / streamTime)
+        << std::endl;
+    }
+    std::filesystem::remove(path);
+  }
+
+  void benchmarkLayout(
+      const std::vector<idx_t>& sizes,
+      std::mt19937& rng)
+  {
+    using row_major_t = Eigen::Matrix<
+      float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+    std::cout << "Time to match the same costs stored in different layouts"
+      << std::endl;
+    std::cout << std::setw(8) << "size"
+      << std::setw(20) << "column-major [ms]"
+      << std::setw(20) << "row-major [ms]"
+      << std::setw(20) << "transpose [ms]" << std::endl;
+    for (idx_t n : sizes) {
+      cost_matrix_t costs = randomCosts(n, n, rng);
+      row_major_t rowMajor = costs;
+      cost_matrix_t transposed = costs.transpose();
+      double colTime = timeIt([&] () { match(costs, 1); });
+      double rowTime = timeIt([&] () { match(rowMajor, 1); });
+      double transposeTime = timeIt([&] () {
+          match(transposed.transpose(), 1); });
+      std::cout << std::setw(8) << n
+        << std::setw(20) << 1e3 * colTime
+        << std::setw(20) << 1e3 * rowTime
+        << std::setw(20) << 1e3 * transposeTime << std::endl;
+    }
+  }
+
+  // Draw a random cost. Integer costs are uniform in [0, 1e6) and floating
+  // point ones in [0, 1)
+  template <typename T>
+    T randomCost(std::mt19937& rng)
+    {
+      if constexpr (std::is_integral<T>::value)
+        return std::uniform_int_distribution<T>(0, 999999)(rng);
+      else
+        return std::uniform_real_distribution<T>(0, 1)(rng);
+    }
+
+  void benchmarkTiny(
+      std::size_t nProblems,
+      std::mt19937& rng)
+  {
+    std::vector<std::pair<idx_t, idx_t>> shapes{
+      {1, 1}, {1, 2}, {2, 2}, {2, 3}, {3, 3}, {4, 4}, {6, 6}, {8, 8} };
+    std::vector<std::pair<std::string, Solver>> solvers{
+      {"hungarian", Solver::Hungarian},
+      {"jv", Solver::JonkerVolgenant},
+      {"automatic", Solver::Automatic} };
+    std::cout << "Time per problem to match tiny problems with a workspace"
+      << std::endl;
+    std::cout << std::setw(8) << "shape";
+    for (const auto& solver : solvers)
+      std::cout << std::setw(16) << solver.first + " [ns]";
+    std::cout << std::endl;
+    SolverWorkspace workspace;
+    for (const auto& shape : shapes) {
+      std::vector<cost_matrix_t> problems;
+      for (std::size_t ip = 0; ip < nProblems; ++ip)
+        problems.push_back(randomCosts(shape.first, shape.second, rng) );
+      std::cout << std::setw(8) << std::to_string(shape.first) + "x" +
+        std::to_string(shape.second);
+      for (const auto& solver : solvers) {
+        double time = timeIt([&] () {
+            for (const cost_matrix_t& costs : problems)
+              match(costs, 0.5, workspace, solver.second);
+            });
+        std::cout << std::setw(16) << 1e9 * time / nProblems;
+      }
+      std::cout << std::endl;
+    }
+  }
+
+  void benchmarkStars(
+      const std::vector<idx_t>& sizes,
+      std::size_t nEvents,
+      double extraFraction,
+      float sigmaDR,
+      float maxDR,
+      std::mt19937& rng)
+  {
+    std::cout << "Time per event to match " << nEvents << " events of "
+      << "generated points through their sparse groups, and the fraction of "
+      << "groups with a single 'A' or 'B' point" << std::endl;
+    std::cout << std::setw(8) << "points"
+      << std::setw(12) << "stars [%]"
+      << std::setw(16) << "groups [us]"
+      << std::setw(16) << "workspace [us]"
+      << std::setw(16) << "points [us]" << std::endl;
+    for (idx_t n : sizes) {
+      std::vector<cost_matrix_t> events;
+      std::vector<std::pair<point_vec_t, point_vec_t>> points;
+      std::size_t nGroups = 0;
+      std::size_t nStars = 0;
+      for (std::size_t ie = 0; ie < nEvents; ++ie) {
+        point_vec_t pointsA;
+        point_vec_t pointsB;
+        generatePoints(n, n * extraFraction, 2.4, sigmaDR, rng, pointsA, pointsB);
+        events.push_back(deltaRCosts(pointsA, pointsB) );
+        points.emplace_back(std::move(pointsA), std::move(pointsB) );
+        for (const SparseGroup& group :
+            splitProblemIntoSparseGroups(events.back(), maxDR) ) {
+          ++nGroups;
+          nStars += group.isStar();
+        }
+      }
+      double groupsTime = timeIt([&] () {
+          for (const cost_matrix_t& costs : events)
+            matchFromGroups(splitProblemIntoSparseGroups(costs, maxDR) );
+          });
+      SolverWorkspace workspace;
+      double workspaceTime = timeIt([&] () {
+          for (const cost_matrix_t& costs : events)
+            sparseMatch(costs, maxDR, workspace);
+          });
+      double pointsTime = timeIt([&] () {
+          for (const auto& event : points)
+            sparseMatch(event.first, event.second, maxDR);
+          });
+      std::cout << std::setw(8) << n
+        << std::setw(12) << 100. * nStars / std::max<std::size_t>(nGroups, 1)
+        << std::setw(16) << 1e6 * groupsTime / nEvents
+        << std::setw(16) << 1e6 * workspaceTime / nEvents
+        << std::setw(16) << 1e6 * pointsTime / nEvents << std::endl;
+    }
+  }
+
+  template <typename T>
+    void benchmarkKernels(
+        const std::string& typeName,
+        const std::vector<idx_t>& sizes,
+        std::size_t nRepeats,
+        std::mt19937& rng)
+    {
+      using namespace SlackKernels;
+      std::vector<std::pair<std::string, InstructionSet>> instructionSets{
+        {"scalar", InstructionSet::Scalar},
+        {"avx2", InstructionSet::AVX2},
+        {"avx512", InstructionSet::AVX512} };
+      std::cout << "Time per element of the " << typeName
+        << " slack update kernels" << std::endl;
+      std::cout << std::setw(8) << "size";
+      for (const auto& instructionSet : instructionSets)
+        std::cout << std::setw(16) << instructionSet.first + " [ns]";
+      std::cout << std::endl;
+      for (idx_t n : sizes) {
+        std::vector<T> costs(n);
+        std::vector<T> labelsB(n);
+        std::vector<T> slacks(n);
+        std::vector<idx_t> minSlackIdx(n);
+        for (idx_t ib = 0; ib < n; ++ib) {
+          costs[ib] = randomCost<T>(rng);
+          labelsB[ib] = randomCost<T>(rng);
+        }
+        std::cout << std::setw(8) << n;
+        for (const auto& instructionSet : instructionSets) {
+          kernel_t<T> kernel;
+          try {
+            kernel = getKernel<T>(instructionSet.second);
+          }
+          catch (const std::runtime_error&) {
+            std::cout << std::setw(16) << "unsupported";
+            continue;
+          }
+          std::fill(slacks.begin(), slacks.end(), CostTraits<T>::largest() );
+          T delta = 0;
+          double time = timeIt([&] () {
+              for (std::size_t ii = 0; ii < nRepeats; ++ii)
+                kernel(costs.data(), ii, labelsB.data(), slacks.data(),
+                    minSlackIdx.data(), ii, n, delta);
+              });
+          std::cout << std::setw(16) << 1e9 * time / (nRepeats * n);
+        }
+        std::cout << std::endl;
+      }
+    }
+
+  // Time the dense solvers on a random problem with the given cost type
+  template <typename T>
+    void benchmarkType(
+        const std::string& typeName,
+        idx_t n,
+        std::mt19937& rng)
+    {
+      basic_cost_matrix_t<T> costs(n, n);
+      for (idx_t ib = 0; ib < n; ++ib)
+        for (idx_t ia = 0; ia < n; ++ia)
+          costs(ia, ib) = randomCost<T>(rng);
+      double hungarianTime = timeIt([&] () { BasicHungarianSolver<T>{costs}; });
+      double jvTime = timeIt([&] () { BasicJVSolver<T>{costs}; });
+      std::cout << std::setw(8) << n << std::setw(10) << typeName
+        << std::setw(20) << 1e3 * hungarianTime
+        << std::setw(20) << 1e3 * jvTime << std::endl;
+    }
+
+  void benchmarkTypes(
+      const std::vector<idx_t>& sizes,
+      std::mt19937& rng)
+  {
+    std::cout << "Time to solve random problems with each cost type"
+      << std::endl;
+    std::cout << std::setw(8) << "size" << std::setw(10) << "type"
+      << std::setw(20) << "hungarian [ms]"
+      << std::setw(20) << "jv [ms]" << std::endl;
+    for (idx_t n : sizes) {
+      benchmarkType<float>("float", n, rng);
+      benchmarkType<double>("double", n, rng);
+      benchmarkType<std::int32_t>("int32", n, rng);
+      benchmarkType<std::int64_t>("int64", n, rng);
+    }
+  }
+}
+
+int main(int argc, char* argv[]) {
+  namespace po = boost::program_options;
+
+  std::string benchmark;
+  std::vector<idx_t> sizes;
+  std::vector<double> occupancies;
+  std::vector<double> degrees;
+  idx_t maxRebuildSize;
+  double aspect;
+  double extraFraction;
+  float sigmaDR;
+  float maxDR;
+  float drift;
+  unsigned int seed;
+  std::size_t nThreads;
+  std::size_t nEvents;
+  std::size_t nRepeats;
+  po::options_description opts("Allowed options");
+  opts.add_options()
+    ("help,h", "Produce this message and exit.")
+    ("benchmark,b", po::value(&benchmark)->default_value("hungarian"),
+     "The benchmark to run. One of: hungarian, jv, auction, sparse, "
+     "grouping, parallel, batch, workspace, augment, kernels, layout, types, "
+     "tiny, stars, groupcosts, arena, pipeline, warmstart, dynamic, lazy, "
+     "deltar, radius, events, stream, infinite")
+    ("sizes,n", po::value(&sizes)->multitoken(),
+     "The problem sizes to run over")
+    ("occupancies", po::value(&occupancies)->multitoken(),
+     "The fractions of admissible edges used by the grouping benchmark")
+    ("degrees", po::value(&degrees)->multitoken(),
+     "The mean numbers of admissible edges per vertex used by the groupcosts "
+     "benchmark")
+    ("aspect", po::value(&aspect)->default_value(1),
+     "The number of columns per row for rectangular problems")
+    ("extra-fraction", po::value(&extraFraction)->default_value(0.25),
+     "The number of extra 'B' points to generate per 'A' point")
+    ("sigma-dr", po::value(&sigmaDR)->default_value(0.1),
+     "The width of the gaussian used to displace generated points")
+    ("radius,r", po::value(&maxDR)->default_value(0.2),
+     "The MaxDR used to match generated points")
+    ("drift", po::value(&drift)->default_value(0.01),
+     "The width of the gaussian used to move the points between frames in the "
+     "warmstart benchmark")
+    ("max-rebuild-size", po::value(&maxRebuildSize)->default_value(2000),
+     "The largest problem to run the rebuilding search mode on")
+    ("threads,j", po::value(&nThreads)->default_value(0),
+     "The number of threads to use. 0 means the hardware concurrency")
+    ("events", po::value(&nEvents)->default_value(1000),
+     "The number of events used by the batch, workspace, stars, arena, "
+     "events and stream benchmarks. The tiny benchmark solves 100 times as many "
+     "problems, the warmstart benchmark runs a tenth as many frames and the "
+     "dynamic benchmark makes a twentieth as many changes")
+    ("repeats", po::value(&nRepeats)->default_value(20),
+     "The number of times each problem is solved by the augment benchmark. "
+     "The kernels benchmark runs 1000 times as many and the infinite "
+     "benchmark checks this many problems of each size, shape and type")
+    ("seed,S", po::value(&seed)->default_value(0),
+     "The seed for the random number generator");
+
+  po::variables_map vm;
+  po::store(po::command_line_parser(argc, argv).options(opts).run(), vm);
+  po::notify(vm);
+
+  if (vm.count("help") ) {
+    std::cout << opts << std::endl;
+    return 0;
+  }
+
+  std::mt19937 rng(seed);
+  if (benchmark == "hungarian") {
+    if (sizes.empty() )
+      sizes = {100, 200, 500, 1000, 2000, 5000};
+    benchmarkHungarian(sizes, maxRebuildSize, rng);
+  }
+  else if (benchmark == "jv") {
+    if (sizes.empty() )
+      sizes = {4, 8, 16, 32, 100, 200, 500, 1000, 2000, 5000};
+    benchmarkJV(sizes, aspect, rng);
+  }
+  else if (benchmark == "auction") {
+    if (sizes.empty() )
+      sizes = {20, 100, 500, 1000, 2000, 5000};
+    benchmarkAuction(sizes, extraFraction, sigmaDR, maxDR, rng);
+  }
+  else if (benchmark == "sparse") {
+    if (sizes.empty() )
+      sizes = {20, 100, 200, 500, 1000};
+    benchmarkSparse(sizes, extraFraction, sigmaDR, maxDR, 5000, rng);
+  }
+  else if (benchmark == "grouping") {
+    if (sizes.empty() )
+      sizes = {10000};
+    if (occupancies.empty() )
+      occupancies = {1e-5, 3e-5, 1e-4, 2e-4, 5e-4};
+    benchmarkGrouping(sizes, occupancies, rng);
+  }
+  else if (benchmark == "groupcosts") {
+    if (sizes.empty() )
+      sizes = {1000, 5000};
+    if (degrees.empty() )
+      degrees = {0.5, 0.8, 1.2, 2};
+    benchmarkGroupCosts(sizes, degrees, rng);
+  }
+  else if (benchmark == "parallel") {
+    if (sizes.empty() )
+      sizes = {1000, 5000, 10000};
+    benchmarkParallel(sizes, extraFraction, sigmaDR, maxDR, nThreads, rng);
+  }
+  else if (benchmark == "pipeline") {
+    if (sizes.empty() )
+      sizes = {1000, 5000, 10000};
+    benchmarkPipeline(sizes, extraFraction, sigmaDR, maxDR, nThreads, rng);
+  }
+  else if (benchmark == "batch") {
+    if (sizes.empty() )
+      sizes = {10, 50, 200};
+    benchmarkBatch(sizes, nEvents, extraFraction, sigmaDR, maxDR, nThreads,
+        rng);
+  }
+  else if (benchmark == "workspace") {
+    if (sizes.empty() )
+      sizes = {10, 50, 200};
+    if (!benchmarkWorkspace(
+          sizes, nEvents, extraFraction, sigmaDR, maxDR, rng) )
+      return 1;
+  }
+  else if (benchmark == "arena") {
+    if (sizes.empty() )
+      sizes = {10, 50, 200};
+    benchmarkArena(sizes, nEvents, extraFraction, sigmaDR, maxDR, rng);
+  }
+  else if (benchmark == "warmstart") {
+    if (sizes.empty() )
+      sizes = {50, 200, 500};
+    benchmarkWarmStart(sizes, std::max<std::size_t>(nEvents / 10, 2),
+        extraFraction, sigmaDR, maxDR, drift, rng);
+  }
+  else if (benchmark == "dynamic") {
+    if (sizes.empty() )
+      sizes = {50, 200, 500};
+    benchmarkDynamic(sizes, std::max<std::size_t>(nEvents / 20, 2),
+        extraFraction, sigmaDR, maxDR, rng);
+  }
+  else if (benchmark == "lazy") {
+    if (sizes.empty() )
+      sizes = {200, 1000, 5000};
+    benchmarkLazy(sizes, extraFraction, sigmaDR, maxDR, rng);
+  }
+  else if (benchmark == "deltar") {
+    if (sizes.empty() )
+      sizes = {200, 1000, 5000};
+    benchmarkDeltaR(sizes, extraFraction, sigmaDR, maxDR, rng);
+  }
+  else if (benchmark == "radius") {
+    if (sizes.empty() )
+      sizes = {1000, 5000, 10000};
+    benchmarkRadius(sizes, rng);
+  }
+  else if (benchmark == "events") {
+    if (sizes.empty() )
+      sizes = {10, 50, 200};
+    benchmarkEvents(sizes, nEvents, extraFraction, sigmaDR, maxDR, rng);
+  }
+  else if (benchmark == "stream") {
+    if (sizes.empty() )
+      sizes = {10, 50, 200};
+    benchmarkStream(
+        sizes, nEvents, extraFraction, sigmaDR, maxDR, nThreads, rng);
+  }
+  else if (benchmark == "infinite") {
+    if (sizes.empty() )
+      sizes = {6, 20, 100};
+    benchmarkInfinite<float>("float", sizes, nRepeats, rng);
+    benchmarkInfinite<double>("double", sizes, nRepeats, rng);
+  }
+  else if (benchmark == "augment") {
+    if (sizes.empty() )
+      sizes = {10, 50, 200, 1000};
+    benchmarkAugment(sizes, nRepeats, rng);
+  }
+  else if (benchmark == "kernels") {
+    if (sizes.empty() )
+      sizes = {16, 100, 1000, 10000};
+    benchmarkKernels<float>("float", sizes, nRepeats * 1000, rng);
+    benchmarkKernels<double>("double", sizes, nRepeats * 1000, rng);
+    benchmarkKernels<std::int32_t>("int32", sizes, nRepeats * 1000, rng);
+    benchmarkKernels<std::int64_t>("int64", sizes, nRepeats * 1000, rng);
+  }
+  else if (benchmark == "layout") {
+    if (sizes.empty() )
+      sizes = {100, 500, 1000, 2000};
+    benchmarkLayout(sizes, rng);
+  }
+  else if (benchmark == "tiny")
+    benchmarkTiny(nEvents * 100, rng);
+  else if (benchmark == "stars") {
+    if (sizes.empty() )
+      sizes = {10, 50, 200};
+    benchmarkStars(sizes, nEvents, extraFraction, sigmaDR, maxDR, rng);
+  }
+  else if (benchmark == "types") {
+    if (sizes.empty() )
+      sizes = {100, 500, 1000, 2000};
+    benchmarkTypes(sizes, rng);
+  }
+  else {
+    std::cerr << "Unknown benchmark: " << benchmark << std::endl;
+    return 1;
+  }
+  return 0;
+}
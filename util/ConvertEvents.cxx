@@ -0,0 +1,59 @@
+#include "json.hpp"
+#include "SparseHungarian/EventFile.h"
+#include "boost/program_options.hpp"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+
+int main(int argc, char* argv[]) {
+  namespace po = boost::program_options;
+  using json = nlohmann::json;
+
+  std::vector<std::string> inputFileNames;
+  std::string outputFileName;
+  po::options_description opts("Convert JSON files written by "
+      "python/generate_points.py into a binary event file, one event per file");
+  opts.add_options()
+    ("help,h", "Produce this message and exit.")
+    ("input,i", po::value(&inputFileNames)->multitoken(),
+     "The JSON files to read, in the order that the events should be written")
+    ("output,o", po::value(&outputFileName), "The binary event file to write");
+
+  po::variables_map vm;
+  po::store(po::command_line_parser(argc, argv).options(opts).run(), vm);
+  po::notify(vm);
+
+  if (vm.count("help") ) {
+    std::cout << opts << std::endl;
+    return 0;
+  }
+
+  if (inputFileNames.empty() ) {
+    std::cerr << "No input files provided!" << std::endl;
+    return 1;
+  }
+  if (outputFileName.empty() ) {
+    std::cerr << "No output file name provided!" << std::endl;
+    return 1;
+  }
+
+  SparseHungarian::EventFileWriter writer(outputFileName);
+  for (const std::string& inputFileName : inputFileNames) {
+    std::ifstream ifs(inputFileName);
+    if (!ifs.is_open() ) {
+      std::cerr << "Failed to open input file: " << inputFileName << std::endl;
+      return 1;
+    }
+    json j;
+    ifs >> j;
+    writer.write(
+        j["PointsA"].get<SparseHungarian::point_vec_t>(),
+        j["PointsB"].get<SparseHungarian::point_vec_t>(),
+        j["MaxDR"].get<float>() );
+  }
+  writer.close();
+  std::cout << "Wrote " << writer.nEvents() << " events to " << outputFileName
+    << std::endl;
+  return 0;
+}
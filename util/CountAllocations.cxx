@@ -0,0 +1,57 @@
+#include "CountAllocations.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// The replacements are kept in their own file so that the compiler can't
+// inline a deallocation into code it can see allocating with new, which it
+// would warn about as a mismatched new and free. The array forms call these.
+
+namespace {
+  std::atomic<std::size_t> nAllocations(0);
+}
+
+std::size_t allocationCount()
+{
+  return nAllocations;
+}
+
+void* operator new(std::size_t size)
+{
+  ++nAllocations;
+  if (void* ptr = std::malloc(size == 0 ? 1 : size) )
+    return ptr;
+  throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+  ++nAllocations;
+  // aligned_alloc needs a size that is a multiple of the alignment
+  std::size_t align = static_cast<std::size_t>(alignment);
+  std::size_t rounded = (std::max<std::size_t>(size, 1) + align - 1) / align;
+  if (void* ptr = std::aligned_alloc(align, rounded * align) )
+    return ptr;
+  throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept
+{
+  std::free(ptr);
+}
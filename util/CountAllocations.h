@@ -0,0 +1,15 @@
+#ifndef SparseHungarian_CountAllocations_H
+#define SparseHungarian_CountAllocations_H
+
+#include <cstddef>
+
+/**
+ * \brief The number of heap allocations made so far by the whole program
+ *
+ * Linking CountAllocations.cxx into an executable replaces the global
+ * allocation functions with ones that count every call. It is only used by
+ * BenchmarkSolvers, to check that solves reusing a workspace don't allocate.
+ */
+std::size_t allocationCount();
+
+#endif //> !SparseHungarian_CountAllocations_H
@@ -1,16 +1,46 @@
 #include "json.hpp"
 #include "SparseHungarian/SparseGroup.h"
 #include "SparseHungarian/Matching.h"
+#include "SparseHungarian/DeltaRMatcher.h"
+#include "SparseHungarian/DeltaR.h"
+#include "SparseHungarian/EventFile.h"
 #include "boost/program_options.hpp"
 #include <iostream>
 #include <fstream>
 #include <iomanip>
 #include <chrono>
+#include <memory>
+#include <exception>
 
 namespace {
-  const float pi = 3.14159265358979323846;
-  float pythagoras(float a, float b) {
-    return sqrt(a*a + b*b);
+  // Match every event in a binary event file, writing only the sparse
+  // matches. Neither the dense costs nor the groups are kept
+  int matchBinary(
+      const std::string& inputFileName,
+      const std::string& outputFileName)
+  {
+    SparseHungarian::EventFileReader reader(inputFileName);
+    SparseHungarian::BatchResult result;
+    result.offsets.push_back(0);
+    std::unique_ptr<SparseHungarian::DeltaRMatcher> matcher;
+    auto start = std::chrono::system_clock::now();
+    for (std::size_t ie = 0; ie < reader.nEvents(); ++ie) {
+      SparseHungarian::EventView event = reader.event(ie);
+      // Keep the matcher's buffers while the MaxDR stays the same
+      if (!matcher || matcher->maxDR() != event.maxDR)
+        matcher.reset(new SparseHungarian::DeltaRMatcher(event.maxDR) );
+      SparseHungarian::match_vec_t matches = matcher->match(
+          event.phiA, event.etaA, event.phiB, event.etaB);
+      result.matches.insert(result.matches.end(),
+          matches.begin(), matches.end() );
+      result.offsets.push_back(result.matches.size() );
+    }
+    auto end = std::chrono::system_clock::now();
+    std::chrono::duration<double> duration = end - start;
+    std::cout << "Sparse Hungarian matched " << reader.nEvents()
+      << " events in " << duration.count() << " seconds." << std::endl;
+    SparseHungarian::writeMatchFile(outputFileName, result);
+    return 0;
   }
 }
 
@@ -21,12 +51,18 @@ int main(int argc, char* argv[]) {
   // The input options
   std::string inputFileName;
   std::string outputFileName;
+  std::string format;
   po::options_description opts("Allowed options");
   opts.add_options()
     ("help,h", "Produce this message and exit.")
     ("input,i", po::value(&inputFileName), "The input file to read from")
     ("output,o", po::value(&outputFileName), "The output file to write to. "
-     "If not set, write to the input file");
+     "If not set, write to the input file")
+    ("format,f", po::value(&format)->default_value("json"),
+     "The input format. Either json, for a single event written by "
+     "python/generate_points.py, or binary, for an event file written by "
+     "ConvertEvents. Binary input is matched with the sparse matching only "
+     "and the matches written to a separate binary match file");
 
   po::variables_map vm;
   po::store(po::command_line_parser(argc, argv).options(opts).run(), vm);
@@ -45,6 +81,25 @@ int main(int argc, char* argv[]) {
     return 1;
   }
 
+  if (format == "binary") {
+    if (outputFileName.empty() ) {
+      std::cerr << "Binary input needs a separate output file!" << std::endl;
+      return 1;
+    }
+    // A malformed event file is reported like any other bad input
+    try {
+      return matchBinary(inputFileName, outputFileName);
+    }
+    catch (const std::exception& e) {
+      std::cerr << e.what() << std::endl;
+      return 1;
+    }
+  }
+  if (format != "json") {
+    std::cerr << "Unknown format: " << format << std::endl;
+    return 1;
+  }
+
   if (outputFileName.empty() )
     outputFileName = inputFileName;
 
@@ -70,33 +125,36 @@ int main(int argc, char* argv[]) {
 
   float maxCost = j["MaxDR"].get<float>();
 
-  // Now, make the cost matrix
-  SparseHungarian::cost_matrix_t costs(pointsA.size(), pointsB.size() );
+  // The matcher takes the coordinates as separate arrays
+  Eigen::ArrayXf phiA(pointsA.size() );
+  Eigen::ArrayXf etaA(pointsA.size() );
+  Eigen::ArrayXf phiB(pointsB.size() );
+  Eigen::ArrayXf etaB(pointsB.size() );
   for (unsigned int ia = 0; ia < pointsA.size(); ++ia) {
-    for (unsigned int ib = 0; ib < pointsB.size(); ++ib) {
-      const auto& pa = pointsA.at(ia);
-      const auto& pb = pointsB.at(ib);
-      double phiDiff = std::fmod(fabs(pa.first - pb.first), 2*pi);
-      costs(ia, ib) = pythagoras(
-          std::min(phiDiff, fabs(2*pi - phiDiff) ),
-          pa.second - pb.second
-          );
-      // fmod wrt pi to account for detector wrapping
-    }
+    phiA[ia] = pointsA[ia].first;
+    etaA[ia] = pointsA[ia].second;
+  }
+  for (unsigned int ib = 0; ib < pointsB.size(); ++ib) {
+    phiB[ib] = pointsB[ib].first;
+    etaB[ib] = pointsB[ib].second;
   }
-
-  //std::cout << costs << std::endl;
 
   auto sparseStart = std::chrono::system_clock::now();
-  // Then build the groups
-  auto groups = SparseHungarian::splitProblemIntoSparseGroups(costs, maxCost);
-  
-  // Now solve the problem
-  auto sparseMatches = SparseHungarian::matchFromGroups(groups);
+  // The matcher only computes the deltaRs of nearby pairs, then builds the
+  // groups and solves them
+  SparseHungarian::DeltaRMatcher matcher(maxCost);
+  auto sparseMatches = matcher.match(phiA, etaA, phiB, etaB);
+  const auto& groups = matcher.groups();
   auto sparseEnd = std::chrono::system_clock::now();
   std::chrono::duration<double> sparseDuration = sparseEnd - sparseStart;
   std::cout << "Sparse Hungarian took " << sparseDuration.count() << " seconds." << std::endl;
 
+  // The full cost matrix is only needed for the comparison and the output
+  SparseHungarian::cost_matrix_t costs(pointsA.size(), pointsB.size() );
+  for (unsigned int ia = 0; ia < pointsA.size(); ++ia)
+    for (unsigned int ib = 0; ib < pointsB.size(); ++ib)
+      costs(ia, ib) = SparseHungarian::deltaR(pointsA[ia], pointsB[ib]);
+
   // Add a little - solve with the original Hungarian algorithm
   auto origStart = std::chrono::system_clock::now();
   auto origMatches = SparseHungarian::match(costs, maxCost);
@@ -0,0 +1,146 @@
+#include "json.hpp"
+#include "SparseHungarian/StreamingMatcher.h"
+#include "SparseHungarian/EventFile.h"
+#include "boost/program_options.hpp"
+#include <exception>
+#include <iostream>
+#include <fstream>
+#include <memory>
+#include <string>
+
+int main(int argc, char* argv[]) {
+  namespace po = boost::program_options;
+  using json = nlohmann::json;
+  using namespace SparseHungarian;
+
+  std::string inputFileName = "-";
+  std::string inputFormat = "binary";
+  std::string outputFileName = "-";
+  std::string outputFormat = "binary";
+  std::size_t nThreads = 0;
+  std::size_t window = 0;
+  po::options_description opts("Match every event in a stream, keeping only a "
+      "bounded number of events in memory. The matches are written in the same "
+      "order as the events");
+  opts.add_options()
+    ("help,h", "Produce this message and exit.")
+    ("input,i", po::value(&inputFileName),
+     "The events to read, or '-' for standard input")
+    ("input-format,f", po::value(&inputFormat),
+     "The format of the events: 'binary' for a binary event file or 'ndjson' "
+     "for one JSON object per line as written by python/generate_points.py")
+    ("output,o", po::value(&outputFileName),
+     "Where to write the matches, or '-' for standard output")
+    ("output-format,F", po::value(&outputFormat),
+     "The format of the matches: 'binary' for a match stream or 'ndjson' for "
+     "one JSON array of [A, B] index pairs per line")
+    ("threads,j", po::value(&nThreads),
+     "The number of threads to use. If 0 then the hardware concurrency is used")
+    ("window,w", po::value(&window),
+     "The most events to hold at once. If 0 then four per thread");
+
+  po::variables_map vm;
+  po::store(po::command_line_parser(argc, argv).options(opts).run(), vm);
+  po::notify(vm);
+
+  if (vm.count("help") ) {
+    std::cout << opts << std::endl;
+    return 0;
+  }
+
+  if (inputFormat != "binary" && inputFormat != "ndjson") {
+    std::cerr << "Unknown input format: " << inputFormat << std::endl;
+    return 1;
+  }
+  if (outputFormat != "binary" && outputFormat != "ndjson") {
+    std::cerr << "Unknown output format: " << outputFormat << std::endl;
+    return 1;
+  }
+
+  std::ios::sync_with_stdio(false);
+  std::ifstream ifs;
+  if (inputFileName != "-") {
+    ifs.open(inputFileName, std::ios::binary);
+    if (!ifs.is_open() ) {
+      std::cerr << "Failed to open input file: " << inputFileName << std::endl;
+      return 1;
+    }
+  }
+  std::istream& in = inputFileName == "-" ? std::cin : ifs;
+  std::ofstream ofs;
+  if (outputFileName != "-") {
+    ofs.open(outputFileName, std::ios::binary | std::ios::trunc);
+    if (!ofs.is_open() ) {
+      std::cerr << "Failed to open output file: " << outputFileName << std::endl;
+      return 1;
+    }
+  }
+  std::ostream& out = outputFileName == "-" ? std::cout : ofs;
+
+  // A malformed input is reported like any other bad input
+  try {
+    StreamingMatcher::source_t source;
+    std::unique_ptr<EventStreamReader> reader;
+    std::string line;
+    if (inputFormat == "binary") {
+      reader = std::make_unique<EventStreamReader>(in);
+      source = [&] (EventData& event) { return reader->read(event); };
+    }
+    else {
+      source = [&] (EventData& event) {
+        // Skip blank lines, such as one at the end of the file
+        do {
+          if (!std::getline(in, line) )
+            return false;
+        } while (line.find_first_not_of(" \t\r") == std::string::npos);
+        json j = json::parse(line);
+        point_vec_t pointsA = j["PointsA"].get<point_vec_t>();
+        point_vec_t pointsB = j["PointsB"].get<point_vec_t>();
+        event.maxDR = j["MaxDR"].get<float>();
+        event.phiA.resize(pointsA.size() );
+        event.etaA.resize(pointsA.size() );
+        event.phiB.resize(pointsB.size() );
+        event.etaB.resize(pointsB.size() );
+        for (std::size_t ia = 0; ia < pointsA.size(); ++ia) {
+          event.phiA[ia] = pointsA[ia].first;
+          event.etaA[ia] = pointsA[ia].second;
+        }
+        for (std::size_t ib = 0; ib < pointsB.size(); ++ib) {
+          event.phiB[ib] = pointsB[ib].first;
+          event.etaB[ib] = pointsB[ib].second;
+        }
+        return true;
+      };
+    }
+
+    StreamingMatcher::sink_t sink;
+    std::unique_ptr<MatchStreamWriter> writer;
+    if (outputFormat == "binary") {
+      writer = std::make_unique<MatchStreamWriter>(out);
+      sink = [&] (std::size_t, const match_vec_t& matches) {
+        writer->write(matches);
+      };
+    }
+    else {
+      sink = [&] (std::size_t, const match_vec_t& matches) {
+        out << json(matches).dump() << '\n';
+        if (!out)
+          throw std::runtime_error("Failed to write matches");
+      };
+    }
+
+    StreamingMatcher matcher(nThreads, window);
+    std::size_t nEvents = matcher.run(source, sink);
+    out.flush();
+    if (!out) {
+      std::cerr << "Failed to write matches" << std::endl;
+      return 1;
+    }
+    std::cerr << "Matched " << nEvents << " events" << std::endl;
+    return 0;
+  }
+  catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+}